@@ -0,0 +1,194 @@
+<?xml version="1.0" encoding="UTF-8"?>
+<simconf>
+  <project EXPORT="discard">[APPS_DIR]/mrm</project>
+  <project EXPORT="discard">[APPS_DIR]/mspsim</project>
+  <project EXPORT="discard">[APPS_DIR]/avrora</project>
+  <project EXPORT="discard">[APPS_DIR]/serial_socket</project>
+  <project EXPORT="discard">[APPS_DIR]/collect-view</project>
+  <project EXPORT="discard">[APPS_DIR]/powertracker</project>
+  <simulation>
+    <title>RPL storing against non-storing</title>
+    <randomseed>123456</randomseed>
+    <motedelay_us>1000000</motedelay_us>
+    <radiomedium>
+      org.contikios.cooja.radiomediums.UDGM
+      <transmitting_range>50.0</transmitting_range>
+      <interference_range>100.0</interference_range>
+      <success_ratio_tx>1.0</success_ratio_tx>
+      <success_ratio_rx>1.0</success_ratio_rx>
+    </radiomedium>
+    <events>
+      <logoutput>40000</logoutput>
+    </events>
+    <motetype>
+      org.contikios.cooja.mspmote.Z1MoteType
+      <identifier>z11</identifier>
+      <description>Z1 Mote Type #z11</description>
+      <firmware EXPORT="copy">[CONFIG_DIR]/udp-server-test/udp-server-test.z1</firmware>
+      <moteinterface>org.contikios.cooja.interfaces.Position</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.RimeAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.IPAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.Mote2MoteRelations</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.MoteAttributes</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspClock</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspMoteID</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspButton</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.Msp802154Radio</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspDefaultSerial</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspLED</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspDebugOutput</moteinterface>
+    </motetype>
+    <motetype>
+      org.contikios.cooja.mspmote.Z1MoteType
+      <identifier>z12</identifier>
+      <description>Z1 Mote Type #z12</description>
+      <firmware EXPORT="copy">[CONFIG_DIR]/udp-client-test/udp-client-test.z1</firmware>
+      <moteinterface>org.contikios.cooja.interfaces.Position</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.RimeAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.IPAddress</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.Mote2MoteRelations</moteinterface>
+      <moteinterface>org.contikios.cooja.interfaces.MoteAttributes</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspClock</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspMoteID</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspButton</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.Msp802154Radio</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspDefaultSerial</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspLED</moteinterface>
+      <moteinterface>org.contikios.cooja.mspmote.interfaces.MspDebugOutput</moteinterface>
+    </motetype>
+    <mote>
+      <breakpoints />
+      <interface_config>
+        org.contikios.cooja.interfaces.Position
+        <x>0.0</x>
+        <y>0.0</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        org.contikios.cooja.mspmote.interfaces.MspClock
+        <deviation>1.0</deviation>
+      </interface_config>
+      <interface_config>
+        org.contikios.cooja.mspmote.interfaces.MspMoteID
+        <id>1</id>
+      </interface_config>
+      <motetype_identifier>z11</motetype_identifier>
+    </mote>
+    <!-- clients -->
+  </simulation>
+  <plugin>
+    org.contikios.cooja.plugins.SimControl
+    <width>280</width>
+    <z>1</z>
+    <height>160</height>
+    <location_x>400</location_x>
+    <location_y>0</location_y>
+  </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.LogListener
+    <plugin_config>
+      <filter />
+      <formatted_time />
+      <coloring />
+    </plugin_config>
+    <width>845</width>
+    <z>2</z>
+    <height>240</height>
+    <location_x>400</location_x>
+    <location_y>160</location_y>
+  </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.ScriptRunner
+    <plugin_config>
+      <script>/*
+ * Storing against non-storing mode. tools/rpl-bench.sh builds both sides
+ * with WITH_RPL_BENCH=1 and puts the clients in place of the clients
+ * comment after the sink. After RUN ms the last BENCH line of every node
+ * (rpl-bench.h) and the sink's node table give one line:
+ *
+ *   RESULT &lt;clients&gt; &lt;joined&gt; &lt;icmp sent per client and hour&gt;
+ *          &lt;listen avg&gt; &lt;listen max&gt; &lt;transmit avg&gt; &lt;sink routes&gt;
+ *          &lt;sink links&gt; &lt;parent switches&gt; &lt;pdr %&gt;
+ *          &lt;rpl frames per client and hour&gt; &lt;rpl bytes per client and hour&gt;
+ *
+ * listen and transmit are the clients' radio duty cycle in per mille.
+ */
+var RUN = 2 * 3600 * 1000;
+
+var sink = sim.getMoteWithID(1);
+var last = {};
+var clients = sim.getMotesCount() - 1;
+var joined = 0;
+var icmp = 0;
+var listen = 0;
+var listen_max = 0;
+var tx = 0;
+var switches = 0;
+var rpl_frames = 0;
+var rpl_bytes = 0;
+var received = 0;
+var missed = 0;
+var n;
+var b;
+
+TIMEOUT(RUN + 60000);
+GENERATE_MSG(RUN, "end");
+while(true) {
+  YIELD();
+  if(msg.equals("end")) {
+    break;
+  }
+  if(msg.startsWith("BENCH ")) {
+    last[id] = msg.split(" ");
+  }
+}
+
+sink.getInterfaces().getLog().writeString("nodes");
+GENERATE_MSG(2000, "done");
+while(true) {
+  YIELD();
+  if(msg.equals("done")) {
+    break;
+  }
+  if(mote == sink &amp;&amp; msg.startsWith("Node ")) {
+    received += parseInt(msg.split(" rx ")[1]);
+    missed += parseInt(msg.split(" missed ")[1]);
+  }
+}
+
+for(n in last) {
+  b = last[n];
+  if(n == 1) {
+    continue;
+  }
+  joined += parseInt(b[6]) != 65535 ? 1 : 0;
+  icmp += parseInt(b[2]);
+  listen += parseInt(b[4]);
+  listen_max = Math.max(listen_max, parseInt(b[4]));
+  tx += parseInt(b[5]);
+  switches += parseInt(b[9]);
+  rpl_frames += parseInt(b[10]);
+  rpl_bytes += parseInt(b[11]);
+}
+b = last[1] ? last[1] : [0, 0, 0, 0, 0, 0, 0, "-", "-"];
+
+log.log("RESULT " + clients + " " + joined + " " +
+        (icmp / clients / (RUN / 3600000)).toFixed(1) + " " +
+        (listen / clients).toFixed(1) + " " + listen_max + " " +
+        (tx / clients).toFixed(1) + " " + b[7] + " " + b[8] + " " +
+        switches + " " +
+        (received + missed &gt; 0 ?
+         (100.0 * received / (received + missed)).toFixed(1) : "-") + " " +
+        (rpl_frames / clients / (RUN / 3600000)).toFixed(1) + " " +
+        (rpl_bytes / clients / (RUN / 3600000)).toFixed(0) + "\n");
+log.testOK();
+</script>
+      <active>true</active>
+    </plugin_config>
+    <width>600</width>
+    <z>0</z>
+    <height>700</height>
+    <location_x>0</location_x>
+    <location_y>0</location_y>
+  </plugin>
+</simconf>
@@ -60,9 +60,11 @@ struct my_msg_t {
 };
 
 
-/* This data structure is used to store the packet content (payload)
+/* This data structure was used to store the packet content (payload)
    The UDP+6LoWPAN header takes 45 bytes according to WireShark, which leaves
-   82 bytes for payload. */
+   82 bytes for payload. It is no longer sent as-is, the readings use the
+   compact encoding in msg-codec.h (8 bytes instead of 81). Kept so host
+   tools can still decode captures of the old format. */
 
 
 struct my_meddelande_t {
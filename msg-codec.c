@@ -0,0 +1,804 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "msg-codec.h"
+
+static const char *mode_names[MSG_MODE_NUM] = {
+  "Normal_op", "Lo_Bat", "Hi_bat", "Sleep"
+};
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_put_varint(uint8_t *buf, uint8_t len, uint32_t value)
+{
+  uint8_t n = 0;
+
+  do {
+    if(n >= len) {
+      return 0;
+    }
+    buf[n] = value & 0x7f;
+    value >>= 7;
+    if(value != 0) {
+      buf[n] |= 0x80;
+    }
+    n++;
+  } while(value != 0);
+
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_get_varint(const uint8_t *buf, uint16_t len, uint32_t *value)
+{
+  uint8_t n;
+  uint32_t v = 0;
+
+  for(n = 0; n < len && n < 5; n++) {
+    /* The 5th byte holds the top 4 bits and ends the varint */
+    if(n == 4 && buf[n] > 0x0f) {
+      return 0;
+    }
+    v |= (uint32_t)(buf[n] & 0x7f) << (7 * n);
+    if((buf[n] & 0x80) == 0) {
+      *value = v;
+      return n + 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+put_reading(uint8_t *buf, uint8_t len, const struct msg_reading *r)
+{
+  uint8_t pos;
+  uint8_t n;
+
+  if(len < 1) {
+    return 0;
+  }
+  buf[0] = (r->fields << 4) | (r->mode & 0x0f);
+  pos = 1;
+
+  n = msg_put_varint(&buf[pos], len - pos, r->counter);
+  if(n == 0) {
+    return 0;
+  }
+  pos += n;
+
+  if(r->fields & MSG_F_BATTERY) {
+    if(len - pos < 2) {
+      return 0;
+    }
+    buf[pos++] = r->battery & 0xff;
+    buf[pos++] = r->battery >> 8;
+  }
+
+  if(r->fields & MSG_F_DATA_RATE) {
+    n = msg_put_varint(&buf[pos], len - pos, r->data_rate);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(r->fields & MSG_F_AGE) {
+    n = msg_put_varint(&buf[pos], len - pos, r->age);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+get_reading(const uint8_t *buf, uint16_t len, struct msg_reading *r)
+{
+  uint8_t pos;
+  uint8_t n;
+  uint32_t v;
+
+  if(len < 1) {
+    return 0;
+  }
+  r->fields = buf[0] >> 4;
+  r->mode = buf[0] & 0x0f;
+  r->battery = 0;
+  r->data_rate = 0;
+  r->age = 0;
+  pos = 1;
+
+  n = msg_get_varint(&buf[pos], len - pos, &v);
+  if(n == 0 || v > 0xffff) {
+    return 0;
+  }
+  r->counter = (uint16_t)v;
+  pos += n;
+
+  if(r->fields & MSG_F_BATTERY) {
+    if(len - pos < 2) {
+      return 0;
+    }
+    r->battery = buf[pos] | ((uint16_t)buf[pos + 1] << 8);
+    pos += 2;
+  }
+
+  if(r->fields & MSG_F_DATA_RATE) {
+    n = msg_get_varint(&buf[pos], len - pos, &r->data_rate);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(r->fields & MSG_F_AGE) {
+    n = msg_get_varint(&buf[pos], len - pos, &r->age);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+int8_t
+msg_type(const uint8_t *buf, uint16_t len)
+{
+  if(len < 1 || (buf[0] >> 4) != MSG_VERSION) {
+    return -1;
+  }
+  return buf[0] & 0x0f;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_encode_reading(uint8_t *buf, uint8_t len, const struct msg_reading *r)
+{
+  uint8_t n;
+
+  if(len < 1) {
+    return 0;
+  }
+  buf[0] = (MSG_VERSION << 4) | MSG_TYPE_READING;
+  n = put_reading(&buf[1], len - 1, r);
+  return n == 0 ? 0 : n + 1;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_decode_reading(const uint8_t *buf, uint16_t len, struct msg_reading *r)
+{
+  uint8_t n;
+
+  if(msg_type(buf, len) != MSG_TYPE_READING) {
+    return 0;
+  }
+  n = get_reading(&buf[1], len - 1, r);
+  return n == 0 ? 0 : n + 1;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_encode_batch(uint8_t *buf, uint8_t len, const struct msg_reading *r,
+                 uint8_t num, uint8_t *out_len)
+{
+  uint8_t pos;
+  uint8_t i;
+  uint8_t n;
+
+  if(len < MSG_BATCH_HDR_LEN) {
+    return 0;
+  }
+  pos = MSG_BATCH_HDR_LEN;
+  for(i = 0; i < num; i++) {
+    n = put_reading(&buf[pos], len - pos, &r[i]);
+    if(n == 0) {
+      break;
+    }
+    pos += n;
+  }
+  if(i == 0) {
+    return 0;
+  }
+  buf[0] = (MSG_VERSION << 4) | MSG_TYPE_BATCH;
+  buf[1] = i;
+  *out_len = pos;
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+/* Zigzag of a two's complement value held in a uint32_t, so small negative
+   values code short too. All the arithmetic is unsigned, where wrapping is
+   defined */
+static uint32_t
+zigzag(uint32_t v)
+{
+  return (v << 1) ^ (0 - (v >> 31));
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+unzigzag(uint32_t v)
+{
+  return (v >> 1) ^ (0 - (v & 1));
+}
+/*---------------------------------------------------------------------------*/
+/* Sign-extend a 16 bit two's complement value to 32 bits */
+static uint32_t
+sext16(uint16_t v)
+{
+  return ((uint32_t)v ^ 0x8000UL) - 0x8000UL;
+}
+/*---------------------------------------------------------------------------*/
+/* Remember r as the previous reading. Absent fields keep their last value,
+   so both sides agree whatever the caller left in them */
+static void
+delta_update(struct msg_delta *d, const struct msg_reading *r)
+{
+  d->prev.counter = r->counter;
+  d->prev.fields = r->fields;
+  d->prev.mode = r->mode;
+  if(r->fields & MSG_F_BATTERY) {
+    d->prev.battery = r->battery;
+  }
+  if(r->fields & MSG_F_DATA_RATE) {
+    d->prev.data_rate = r->data_rate;
+  }
+  if(r->fields & MSG_F_AGE) {
+    d->prev.age = r->age;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+delta_init(struct msg_delta *d, const struct msg_reading *first)
+{
+  d->prev.battery = 0;
+  d->prev.data_rate = 0;
+  d->prev.age = 0;
+  delta_update(d, first);
+  d->counter_delta = 1;
+  d->battery_delta = 0;
+  d->age_delta = 0;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+put_delta(uint8_t *buf, uint8_t len, struct msg_delta *d,
+          const struct msg_reading *r)
+{
+  uint8_t changed;
+  uint8_t pos = 0;
+  uint8_t n;
+  uint16_t delta;
+  uint32_t delta32;
+
+  changed = r->fields != d->prev.fields || r->mode != d->prev.mode;
+  delta = (uint16_t)(r->counter - d->prev.counter);
+  n = msg_put_varint(buf, len,
+                     (zigzag(sext16((uint16_t)(delta - d->counter_delta)))
+                      << 1) | changed);
+  if(n == 0) {
+    return 0;
+  }
+  pos += n;
+  d->counter_delta = delta;
+
+  if(changed) {
+    if(pos >= len) {
+      return 0;
+    }
+    buf[pos++] = (r->fields << 4) | (r->mode & 0x0f);
+  }
+
+  if(r->fields & MSG_F_BATTERY) {
+    delta = (uint16_t)(r->battery - d->prev.battery);
+    n = msg_put_varint(&buf[pos], len - pos,
+                       zigzag(sext16((uint16_t)(delta - d->battery_delta))));
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+    d->battery_delta = delta;
+  }
+
+  if(r->fields & MSG_F_DATA_RATE) {
+    delta32 = r->data_rate - d->prev.data_rate;
+    n = msg_put_varint(&buf[pos], len - pos, zigzag(delta32));
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(r->fields & MSG_F_AGE) {
+    delta32 = r->age - d->prev.age;
+    n = msg_put_varint(&buf[pos], len - pos, zigzag(delta32 - d->age_delta));
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+    d->age_delta = delta32;
+  }
+
+  delta_update(d, r);
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+get_delta(const uint8_t *buf, uint16_t len, struct msg_delta *d,
+          struct msg_reading *r)
+{
+  uint16_t pos = 0;
+  uint8_t n;
+  uint32_t v;
+
+  n = msg_get_varint(buf, len, &v);
+  if(n == 0) {
+    return 0;
+  }
+  pos += n;
+  d->counter_delta = (uint16_t)(d->counter_delta + unzigzag(v >> 1));
+  r->counter = (uint16_t)(d->prev.counter + d->counter_delta);
+
+  if(v & 1) {
+    if(pos >= len) {
+      return 0;
+    }
+    r->fields = buf[pos] >> 4;
+    r->mode = buf[pos] & 0x0f;
+    pos++;
+  } else {
+    r->fields = d->prev.fields;
+    r->mode = d->prev.mode;
+  }
+  r->battery = 0;
+  r->data_rate = 0;
+  r->age = 0;
+
+  if(r->fields & MSG_F_BATTERY) {
+    n = msg_get_varint(&buf[pos], len - pos, &v);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+    d->battery_delta = (uint16_t)(d->battery_delta + unzigzag(v));
+    r->battery = (uint16_t)(d->prev.battery + d->battery_delta);
+  }
+
+  if(r->fields & MSG_F_DATA_RATE) {
+    n = msg_get_varint(&buf[pos], len - pos, &v);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+    r->data_rate = d->prev.data_rate + unzigzag(v);
+  }
+
+  if(r->fields & MSG_F_AGE) {
+    n = msg_get_varint(&buf[pos], len - pos, &v);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+    d->age_delta += unzigzag(v);
+    r->age = d->prev.age + d->age_delta;
+  }
+
+  delta_update(d, r);
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_encode_batch_delta(uint8_t *buf, uint8_t len, const struct msg_reading *r,
+                       uint8_t num, uint8_t *out_len)
+{
+  struct msg_delta d;
+  uint8_t pos;
+  uint8_t i;
+  uint8_t n;
+
+  if(len < MSG_BATCH_HDR_LEN || num == 0) {
+    return 0;
+  }
+  pos = MSG_BATCH_HDR_LEN;
+  n = put_reading(&buf[pos], len - pos, &r[0]);
+  if(n == 0) {
+    return 0;
+  }
+  pos += n;
+  delta_init(&d, &r[0]);
+
+  for(i = 1; i < num; i++) {
+    n = put_delta(&buf[pos], len - pos, &d, &r[i]);
+    if(n == 0) {
+      break;
+    }
+    pos += n;
+  }
+  buf[0] = (MSG_VERSION << 4) | MSG_TYPE_BATCH_DELTA;
+  buf[1] = i;
+  *out_len = pos;
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_cursor_init(struct msg_cursor *c, const uint8_t *buf, uint16_t len)
+{
+  c->buf = buf;
+  c->len = len;
+  c->next = 0;
+  c->type = msg_type(buf, len);
+  switch(c->type) {
+  case MSG_TYPE_READING:
+    c->pos = 1;
+    c->num = 1;
+    break;
+  case MSG_TYPE_BATCH:
+  case MSG_TYPE_BATCH_DELTA:
+    c->pos = MSG_BATCH_HDR_LEN;
+    c->num = len < MSG_BATCH_HDR_LEN ? 0 : buf[1];
+    break;
+  default:
+    c->num = 0;
+    break;
+  }
+  return c->num;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_cursor_next(struct msg_cursor *c, struct msg_reading *r)
+{
+  uint8_t n;
+
+  if(c->next >= c->num) {
+    return 0;
+  }
+  /* The first reading of a delta batch is always sent in full */
+  if(c->type == MSG_TYPE_BATCH_DELTA && c->next > 0) {
+    n = get_delta(&c->buf[c->pos], c->len - c->pos, &c->delta, r);
+  } else {
+    n = get_reading(&c->buf[c->pos], c->len - c->pos, r);
+  }
+  if(n == 0) {
+    return 0;
+  }
+  if(c->type == MSG_TYPE_BATCH_DELTA && c->next == 0) {
+    delta_init(&c->delta, r);
+  }
+  c->pos += n;
+  c->next++;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_decode_batch(const uint8_t *buf, uint16_t len, struct msg_reading *r,
+                 uint8_t max)
+{
+  struct msg_cursor c;
+  uint8_t i;
+
+  if(msg_type(buf, len) == MSG_TYPE_READING ||
+     msg_cursor_init(&c, buf, len) == 0 || c.num > max) {
+    return 0;
+  }
+  for(i = 0; i < c.num; i++) {
+    if(!msg_cursor_next(&c, &r[i])) {
+      return 0;
+    }
+  }
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+put_int16s(uint8_t *buf, uint8_t len, const int16_t *v, uint8_t num)
+{
+  uint8_t pos = 0;
+  uint8_t i;
+  uint8_t n;
+
+  for(i = 0; i < num; i++) {
+    n = msg_put_varint(&buf[pos], len - pos, zigzag((uint32_t)(int32_t)v[i]));
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+get_int16s(const uint8_t *buf, uint16_t len, int16_t *v, uint8_t num)
+{
+  uint8_t pos = 0;
+  uint8_t i;
+  uint8_t n;
+  uint32_t u;
+
+  for(i = 0; i < num; i++) {
+    n = msg_get_varint(&buf[pos], len - pos, &u);
+    if(n == 0) {
+      return 0;
+    }
+    /* Only values that sign-extend from 16 bits */
+    u = unzigzag(u);
+    if((uint32_t)(u + 0x8000UL) > 0xffffUL) {
+      return 0;
+    }
+    v[i] = u < 0x8000UL ? (int16_t)u :
+      (int16_t)((int32_t)(u & 0xffffUL) - 0x10000L);
+    pos += n;
+  }
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_encode_control(uint8_t *buf, uint8_t len, const struct msg_control *c)
+{
+  uint8_t pos;
+  uint8_t n;
+
+  if(len < 4) {
+    return 0;
+  }
+  buf[0] = (MSG_VERSION << 4) | MSG_TYPE_CONTROL;
+  buf[1] = c->epoch;
+  buf[2] = c->seq;
+  buf[3] = c->cmds;
+  pos = 4;
+
+  if(c->cmds & MSG_C_INTERVAL) {
+    n = msg_put_varint(&buf[pos], len - pos, c->interval);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(c->cmds & MSG_C_THRESHOLDS) {
+    n = put_int16s(&buf[pos], len - pos, c->thresholds, MSG_C_THRESH_LEN);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(c->cmds & MSG_C_PARAM) {
+    n = put_int16s(&buf[pos], len - pos, c->param, MSG_C_PARAM_LEN);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(c->cmds & MSG_C_FEATURE) {
+    n = put_int16s(&buf[pos], len - pos, c->feature, MSG_C_FEATURE_LEN);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(c->cmds & MSG_C_TIME) {
+    n = msg_put_varint(&buf[pos], len - pos, c->time);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_decode_control(const uint8_t *buf, uint16_t len, struct msg_control *c)
+{
+  uint8_t pos;
+  uint8_t n;
+
+  if(msg_type(buf, len) != MSG_TYPE_CONTROL || len < 4) {
+    return 0;
+  }
+  c->epoch = buf[1];
+  c->seq = buf[2];
+  c->cmds = buf[3];
+  pos = 4;
+
+  if(c->cmds & MSG_C_INTERVAL) {
+    n = msg_get_varint(&buf[pos], len - pos, &c->interval);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(c->cmds & MSG_C_THRESHOLDS) {
+    n = get_int16s(&buf[pos], len - pos, c->thresholds, MSG_C_THRESH_LEN);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(c->cmds & MSG_C_PARAM) {
+    n = get_int16s(&buf[pos], len - pos, c->param, MSG_C_PARAM_LEN);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(c->cmds & MSG_C_FEATURE) {
+    n = get_int16s(&buf[pos], len - pos, c->feature, MSG_C_FEATURE_LEN);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  if(c->cmds & MSG_C_TIME) {
+    n = msg_get_varint(&buf[pos], len - pos, &c->time);
+    if(n == 0) {
+      return 0;
+    }
+    pos += n;
+  }
+
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_encode_control_ack(uint8_t *buf, uint8_t len, uint8_t epoch, uint8_t seq)
+{
+  if(len < MSG_CONTROL_ACK_LEN) {
+    return 0;
+  }
+  buf[0] = (MSG_VERSION << 4) | MSG_TYPE_CONTROL_ACK;
+  buf[1] = epoch;
+  buf[2] = seq;
+  return MSG_CONTROL_ACK_LEN;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_decode_control_ack(const uint8_t *buf, uint16_t len, uint8_t *epoch,
+                       uint8_t *seq)
+{
+  if(msg_type(buf, len) != MSG_TYPE_CONTROL_ACK ||
+     len < MSG_CONTROL_ACK_LEN) {
+    return 0;
+  }
+  *epoch = buf[1];
+  *seq = buf[2];
+  return MSG_CONTROL_ACK_LEN;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_encode_ack(uint8_t *buf, uint8_t len, uint16_t cumulative,
+               uint32_t bitmap)
+{
+  uint8_t pos;
+  uint8_t n;
+
+  if(len < 1) {
+    return 0;
+  }
+  buf[0] = (MSG_VERSION << 4) | MSG_TYPE_ACK;
+  pos = 1;
+
+  n = msg_put_varint(&buf[pos], len - pos, cumulative);
+  if(n == 0) {
+    return 0;
+  }
+  pos += n;
+
+  n = msg_put_varint(&buf[pos], len - pos, bitmap);
+  if(n == 0) {
+    return 0;
+  }
+  return pos + n;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_decode_ack(const uint8_t *buf, uint16_t len, uint16_t *cumulative,
+               uint32_t *bitmap)
+{
+  uint8_t pos;
+  uint8_t n;
+  uint32_t v;
+
+  if(msg_type(buf, len) != MSG_TYPE_ACK) {
+    return 0;
+  }
+  pos = 1;
+
+  n = msg_get_varint(&buf[pos], len - pos, &v);
+  if(n == 0 || v > 0xffff) {
+    return 0;
+  }
+  *cumulative = (uint16_t)v;
+  pos += n;
+
+  n = msg_get_varint(&buf[pos], len - pos, bitmap);
+  if(n == 0) {
+    return 0;
+  }
+  return pos + n;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_encode_slot(uint8_t *buf, uint8_t len, uint32_t frame, uint32_t delay)
+{
+  uint8_t pos;
+  uint8_t n;
+
+  if(len < 1) {
+    return 0;
+  }
+  buf[0] = (MSG_VERSION << 4) | MSG_TYPE_SLOT;
+  pos = 1;
+
+  n = msg_put_varint(&buf[pos], len - pos, frame);
+  if(n == 0) {
+    return 0;
+  }
+  pos += n;
+
+  n = msg_put_varint(&buf[pos], len - pos, delay);
+  if(n == 0) {
+    return 0;
+  }
+  return pos + n;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msg_decode_slot(const uint8_t *buf, uint16_t len, uint32_t *frame,
+                uint32_t *delay)
+{
+  uint8_t pos;
+  uint8_t n;
+
+  if(msg_type(buf, len) != MSG_TYPE_SLOT) {
+    return 0;
+  }
+  pos = 1;
+
+  n = msg_get_varint(&buf[pos], len - pos, frame);
+  if(n == 0 || *frame == 0) {
+    return 0;
+  }
+  pos += n;
+
+  n = msg_get_varint(&buf[pos], len - pos, delay);
+  if(n == 0 || *delay >= *frame) {
+    return 0;
+  }
+  return pos + n;
+}
+/*---------------------------------------------------------------------------*/
+const char *
+msg_mode_name(uint8_t mode)
+{
+  if(mode >= MSG_MODE_NUM) {
+    return "Unknown";
+  }
+  return mode_names[mode];
+}
+/*---------------------------------------------------------------------------*/
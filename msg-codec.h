@@ -0,0 +1,388 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Compact, versioned wire format for the client readings.
+ *
+ *         Replaces sending struct my_meddelande_t as-is (81 bytes, 73 of
+ *         them the mode string). A reading is encoded as:
+ *
+ *           byte 0   version (high nibble) | message type (low nibble)
+ *           byte 1   field bitmask (high nibble) | mode (low nibble)
+ *           varint   counter
+ *           2 bytes  battery in mV, little endian    (MSG_F_BATTERY)
+ *           varint   data rate in clock ticks         (MSG_F_DATA_RATE)
+ *           varint   age in seconds, for readings sent
+ *                    later than they were taken        (MSG_F_AGE)
+ *
+ *         MSG_F_BACKLOG has no bytes. It marks a reading drained from the
+ *         node's flash log that was taken before the node last rebooted,
+ *         so its age is unknown. Such a reading says nothing about the
+ *         node's current state or timing.
+ *
+ *         A batch carries several readings in one datagram:
+ *
+ *           byte 0   version (high nibble) | MSG_TYPE_BATCH
+ *           byte 1   number of readings
+ *           ...      readings as above, without the first byte
+ *
+ *         A delta batch (MSG_TYPE_BATCH_DELTA) has the same header and the
+ *         first reading in full. Every following reading is coded against
+ *         the previous one, since the values change slowly between samples:
+ *
+ *           varint   zigzag(delta-of-delta of counter) << 1 | header changed
+ *           byte     field bitmask | mode, only if the header changed
+ *           varint   zigzag(delta-of-delta of battery)   (MSG_F_BATTERY)
+ *           varint   zigzag(delta of data rate)          (MSG_F_DATA_RATE)
+ *           varint   zigzag(delta-of-delta of age)       (MSG_F_AGE)
+ *
+ *         A typical reading then takes 3 bytes instead of 7. Encoding and
+ *         decoding are a single pass with constant work per reading.
+ *
+ *         The sink answers an uplink with a control message when it has
+ *         new settings for the node, while the node is still listening:
+ *
+ *           byte 0   version (high nibble) | MSG_TYPE_CONTROL
+ *           byte 1   epoch, the sink's boot number
+ *           byte 2   sequence number
+ *           byte 3   command bitmask
+ *           varint   send interval in clock ticks, 0 for
+ *                    the LQ controller                  (MSG_C_INTERVAL)
+ *           4 varint zigzag crit, low, high, hyst in mV  (MSG_C_THRESHOLDS)
+ *           3 varint zigzag LQ gains, param_vector       (MSG_C_PARAM)
+ *           4 varint zigzag LQ state, feature_vector     (MSG_C_FEATURE)
+ *           varint   sink's time of day in seconds       (MSG_C_TIME)
+ *
+ *         and the node confirms it with a control ack:
+ *
+ *           byte 0   version (high nibble) | MSG_TYPE_CONTROL_ACK
+ *           byte 1   epoch of the message applied
+ *           byte 2   sequence number applied
+ *
+ *         The sequence number restarts when the sink reboots, so a node
+ *         tells settings apart by epoch and sequence number together.
+ *
+ *         The sink acks the reading counters it has received after each
+ *         uplink, so the node can resend the readings that were lost:
+ *
+ *           byte 0   version (high nibble) | MSG_TYPE_ACK
+ *           varint   cumulative counter, every reading up to it is done
+ *           varint   bitmap, bit i set if counter + 1 + i was received
+ *
+ *         When an uplink arrives outside the node's transmission slot the
+ *         sink tells the node where its slot is:
+ *
+ *           byte 0   version (high nibble) | MSG_TYPE_SLOT
+ *           varint   slot frame in clock ticks
+ *           varint   clock ticks from now to the start of the node's slot
+ *
+ *         Varints are unsigned LEB128. The codec has no Contiki
+ *         dependencies so the same file is built on the motes and on the
+ *         host tools.
+ */
+
+#ifndef MSG_CODEC_H_
+#define MSG_CODEC_H_
+
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------*/
+#define MSG_VERSION               1
+
+/* Message types, low nibble of the first byte */
+#define MSG_TYPE_READING          0
+#define MSG_TYPE_BATCH            1
+#define MSG_TYPE_BATCH_DELTA      2
+#define MSG_TYPE_CONTROL          3
+#define MSG_TYPE_CONTROL_ACK      4
+#define MSG_TYPE_ACK              5
+#define MSG_TYPE_SLOT             6
+
+/* Optional fields present in a reading */
+#define MSG_F_BATTERY             0x01
+#define MSG_F_DATA_RATE           0x02
+#define MSG_F_AGE                 0x04
+#define MSG_F_BACKLOG             0x08
+
+/* Readings sent later than they were taken, with or without an age */
+#define MSG_F_DELAYED             (MSG_F_AGE | MSG_F_BACKLOG)
+
+/* Commands present in a control message */
+#define MSG_C_INTERVAL            0x01
+#define MSG_C_THRESHOLDS          0x02
+#define MSG_C_PARAM               0x04
+#define MSG_C_FEATURE             0x08
+#define MSG_C_TIME                0x10
+
+/* Entries of the control vectors, same layout as in lqt.h */
+#define MSG_C_THRESH_LEN          4   /* crit, low, high, hyst */
+#define MSG_C_PARAM_LEN           3
+#define MSG_C_FEATURE_LEN         4
+
+/* Worst case size of an encoded reading, header byte included */
+#define MSG_READING_MAX_LEN       (2 + 3 + 2 + 5 + 5)
+
+/* Size of the batch header */
+#define MSG_BATCH_HDR_LEN         2
+
+/* Most readings a receiver accepts in one batch */
+#define MSG_BATCH_MAX             16
+
+/* Worst case size of a control message and size of its ack */
+#define MSG_CONTROL_MAX_LEN       (4 + 5 + 3 * (MSG_C_THRESH_LEN + \
+                                   MSG_C_PARAM_LEN + MSG_C_FEATURE_LEN) + 5)
+#define MSG_CONTROL_ACK_LEN       3
+
+/* Worst case size of a reading ack and the counters its bitmap covers */
+#define MSG_ACK_MAX_LEN           (1 + 3 + 5)
+#define MSG_ACK_WINDOW            32
+
+/* Worst case size of a slot message */
+#define MSG_SLOT_MAX_LEN          (1 + 5 + 5)
+
+/* Energy modes, replaces the mode string of my_meddelande_t */
+enum msg_mode {
+  MSG_MODE_NORMAL_OP = 0,
+  MSG_MODE_LO_BAT,
+  MSG_MODE_HI_BAT,
+  MSG_MODE_SLEEP,
+  MSG_MODE_NUM
+};
+
+/* Decoded reading */
+struct msg_reading {
+  uint8_t  mode;
+  uint8_t  fields;
+  uint16_t counter;
+  uint16_t battery;
+  uint32_t data_rate;
+  uint32_t age;
+};
+
+/* Decoded control message, only the commands set in cmds are valid */
+struct msg_control {
+  uint8_t  epoch;
+  uint8_t  seq;
+  uint8_t  cmds;
+  uint32_t interval;
+  int16_t  thresholds[MSG_C_THRESH_LEN];
+  int16_t  param[MSG_C_PARAM_LEN];
+  int16_t  feature[MSG_C_FEATURE_LEN];
+  uint32_t time;
+};
+
+/* Delta coding state, the previous reading and its deltas. The deltas are
+   two's complement in unsigned types, so wrapping them is defined */
+struct msg_delta {
+  struct msg_reading prev;
+  uint16_t counter_delta;
+  uint16_t battery_delta;
+  uint32_t age_delta;
+};
+
+/* Walks the readings of a received payload where it lies, see
+   msg_cursor_init() */
+struct msg_cursor {
+  const uint8_t *buf;
+  uint16_t len;
+  uint16_t pos;
+  int8_t   type;
+  uint8_t  num;              /* Readings the payload claims to hold */
+  uint8_t  next;             /* Readings decoded so far */
+  struct msg_delta delta;
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Encode a reading, including the version/type header
+ * \param buf  Output buffer
+ * \param len  Size of the output buffer
+ * \param r    Reading to encode, only the fields set in r->fields are sent
+ * \return     Number of bytes written, 0 if the buffer is too small
+ */
+uint8_t msg_encode_reading(uint8_t *buf, uint8_t len,
+                           const struct msg_reading *r);
+
+/**
+ * \brief      Decode a reading, including the version/type header
+ * \param buf  Received payload
+ * \param len  Length of the received payload
+ * \param r    Decoded reading, absent fields are set to 0
+ * \return     Number of bytes consumed, 0 if the payload is malformed
+ */
+uint8_t msg_decode_reading(const uint8_t *buf, uint16_t len,
+                           struct msg_reading *r);
+
+/**
+ * \brief      Message type of a received payload
+ * \return     MSG_TYPE_*, or -1 if the payload is not of our version
+ */
+int8_t msg_type(const uint8_t *buf, uint16_t len);
+
+/**
+ * \brief      Encode a batch of readings into one datagram
+ * \param buf  Output buffer
+ * \param len  Size of the output buffer, e.g. the room left in one frame
+ * \param r    Readings to encode
+ * \param num  Number of readings in r
+ * \param out_len Number of bytes written
+ * \return     Number of readings that fit, 0 if none did
+ */
+uint8_t msg_encode_batch(uint8_t *buf, uint8_t len,
+                         const struct msg_reading *r, uint8_t num,
+                         uint8_t *out_len);
+
+/**
+ * \brief      Encode a batch of readings as a delta batch
+ *
+ *             Same as msg_encode_batch(), see the format above.
+ */
+uint8_t msg_encode_batch_delta(uint8_t *buf, uint8_t len,
+                               const struct msg_reading *r, uint8_t num,
+                               uint8_t *out_len);
+
+/**
+ * \brief      Decode a batch or a delta batch of readings
+ * \param buf  Received payload
+ * \param len  Length of the received payload
+ * \param r    Decoded readings
+ * \param max  Room in r
+ * \return     Number of readings decoded, 0 if the payload is malformed
+ */
+uint8_t msg_decode_batch(const uint8_t *buf, uint16_t len,
+                         struct msg_reading *r, uint8_t max);
+
+/**
+ * \brief      Start walking the readings of a received payload
+ * \param c    Cursor
+ * \param buf  Received payload, e.g. uip_appdata, must stay put while
+ *             the cursor is used
+ * \param len  Length of the received payload
+ * \return     Number of readings the payload claims to hold, 0 if it is
+ *             not a reading or batch
+ *
+ *             Decodes one reading at a time straight from buf, so a
+ *             receiver needs no room for a whole batch. Every read is
+ *             checked against len.
+ */
+uint8_t msg_cursor_init(struct msg_cursor *c, const uint8_t *buf,
+                        uint16_t len);
+
+/**
+ * \brief      Decode the next reading
+ * \param c    Cursor
+ * \param r    Decoded reading
+ * \return     1, or 0 at the end or if the rest of the payload is
+ *             malformed, c->next < c->num tells the two apart
+ */
+uint8_t msg_cursor_next(struct msg_cursor *c, struct msg_reading *r);
+
+/**
+ * \brief      Encode a control message
+ * \param buf  Output buffer
+ * \param len  Size of the output buffer
+ * \param c    Control message, only the commands set in c->cmds are sent
+ * \return     Number of bytes written, 0 if the buffer is too small
+ */
+uint8_t msg_encode_control(uint8_t *buf, uint8_t len,
+                           const struct msg_control *c);
+
+/**
+ * \brief      Decode a control message
+ * \return     Number of bytes consumed, 0 if the payload is malformed
+ */
+uint8_t msg_decode_control(const uint8_t *buf, uint16_t len,
+                           struct msg_control *c);
+
+/**
+ * \brief      Encode the ack of a control message
+ * \return     Number of bytes written, 0 if the buffer is too small
+ */
+uint8_t msg_encode_control_ack(uint8_t *buf, uint8_t len, uint8_t epoch,
+                               uint8_t seq);
+
+/**
+ * \brief      Decode the ack of a control message
+ * \return     Number of bytes consumed, 0 if the payload is malformed
+ */
+uint8_t msg_decode_control_ack(const uint8_t *buf, uint16_t len,
+                               uint8_t *epoch, uint8_t *seq);
+
+/**
+ * \brief      Encode a reading ack
+ * \param buf  Output buffer
+ * \param len  Size of the output buffer
+ * \param cumulative Every counter up to this one is done
+ * \param bitmap Bit i set if counter cumulative + 1 + i was received
+ * \return     Number of bytes written, 0 if the buffer is too small
+ */
+uint8_t msg_encode_ack(uint8_t *buf, uint8_t len, uint16_t cumulative,
+                       uint32_t bitmap);
+
+/**
+ * \brief      Decode a reading ack
+ * \return     Number of bytes consumed, 0 if the payload is malformed
+ */
+uint8_t msg_decode_ack(const uint8_t *buf, uint16_t len,
+                       uint16_t *cumulative, uint32_t *bitmap);
+
+/**
+ * \brief      Encode a slot message
+ * \param buf  Output buffer
+ * \param len  Size of the output buffer
+ * \param frame Slot frame in clock ticks
+ * \param delay Clock ticks from now to the start of the node's slot
+ * \return     Number of bytes written, 0 if the buffer is too small
+ */
+uint8_t msg_encode_slot(uint8_t *buf, uint8_t len, uint32_t frame,
+                        uint32_t delay);
+
+/**
+ * \brief      Decode a slot message
+ * \return     Number of bytes consumed, 0 if the payload is malformed
+ */
+uint8_t msg_decode_slot(const uint8_t *buf, uint16_t len, uint32_t *frame,
+                        uint32_t *delay);
+
+/**
+ * \brief      Append an unsigned LEB128 varint
+ * \return     Number of bytes written, 0 if it does not fit
+ */
+uint8_t msg_put_varint(uint8_t *buf, uint8_t len, uint32_t value);
+
+/**
+ * \brief      Read an unsigned LEB128 varint of at most 5 bytes
+ * \return     Number of bytes consumed, 0 if truncated, too long or over
+ *             32 bits
+ */
+uint8_t msg_get_varint(const uint8_t *buf, uint16_t len, uint32_t *value);
+
+/**
+ * \brief      Printable name of an energy mode, as used in the old strings
+ */
+const char *msg_mode_name(uint8_t mode);
+/*---------------------------------------------------------------------------*/
+#endif /* MSG_CODEC_H_ */
@@ -33,7 +33,9 @@
 
 
 /* If using cooja to simulate set this to 1 */ 
+#ifndef COOJA_SIM
 #define COOJA_SIM 0
+#endif
 
 #define UIP_CONF_IPV6_RPL 1
 
@@ -55,23 +57,76 @@
 #endif 
 #endif 
 
+/* The sink queues received frames ahead of 6LoWPAN, see
+   udp-server-test/rx-queue.h. The clients leave this unset */
+#if WITH_RX_QUEUE
+#undef NETSTACK_CONF_NETWORK
+#define NETSTACK_CONF_NETWORK rx_queue_driver
+#endif
+
 /* Enable MCU sleep when no radio activity is occuring */ 
 #undef RDC_CONF_MCU_SLEEP
 #define RDC_CONF_MCU_SLEEP           0
 
 
-/* Set rdc channel check rate to 4 Hz */
+/* Set rdc channel check rate to 4 Hz. It must be the same on all nodes,
+   the clients adapt their listening per energy mode in rdc-profile.c */
 #undef NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE
 #define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE 4
 
+/* Energest is used to measure the listen time per rdc profile */
+#ifndef ENERGEST_CONF_ON
+#define ENERGEST_CONF_ON 1
+#endif
 
-#undef IEEE802154_CONF_PANID
-#define IEEE802154_CONF_PANID      0xABCD
 
-#ifndef QUEUEBUF_CONF_NUM
-#define QUEUEBUF_CONF_NUM          4
+/* The sink acks the readings and the clients resend the lost ones. Set to
+   0 for fire-and-forget, to compare delivery ratio and energy */
+#ifndef WITH_RETX
+#define WITH_RETX 1
 #endif
 
+
+/* Server address, the same on the sink and the clients. It sets how much
+   of the destination address 6LoWPAN carries inline, tools/lowpan-audit
+   shows the effect in a capture:
+     SERVER_ADDR_64   prefix::1, 8 bytes
+     SERVER_ADDR_16   prefix::ff:fe00:1, 2 bytes
+     SERVER_ADDR_MAC  derived from the sink's MAC address, no bytes on the
+                      last hop but 8 on the hops before it */
+#define SERVER_ADDR_64             1
+#define SERVER_ADDR_16             2
+#define SERVER_ADDR_MAC            3
+#ifndef SERVER_ADDR_MODE
+#define SERVER_ADDR_MODE           SERVER_ADDR_16
+#endif
+
+/* Most header bytes of a reading datagram: 802.15.4 header with long
+   addresses and FCS 23, IPHC with context byte and next header inline 4,
+   RPL hop-by-hop option 8, UDP 8, the source 8 once forwarded and the
+   destination as above */
+#if SERVER_ADDR_MODE == SERVER_ADDR_16
+#define FRAME_DST_MAX              2
+#else
+#define FRAME_DST_MAX              8
+#endif
+#define FRAME_HDR_MAX              (23 + 4 + 8 + 8 + 8 + FRAME_DST_MAX)
+#define FRAME_PAYLOAD_MAX          (127 - FRAME_HDR_MAX)
+
+/* Build with WITH_ONE_FRAME=1 to size the reading batches for the worst
+   case above instead of the one-hop header, and turn off fragmentation so
+   anything larger fails to send instead of taking two frames */
+#ifndef WITH_ONE_FRAME
+#define WITH_ONE_FRAME             0
+#endif
+#if WITH_ONE_FRAME
+#undef SICSLOWPAN_CONF_FRAG
+#define SICSLOWPAN_CONF_FRAG       0
+#endif
+
+#undef IEEE802154_CONF_PANID
+#define IEEE802154_CONF_PANID      0xABCD
+
 #undef UIP_CONF_BUFFER_SIZE
 #define UIP_CONF_BUFFER_SIZE       256
 
@@ -102,24 +157,116 @@
 
 #define UIP_CONF_DS6_DEFAULT_PREFIX 0xfd00
 
+/* Build both sides with WITH_ENERGY_OF=1 to weigh the parents' residual
+   energy into RPL parent selection, see rpl-energy-of.h. The OCP is not
+   assigned by IANA, nodes running another OF will not join */
+#ifndef WITH_ENERGY_OF
+#define WITH_ENERGY_OF             0
+#endif
+#if WITH_ENERGY_OF
+#define RPL_OCP_ENERGY             0xe0
+#undef RPL_CONF_OF_OCP
+#define RPL_CONF_OF_OCP            RPL_OCP_ENERGY
+#undef RPL_CONF_SUPPORTED_OFS
+#define RPL_CONF_SUPPORTED_OFS     { &rpl_energy_of }
+#undef RPL_CONF_DAG_MC
+#define RPL_CONF_DAG_MC            RPL_DAG_MC_ENERGY
+#ifndef __ASSEMBLER__
+/* For the OF table in rpl-dag.c, which does not include our header */
+struct rpl_of;
+extern struct rpl_of rpl_energy_of;
+#endif
+#endif /* WITH_ENERGY_OF */
+
 /*-----------------------STOLEN FROM RPL-UDP EXAMPLE FIGURE OUT THINGS------*/
 #ifndef WITH_NON_STORING
 #define WITH_NON_STORING 0 /* Set this to run with non-storing mode */
 #endif /* WITH_NON_STORING */
 
+/* RAM profiles, RAM_PROFILE=sink on the server and leaf on the clients,
+   set by the Makefiles. Both leave out TCP, keep two UDP connections and
+   one DAG, and trade the rest between buffers, neighbors and routes. Cost
+   per entry, from the object sizes in contiki-z1.map at 10 neighbors and
+   10 routes:
+     neighbor          ~50 B  nbr-table, uip-ds6-nbr, link-stats, rpl-dag
+     route             ~45 B  uip-ds6-route, ~20 B as a non-storing link
+     queuebuf          180 B
+     fragment buffer   113 B  sicslowpan, 12 by default
+     UDP connection     26 B  uip6, 12 by default
+     node table entry   30 B  udp-server-test/node-table.h
+   The readings fit one frame, so few fragment buffers do.
+
+   Every node the sink serves costs it a route (~45 B, or ~20 B as a
+   non-storing link) and a node table entry (30 B), so ~75 B in storing
+   and ~50 B in non-storing mode. The map of the original sink build
+   leaves ~970 B above a 1 KB stack, and the profile frees some 600 B to
+   1 KB more by dropping TCP, connections and buffers. That pays for about
+   20 nodes in storing mode and 30 to 40 in non-storing mode, short of
+   the 100 and more wanted. 100 nodes would take ~7.5 kB in storing and ~5 kB
+   in non-storing mode, more than the whole budget. Beyond 20, use a
+   border router with more RAM or keep per-node state in the host
+   collector. These per-entry costs and totals are estimates from one map,
+   not measured for each profile. The Makefiles run tools/ram-gate.sh
+   after every z1 link and fail the build when .data+.bss leave less than
+   RAM_STACK bytes (default 1024) of the 8 KB, which is the real check */
+#define RAM_PROFILE_NONE           0
+#define RAM_PROFILE_SINK           1
+#define RAM_PROFILE_LEAF           2
+#ifndef RAM_PROFILE
+#define RAM_PROFILE                RAM_PROFILE_NONE
+#endif
+
+#if RAM_PROFILE != RAM_PROFILE_NONE
+#undef UIP_CONF_TCP
+#define UIP_CONF_TCP               0
+#undef UIP_CONF_UDP_CONNS
+#define UIP_CONF_UDP_CONNS         2
+#undef RPL_CONF_MAX_DAG_PER_INSTANCE
+#define RPL_CONF_MAX_DAG_PER_INSTANCE 1
+#endif
+
 #undef NBR_TABLE_CONF_MAX_NEIGHBORS
 #undef UIP_CONF_MAX_ROUTES
 
-
-#ifdef TEST_MORE_ROUTES
+#if RAM_PROFILE == RAM_PROFILE_SINK
+/* Children of the sink, and a route to each node in the node table.
+   The node table is sized on its own, so MAX_ROUTES builds change the
+   routes alone */
+#define NBR_TABLE_CONF_MAX_NEIGHBORS     12
+#define ROUTE_NUM                        20
+#define NODE_TABLE_CONF_SIZE             20
+#undef SICSLOWPAN_CONF_FRAGMENT_BUFFERS
+#define SICSLOWPAN_CONF_FRAGMENT_BUFFERS 2
+#define SINK_LOG_CONF_NUM                16
+#ifndef QUEUEBUF_CONF_NUM
+#define QUEUEBUF_CONF_NUM                3
+#endif
+#elif RAM_PROFILE == RAM_PROFILE_LEAF
+/* A parent, a few candidates, and routes for a few children */
+#define NBR_TABLE_CONF_MAX_NEIGHBORS     8
+#define ROUTE_NUM                        4
+#undef SICSLOWPAN_CONF_FRAGMENT_BUFFERS
+#define SICSLOWPAN_CONF_FRAGMENT_BUFFERS 4
+#elif defined TEST_MORE_ROUTES
 /* configure number of neighbors and routes */
 #define NBR_TABLE_CONF_MAX_NEIGHBORS     10
-#define UIP_CONF_MAX_ROUTES   30
+#define ROUTE_NUM                        30
 #else
 /* configure number of neighbors and routes */
 #define NBR_TABLE_CONF_MAX_NEIGHBORS     10
-#define UIP_CONF_MAX_ROUTES   10
-#endif /* TEST_MORE_ROUTES */
+#define ROUTE_NUM                        10
+#endif /* RAM_PROFILE */
+
+#ifdef MAX_ROUTES
+/* Set on the make command line, e.g. by tools/rpl-bench.sh */
+#undef ROUTE_NUM
+#define ROUTE_NUM                        MAX_ROUTES
+#endif
+#define UIP_CONF_MAX_ROUTES              ROUTE_NUM
+
+#ifndef QUEUEBUF_CONF_NUM
+#define QUEUEBUF_CONF_NUM                4
+#endif
 
 //#undef NULLRDC_CONF_802154_AUTOACK
 //#define NULLRDC_CONF_802154_AUTOACK       1
@@ -134,13 +281,44 @@
 
 #if WITH_NON_STORING
 #undef RPL_NS_CONF_LINK_NUM
-#define RPL_NS_CONF_LINK_NUM 10 /* Number of links maintained at the root. Can be set to 0 at non-root nodes. */
+#if RAM_PROFILE == RAM_PROFILE_LEAF
+#define RPL_NS_CONF_LINK_NUM 0
+#else
+#define RPL_NS_CONF_LINK_NUM ROUTE_NUM /* Number of links maintained at the root. Can be set to 0 at non-root nodes. */
+#endif
 #undef UIP_CONF_MAX_ROUTES
 #define UIP_CONF_MAX_ROUTES 0 /* No need for routes */
 #undef RPL_CONF_MOP
 #define RPL_CONF_MOP RPL_MOP_NON_STORING /* Mode of operation*/
 #endif /* WITH_NON_STORING */
 
+/* Build with WITH_RPL_BENCH=1 for the routing and duty cycle counters of
+   tools/rpl-bench.sh, see rpl-bench.h */
+#ifndef WITH_RPL_BENCH
+#define WITH_RPL_BENCH 0
+#endif
+#if WITH_RPL_BENCH
+#undef UIP_CONF_STATISTICS
+#define UIP_CONF_STATISTICS 1
+#undef RPL_CONF_STATS
+#define RPL_CONF_STATS 1
+#undef NETSTACK_CONF_MAC
+#define NETSTACK_CONF_MAC rpl_bench_mac_driver
+#endif
+
+/* The sink counts every frame its MAC takes in for the link histograms,
+   see udp-server-test/link-hist.h. The clients leave this unset */
+#ifndef WITH_LINK_HIST
+#define WITH_LINK_HIST 0
+#endif
+#if WITH_LINK_HIST
+#if WITH_RPL_BENCH
+#define LINK_HIST_CONF_MAC rpl_bench_mac_driver
+#endif
+#undef NETSTACK_CONF_MAC
+#define NETSTACK_CONF_MAC link_hist_mac_driver
+#endif
+
 /*.-------------------------------------------------------------------------'*/
 
 /*---------------------------------------------------------------------------*/
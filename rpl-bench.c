@@ -0,0 +1,176 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "sys/ctimer.h"
+#include "sys/energest.h"
+#include "net/ip/uip.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/mac/csma.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/rpl/rpl.h"
+#include "net/rpl/rpl-private.h"
+#if RPL_WITH_NON_STORING
+#include "net/rpl/rpl-ns.h"
+#endif
+#include "rpl-bench.h"
+
+#include <stdio.h>
+
+#define UIP_IP_BUF                ((struct uip_ip_hdr *)&uip_buf[UIP_LLH_LEN])
+
+static struct ctimer timer;
+static uint16_t rpl_frames;
+static uint32_t rpl_bytes;
+static mac_callback_t upper_sent;
+static uint16_t mac_frames;
+static uint32_t mac_tx;
+/*---------------------------------------------------------------------------*/
+/* part of all in per mille, without overflowing 32 bits */
+static unsigned
+permille(unsigned long part, unsigned long all)
+{
+  all /= 1000;
+  return all > 0 ? part / all : 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+report(void *ptr)
+{
+  rpl_instance_t *instance;
+  unsigned long all;
+  unsigned links = 0;
+  rpl_rank_t rank = INFINITE_RANK;
+
+  ctimer_reset(&timer);
+
+  instance = rpl_get_default_instance();
+  if(instance != NULL && instance->current_dag != NULL) {
+    rank = instance->current_dag->rank;
+  }
+#if RPL_WITH_NON_STORING
+  links = rpl_ns_num_nodes();
+#endif
+
+  energest_flush();
+  all = energest_type_time(ENERGEST_TYPE_CPU) +
+        energest_type_time(ENERGEST_TYPE_LPM);
+
+  printf("BENCH %lu %u %u %u %u %u %u %u %u %u %lu %u %lu\n",
+         clock_seconds(), uip_stat.icmp.sent, uip_stat.icmp.recv,
+         permille(energest_type_time(ENERGEST_TYPE_LISTEN), all),
+         permille(energest_type_time(ENERGEST_TYPE_TRANSMIT), all),
+         rank, uip_ds6_route_num_routes(), links, rpl_stats.parent_switch,
+         rpl_frames, (unsigned long)rpl_bytes, mac_frames,
+         (unsigned long)mac_tx);
+}
+/*---------------------------------------------------------------------------*/
+/* The datagram being sent is still in uip_buf when 6LoWPAN hands its
+   frames to the MAC. Non-storing DAOs to the root carry a hop-by-hop
+   option first */
+static uint8_t
+is_rpl(void)
+{
+  uint8_t proto = UIP_IP_BUF->proto;
+  uint8_t *next = &uip_buf[UIP_LLH_LEN + UIP_IPH_LEN];
+
+  if(proto == UIP_PROTO_HBHO) {
+    proto = next[0];
+    next += (next[1] + 1) * 8;
+  }
+  return proto == UIP_PROTO_ICMP6 && next[0] == ICMP6_RPL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  csma_driver.init();
+}
+/*---------------------------------------------------------------------------*/
+/* CSMA reports how many transmissions a frame took once it is done with
+   it. 6LoWPAN is the only sender and passes the same callback for every
+   frame, so one saved callback serves the frames still queued */
+static void
+packet_sent(void *ptr, int status, int num_tx)
+{
+  mac_frames++;
+  mac_tx += num_tx;
+  mac_call_sent_callback(upper_sent, ptr, status, num_tx);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(mac_callback_t sent, void *ptr)
+{
+  if(is_rpl()) {
+    rpl_frames++;
+    rpl_bytes += packetbuf_totlen();
+  }
+  upper_sent = sent;
+  csma_driver.send(packet_sent, ptr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+input(void)
+{
+  csma_driver.input();
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  return csma_driver.on();
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(int keep_radio_on)
+{
+  return csma_driver.off(keep_radio_on);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+channel_check_interval(void)
+{
+  return csma_driver.channel_check_interval();
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_bench_init(void)
+{
+  ctimer_set(&timer, RPL_BENCH_PERIOD, report, NULL);
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver rpl_bench_mac_driver = {
+  "rpl-bench",
+  init,
+  send,
+  input,
+  on,
+  off,
+  channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
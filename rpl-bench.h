@@ -0,0 +1,74 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Routing and duty cycle counters for the storing against
+ *         non-storing benchmark, tools/rpl-bench.sh.
+ *
+ *         Every RPL_BENCH_PERIOD the node prints one line of totals since
+ *         boot:
+ *
+ *           BENCH <s> <icmp sent> <icmp received> <listen> <transmit>
+ *                 <rank> <routes> <links> <parent switches>
+ *                 <rpl frames> <rpl bytes> <mac frames> <mac transmissions>
+ *
+ *         ICMPv6 is all RPL control traffic in the benchmark, nothing
+ *         else pings. listen and transmit are the radio's share of the
+ *         time in per mille, from Energest. routes is the route table in
+ *         storing mode, links the source routing links the root keeps in
+ *         non-storing mode. rpl frames and bytes are the RPL control
+ *         frames handed to the MAC and their 6LoWPAN bytes, without the
+ *         MAC header and retransmissions, counted by rpl_bench_mac_driver
+ *         in front of CSMA. mac frames are all frames CSMA is done with and
+ *         mac transmissions the attempts they took, so the difference is
+ *         CSMA's retransmissions.
+ *
+ *         Build with WITH_RPL_BENCH=1, which also turns on the uIP and RPL
+ *         statistics it reads and puts rpl_bench_mac_driver in the stack.
+ */
+
+#ifndef RPL_BENCH_H_
+#define RPL_BENCH_H_
+
+#include "contiki.h"
+#include "net/mac/mac.h"
+
+/*---------------------------------------------------------------------------*/
+#ifdef RPL_BENCH_CONF_PERIOD
+#define RPL_BENCH_PERIOD          RPL_BENCH_CONF_PERIOD
+#else
+#define RPL_BENCH_PERIOD          (CLOCK_SECOND * 300UL)
+#endif
+/*---------------------------------------------------------------------------*/
+extern const struct mac_driver rpl_bench_mac_driver;
+
+/**
+ * \brief      Start printing the counters
+ */
+void rpl_bench_init(void);
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_BENCH_H_ */
@@ -0,0 +1,250 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "net/rpl/rpl.h"
+#include "net/rpl/rpl-private.h"
+#include "net/link-stats.h"
+#include "rpl-energy-of.h"
+
+#define DEBUG DEBUG_NONE
+#include "net/ip/uip-debug.h"
+
+#if !RPL_WITH_MC || RPL_DAG_MC != RPL_DAG_MC_ENERGY
+#error "rpl-energy-of needs RPL_CONF_DAG_MC RPL_DAG_MC_ENERGY, build with WITH_ENERGY_OF=1"
+#endif
+
+/* As in MRHOF: reject links and paths worse than these, and keep the
+   preferred parent unless another is this much better */
+#define MAX_LINK_METRIC           1024  /* ETX 8 */
+#define MAX_PATH_COST             32768 /* Path ETX 256 */
+#define PARENT_SWITCH_THRESHOLD   96    /* ETX 0.75 */
+
+/* Starts full, the client sets it once its battery is known */
+static uint8_t own_level = RPL_ENERGY_OF_MAINS;
+/*---------------------------------------------------------------------------*/
+void
+rpl_energy_of_set(uint8_t level)
+{
+  rpl_instance_t *instance;
+
+  if((level < RPL_ENERGY_OF_LOW) != (own_level < RPL_ENERGY_OF_LOW)) {
+    instance = rpl_get_default_instance();
+    if(instance != NULL) {
+      rpl_reset_dio_timer(instance);
+    }
+  }
+  own_level = level;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+rpl_energy_of_level(void)
+{
+  return own_level;
+}
+/*---------------------------------------------------------------------------*/
+static void
+reset(rpl_dag_t *dag)
+{
+  PRINTF("RPL: Reset energy OF\n");
+}
+/*---------------------------------------------------------------------------*/
+#if RPL_WITH_DAO_ACK
+static void
+dao_ack_callback(rpl_parent_t *p, int status)
+{
+  if(status == RPL_DAO_ACK_UNABLE_TO_ADD_ROUTE_AT_ROOT) {
+    return;
+  }
+  /* Punish a refused or lost DAO as ten lost packets, like MRHOF */
+  if(status >= RPL_DAO_ACK_UNABLE_TO_ACCEPT ||
+     status == RPL_DAO_ACK_TIMEOUT) {
+    link_stats_packet_sent(rpl_get_parent_lladdr(p), MAC_TX_OK, 10);
+  }
+}
+#endif /* RPL_WITH_DAO_ACK */
+/*---------------------------------------------------------------------------*/
+static uint16_t
+parent_link_metric(rpl_parent_t *p)
+{
+  const struct link_stats *stats = rpl_get_parent_link_stats(p);
+
+  return stats != NULL ? stats->etx : 0xffff;
+}
+/*---------------------------------------------------------------------------*/
+/* Extra cost of a parent for its advertised level */
+static uint16_t
+energy_penalty(rpl_parent_t *p)
+{
+  uint8_t type;
+  uint8_t level;
+  uint16_t low;
+
+  if(p->mc.type != RPL_DAG_MC_ENERGY) {
+    return 0;
+  }
+  type = (p->mc.obj.energy.flags >> RPL_DAG_MC_ENERGY_TYPE) & 3;
+  level = p->mc.obj.energy.energy_est;
+  if(type == RPL_DAG_MC_ENERGY_TYPE_MAINS) {
+    return 0;
+  }
+
+  low = RPL_ENERGY_OF_LOW;
+  if(p != p->dag->preferred_parent) {
+    low += RPL_ENERGY_OF_HYST;
+  }
+  if(level >= low) {
+    return 0;
+  }
+  return (uint32_t)RPL_ENERGY_OF_PENALTY * (low - level) / low;
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+parent_path_cost(rpl_parent_t *p)
+{
+  uint32_t cost;
+
+  if(p == NULL || p->dag == NULL || p->dag->instance == NULL) {
+    return 0xffff;
+  }
+  cost = (uint32_t)p->rank + parent_link_metric(p) + energy_penalty(p);
+  return cost < 0xffff ? cost : 0xffff;
+}
+/*---------------------------------------------------------------------------*/
+static rpl_rank_t
+rank_via_parent(rpl_parent_t *p)
+{
+  uint32_t min_rank;
+  uint16_t cost;
+
+  if(p == NULL || p->dag == NULL || p->dag->instance == NULL) {
+    return INFINITE_RANK;
+  }
+  /* At least the parent's rank plus MinHopRankIncrease */
+  min_rank = (uint32_t)p->rank + p->dag->instance->min_hoprankinc;
+  if(min_rank > 0xffff) {
+    min_rank = 0xffff;
+  }
+  cost = parent_path_cost(p);
+  return cost > min_rank ? cost : min_rank;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parent_has_usable_link(rpl_parent_t *p)
+{
+  return parent_link_metric(p) <= MAX_LINK_METRIC;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parent_is_acceptable(rpl_parent_t *p)
+{
+  return p != NULL && parent_has_usable_link(p) &&
+         parent_path_cost(p) <= MAX_PATH_COST;
+}
+/*---------------------------------------------------------------------------*/
+static rpl_parent_t *
+best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
+{
+  rpl_dag_t *dag;
+  uint16_t p1_cost;
+  uint16_t p2_cost;
+
+  if(!parent_is_acceptable(p1)) {
+    return parent_is_acceptable(p2) ? p2 : NULL;
+  }
+  if(!parent_is_acceptable(p2)) {
+    return p1;
+  }
+
+  dag = p1->dag;
+  p1_cost = parent_path_cost(p1);
+  p2_cost = parent_path_cost(p2);
+
+  /* Keep the preferred parent when the costs are close */
+  if(p1 == dag->preferred_parent || p2 == dag->preferred_parent) {
+    if(p1_cost < p2_cost + PARENT_SWITCH_THRESHOLD &&
+       p1_cost + PARENT_SWITCH_THRESHOLD > p2_cost) {
+      return dag->preferred_parent;
+    }
+  }
+  return p1_cost < p2_cost ? p1 : p2;
+}
+/*---------------------------------------------------------------------------*/
+static rpl_dag_t *
+best_dag(rpl_dag_t *d1, rpl_dag_t *d2)
+{
+  if(d1->grounded != d2->grounded) {
+    return d1->grounded ? d1 : d2;
+  }
+  if(d1->preference != d2->preference) {
+    return d1->preference > d2->preference ? d1 : d2;
+  }
+  return d1->rank < d2->rank ? d1 : d2;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_metric_container(rpl_instance_t *instance)
+{
+  rpl_dag_t *dag = instance->current_dag;
+  uint8_t type;
+  uint8_t level;
+
+  if(dag == NULL || !dag->joined) {
+    return;
+  }
+
+  if(dag->rank == ROOT_RANK(instance)) {
+    /* The root sets up the container, the others copy it when joining */
+    instance->mc.type = RPL_DAG_MC_ENERGY;
+    instance->mc.flags = 0;
+    instance->mc.aggr = RPL_DAG_MC_AGGR_ADDITIVE;
+    instance->mc.prec = 0;
+    type = RPL_DAG_MC_ENERGY_TYPE_MAINS;
+    level = RPL_ENERGY_OF_MAINS;
+  } else {
+    type = RPL_DAG_MC_ENERGY_TYPE_SCAVENGING;
+    level = own_level;
+  }
+  instance->mc.length = sizeof(instance->mc.obj.energy);
+  instance->mc.obj.energy.flags = type << RPL_DAG_MC_ENERGY_TYPE;
+  instance->mc.obj.energy.energy_est = level;
+}
+/*---------------------------------------------------------------------------*/
+rpl_of_t rpl_energy_of = {
+  reset,
+#if RPL_WITH_DAO_ACK
+  dao_ack_callback,
+#endif
+  parent_link_metric,
+  parent_has_usable_link,
+  parent_path_cost,
+  rank_via_parent,
+  best_parent,
+  best_dag,
+  update_metric_container,
+  RPL_OCP_ENERGY
+};
+/*---------------------------------------------------------------------------*/
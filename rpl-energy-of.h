@@ -0,0 +1,100 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         RPL objective function that weighs residual energy into parent
+ *         selection.
+ *
+ *         Built like MRHOF: the path cost through a parent is its rank
+ *         plus the ETX of the link, and the rank through it the larger of
+ *         that and the parent's rank plus MinHopRankIncrease. On top, a
+ *         parent that is low on energy costs up to RPL_ENERGY_OF_PENALTY
+ *         more, so relays running down shed their children before they
+ *         go to Sleep and take the subtree with them.
+ *
+ *         Every node advertises its own level in the node energy object
+ *         (RFC 6551) of the DIO metric container: type mains for the
+ *         root, scavenging for the clients, and a level from 0 (empty or
+ *         in Sleep) to 255. The level is not aggregated up the path, a
+ *         penalty above reaches the children through the rank it adds.
+ *
+ *         A parent below RPL_ENERGY_OF_LOW is penalised in proportion to
+ *         the shortfall. A parent that is not the preferred one already
+ *         counts as low up to RPL_ENERGY_OF_LOW + RPL_ENERGY_OF_HYST, so a
+ *         relay hovering around the threshold does not win its children
+ *         back until it has clearly recovered. MRHOF's switch threshold
+ *         applies as well.
+ *
+ *         Build both sides with WITH_ENERGY_OF=1 to use it, project-conf.h
+ *         then makes it the only OF and turns on the metric container. The
+ *         OCP is RPL_OCP_ENERGY, so nodes without it do not join.
+ */
+
+#ifndef RPL_ENERGY_OF_H_
+#define RPL_ENERGY_OF_H_
+
+#include "contiki.h"
+
+/*---------------------------------------------------------------------------*/
+/* Level below which a parent costs extra, of 255 */
+#ifdef RPL_ENERGY_OF_CONF_LOW
+#define RPL_ENERGY_OF_LOW         RPL_ENERGY_OF_CONF_LOW
+#else
+#define RPL_ENERGY_OF_LOW         64
+#endif
+
+/* Extra level a parent other than the preferred one must have */
+#ifdef RPL_ENERGY_OF_CONF_HYST
+#define RPL_ENERGY_OF_HYST        RPL_ENERGY_OF_CONF_HYST
+#else
+#define RPL_ENERGY_OF_HYST        32
+#endif
+
+/* Cost of a parent at level 0, in rank units. 512 is an ETX of 4 */
+#ifdef RPL_ENERGY_OF_CONF_PENALTY
+#define RPL_ENERGY_OF_PENALTY     RPL_ENERGY_OF_CONF_PENALTY
+#else
+#define RPL_ENERGY_OF_PENALTY     512
+#endif
+
+#define RPL_ENERGY_OF_MAINS       255
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Set the level this node advertises
+ * \param level 0 to 255, 0 when the node is about to stop relaying
+ *
+ *             A level that crosses RPL_ENERGY_OF_LOW resets the DIO timer
+ *             so that the children hear of it soon.
+ */
+void rpl_energy_of_set(uint8_t level);
+
+/**
+ * \brief      Level this node advertises
+ */
+uint8_t rpl_energy_of_level(void);
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_ENERGY_OF_H_ */
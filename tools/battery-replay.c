@@ -0,0 +1,221 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Native replay of battery traces through the streaming battery
+ *         estimator, udp-client-test/battery-est.c, built from the same
+ *         source as the firmware.
+ *
+ *         Reads one battery sample per line, "<seconds> <mV>", and feeds
+ *         the estimator every BATTERY_EST_INTERVAL with the battery
+ *         interpolated between samples, as the client samples its ADC.
+ *         -s adds a reading far off every GLITCH_EVERY samples, as the
+ *         ADC gives while the radio draws current. Prints how far the
+ *         level is from the trace, and how far the drain rate averaged
+ *         over each hour is from the trace's own change over that hour.
+ *
+ *         Usage: battery-replay [-v] [-c] [-s] < trace
+ *
+ *         -v prints every sample as CSV. -c exits 1 unless the level
+ *         stays within LEVEL_TOL of the trace, and the hourly drain within
+ *         DRAIN_TOL of it with the right sign. The SETTLE seconds after a
+ *         step in the trace, e.g. a battery swap, are not checked.
+ *         "lqt-replay -g days" writes a synthetic trace.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "contiki.h"
+#include "dev/battery-sensor.h"
+#include "battery-est.h"
+
+/* Estimator sampling period in seconds */
+#define STEP                      (BATTERY_EST_INTERVAL / CLOCK_SECOND)
+
+/* -s: one sample in this many is off by GLITCH_MV */
+#define GLITCH_EVERY              37
+#define GLITCH_MV                 (-400)
+
+/* A change larger than this between two trace lines is a step */
+#define STEP_MV                   100
+#define SETTLE                    1800
+
+/* -c limits */
+#define LEVEL_TOL                 25
+#define DRAIN_TOL                 40
+
+/* Never read, the harness calls battery_est_add() itself */
+static int
+value(int type)
+{
+  return 0;
+}
+const struct sensors_sensor battery_sensor = { value };
+
+static clock_time_t now;
+/*---------------------------------------------------------------------------*/
+clock_time_t
+clock_time(void)
+{
+  return now;
+}
+/*---------------------------------------------------------------------------*/
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: battery-replay [-v] [-c] [-s] < trace\n");
+  exit(2);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  char line[128];
+  unsigned long t0 = 0, t1, t = 0, settle_until = 0;
+  unsigned long samples = 0, checked = 0, level_failed = 0;
+  unsigned long hours = 0, drain_failed = 0;
+  unsigned long hour_start = 0;
+  long drain_sum = 0, drain_n = 0;
+  int mv0 = 0, mv1, bat, hour_bat = 0, sample_mv, err, max_err = 0;
+  double drain, truth, max_drain_err = 0;
+  int verbose = 0, check = 0, glitch = 0, have = 0;
+  int c;
+
+  while((c = getopt(argc, argv, "vcs")) != -1) {
+    switch(c) {
+    case 'v':
+      verbose = 1;
+      break;
+    case 'c':
+      check = 1;
+      break;
+    case 's':
+      glitch = 1;
+      break;
+    default:
+      usage();
+    }
+  }
+
+  if(verbose) {
+    printf("t,mv,sample_mv,level_mv,drain_mv_h\n");
+  }
+  battery_est_init();
+
+  while(fgets(line, sizeof(line), stdin) != NULL) {
+    if(line[0] == '#' || sscanf(line, "%lu %d", &t1, &mv1) != 2) {
+      continue;
+    }
+    if(!have) {
+      t0 = t1;
+      mv0 = mv1;
+      t = t1;
+      hour_start = t1;
+      hour_bat = mv1;
+      settle_until = t1 + SETTLE;
+      have = 1;
+    }
+    if(abs(mv1 - mv0) > STEP_MV) {
+      settle_until = t1 + SETTLE;
+    }
+
+    for(; t <= t1; t += STEP) {
+      bat = t1 > t0 ? mv0 + (long)(mv1 - mv0) * (long)(t - t0) /
+        (long)(t1 - t0) : mv1;
+      sample_mv = bat;
+      if(glitch && samples % GLITCH_EVERY == GLITCH_EVERY - 1) {
+        sample_mv += GLITCH_MV;
+      }
+      now = (clock_time_t)(t * CLOCK_SECOND);
+      battery_est_add(sample_mv, clock_time());
+      samples++;
+
+      if(verbose) {
+        printf("%lu,%d,%d,%d,%d\n", t, bat, sample_mv, battery_est_level(),
+               battery_est_drain());
+      }
+
+      if(t >= settle_until) {
+        err = abs(battery_est_level() - bat);
+        max_err = err > max_err ? err : max_err;
+        level_failed += err > LEVEL_TOL;
+        checked++;
+        drain_sum += battery_est_drain();
+        drain_n++;
+      }
+
+      /* Hourly drain against the trace's change over the same hour */
+      if(t - hour_start >= 3600) {
+        if(drain_n * STEP >= 3600 - STEP) {
+          drain = (double)drain_sum / drain_n;
+          truth = (double)(bat - hour_bat) * 3600 / (t - hour_start);
+          if(drain - truth > max_drain_err || truth - drain > max_drain_err) {
+            max_drain_err = drain > truth ? drain - truth : truth - drain;
+          }
+          drain_failed += drain - truth > DRAIN_TOL ||
+            truth - drain > DRAIN_TOL || (truth < -DRAIN_TOL && drain >= 0) ||
+            (truth > DRAIN_TOL && drain <= 0);
+          hours++;
+        }
+        hour_start = t;
+        hour_bat = bat;
+        drain_sum = 0;
+        drain_n = 0;
+      }
+    }
+    t0 = t1;
+    mv0 = mv1;
+  }
+
+  if(samples == 0) {
+    fprintf(stderr, "battery-replay: no samples\n");
+    return 1;
+  }
+
+  fprintf(verbose ? stderr : stdout,
+          "%lu samples over %.1f h%s, %lu checked\n"
+          "level  max error %4d mV, %lu samples over %d mV\n"
+          "drain  max error %4.0f mV/h, %lu of %lu hours over %d mV/h\n",
+          samples, samples * STEP / 3600.0,
+          glitch ? " with glitches" : "", checked,
+          max_err, level_failed, LEVEL_TOL,
+          max_drain_err, drain_failed, hours, DRAIN_TOL);
+
+  if(!check) {
+    return 0;
+  }
+  fflush(stdout);
+  if(level_failed > 0 || drain_failed > 0 || checked == 0) {
+    fprintf(stderr, "FAIL\n");
+    return 1;
+  }
+  fprintf(stderr, "OK\n");
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,411 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Bytes on the air and radio-on time per reading, with the old
+ *         struct my_meddelande_t payload and with the encodings of
+ *         msg-codec.h, and what encoding and decoding cost natively.
+ *
+ *         The readings are generated as a client in Normal_op takes them:
+ *         counter up by one, battery and data rate slowly moving. Each
+ *         format packs as many readings into a datagram as the client
+ *         does, at most READING_BATCH_NUM in READING_BATCH_PAYLOAD bytes
+ *         (udp-client-test/reading-batch.h), the old layout one per
+ *         datagram. A frame is counted with the PHY header and the 45
+ *         bytes of MAC, 6LoWPAN and UDP header measured in example.h.
+ *
+ *         Radio-on time is that of the sender under ContikiMAC: the frame
+ *         is strobed for half a channel check period on average before the
+ *         receiver wakes up, then sent once more and acked. Reading decoded
+ *         payloads back must give the readings encoded, or it exits 1.
+ *
+ *         -t reads the battery from a trace instead, one "<seconds> <mV>"
+ *         sample per line as lqt-replay takes, and replays it as often as
+ *         it takes to make up the readings. -a gives the readings the age
+ *         they have when a backlog of READING_BATCH_NUM is drained from the
+ *         flash log. The ratio column is the old payload over the format's
+ *         payload, and the ns columns the native cost per sample.
+ *
+ *         Usage: codec-bench [-n readings] [-r check rate Hz] [-t trace] [-a]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "msg-codec.h"
+
+/* Client side batching, see udp-client-test/reading-batch.h */
+#define BATCH_NUM                 8
+#define BATCH_PAYLOAD             80
+
+/* Size of struct my_meddelande_t as laid out by msp430-gcc */
+#define LEGACY_LEN                82
+#define LEGACY_MODE_LEN           73
+
+/* Header bytes of a frame: PHY 6, MAC/6LoWPAN/UDP 45 as in example.h,
+   which leaves the 82 bytes of the old layout exactly one frame */
+#define PHY_HDR_LEN               6
+#define FRAME_HDR_LEN             45
+
+/* 802.15.4 at 250 kbit/s, and the ack: PHY header, 3 bytes and the FCS */
+#define US_PER_BYTE               32
+#define ACK_LEN                   (PHY_HDR_LEN + 5)
+
+/* ContikiMAC default channel check rate */
+#define CHECK_RATE                8
+
+#define DEFAULT_READINGS          1000000
+
+enum format {
+  F_LEGACY,
+  F_READING,
+  F_BATCH,
+  F_DELTA,
+  F_NUM
+};
+
+static const char *format_names[F_NUM] = {
+  "legacy", "reading", "batch", "delta"
+};
+
+#define USAGE \
+  "usage: codec-bench [-n readings] [-r check rate Hz] [-t trace] [-a]\n"
+
+struct result {
+  uint32_t datagrams;
+  uint64_t payload;
+  double enc_s;
+  double dec_s;
+};
+/*---------------------------------------------------------------------------*/
+static double
+seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+/*---------------------------------------------------------------------------*/
+static void
+generate(struct msg_reading *r, uint32_t n)
+{
+  uint32_t i;
+
+  srand(1);
+  for(i = 0; i < n; i++) {
+    r[i].mode = MSG_MODE_NORMAL_OP;
+    r[i].fields = MSG_F_BATTERY | MSG_F_DATA_RATE;
+    r[i].counter = i;
+    r[i].battery = 3300 - (i / 64) % 600 + rand() % 3;
+    r[i].data_rate = 640 + 128 * ((i / 256) % 8);
+    r[i].age = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Readings from a battery trace, replayed until there are n */
+static int
+load_trace(struct msg_reading *r, uint32_t n, const char *path, int ages)
+{
+  FILE *f;
+  char line[128];
+  unsigned long *t;
+  int *mv;
+  unsigned long s;
+  uint32_t num = 0, size = 1024;
+  uint32_t i;
+  int v;
+
+  f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  t = malloc(size * sizeof(*t));
+  mv = malloc(size * sizeof(*mv));
+  if(f == NULL || t == NULL || mv == NULL) {
+    perror(path);
+    return -1;
+  }
+  while(fgets(line, sizeof(line), f) != NULL) {
+    if(line[0] == '#' || sscanf(line, "%lu %d", &s, &v) != 2) {
+      continue;
+    }
+    if(num == size) {
+      size *= 2;
+      t = realloc(t, size * sizeof(*t));
+      mv = realloc(mv, size * sizeof(*mv));
+      if(t == NULL || mv == NULL) {
+        perror(path);
+        return -1;
+      }
+    }
+    t[num] = s;
+    mv[num++] = v;
+  }
+  if(f != stdin) {
+    fclose(f);
+  }
+  if(num == 0) {
+    fprintf(stderr, "%s: no samples\n", path);
+    return -1;
+  }
+
+  for(i = 0; i < n; i++) {
+    r[i].mode = MSG_MODE_NORMAL_OP;
+    r[i].fields = MSG_F_BATTERY | MSG_F_DATA_RATE;
+    r[i].counter = i;
+    r[i].battery = mv[i % num] < 0 ? 0 : mv[i % num];
+    r[i].data_rate = 640;
+    r[i].age = 0;
+    /* Drained oldest first, aged up to the last reading of the backlog */
+    if(ages && i % num + BATCH_NUM - i % BATCH_NUM <= num) {
+      r[i].fields |= MSG_F_AGE;
+      r[i].age = t[i % num + BATCH_NUM - 1 - i % BATCH_NUM] - t[i % num];
+    }
+  }
+  free(t);
+  free(mv);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* The old payload, byte for byte as the client copied the struct */
+static uint8_t
+encode_legacy(uint8_t *buf, const struct msg_reading *r)
+{
+  buf[0] = r->counter & 0xff;
+  buf[1] = r->counter >> 8;
+  buf[2] = r->battery & 0xff;
+  buf[3] = r->battery >> 8;
+  buf[4] = r->data_rate & 0xff;
+  buf[5] = (r->data_rate >> 8) & 0xff;
+  buf[6] = (r->data_rate >> 16) & 0xff;
+  buf[7] = r->data_rate >> 24;
+  strncpy((char *)&buf[8], msg_mode_name(r->mode), LEGACY_MODE_LEN);
+  buf[LEGACY_LEN - 1] = 0;
+  return LEGACY_LEN;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+decode_legacy(const uint8_t *buf, struct msg_reading *r)
+{
+  uint8_t m;
+
+  r->counter = buf[0] | (buf[1] << 8);
+  r->battery = buf[2] | (buf[3] << 8);
+  r->data_rate = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) |
+    ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+  r->fields = MSG_F_BATTERY | MSG_F_DATA_RATE;
+  r->age = 0;
+  for(m = 0; m < MSG_MODE_NUM; m++) {
+    if(strcmp((const char *)&buf[8], msg_mode_name(m)) == 0) {
+      break;
+    }
+  }
+  r->mode = m;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Encode the next datagram from r, returns the readings it holds */
+static uint8_t
+encode(enum format f, uint8_t *buf, uint8_t *len, const struct msg_reading *r,
+       uint32_t left)
+{
+  uint8_t num = left < BATCH_NUM ? left : BATCH_NUM;
+
+  switch(f) {
+  case F_LEGACY:
+    *len = encode_legacy(buf, r);
+    return 1;
+  case F_READING:
+    *len = msg_encode_reading(buf, BATCH_PAYLOAD, r);
+    return *len > 0;
+  case F_BATCH:
+    return msg_encode_batch(buf, BATCH_PAYLOAD, r, num, len);
+  default:
+    return msg_encode_batch_delta(buf, BATCH_PAYLOAD, r, num, len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+decode(enum format f, const uint8_t *buf, uint8_t len, struct msg_reading *r)
+{
+  switch(f) {
+  case F_LEGACY:
+    return decode_legacy(buf, r);
+  case F_READING:
+    return msg_decode_reading(buf, len, r) > 0;
+  default:
+    return msg_decode_batch(buf, len, r, MSG_BATCH_MAX);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The old struct had no age, so it is not compared there */
+static int
+same(enum format f, const struct msg_reading *a, const struct msg_reading *b)
+{
+  if(f == F_LEGACY) {
+    return a->mode == b->mode && a->counter == b->counter &&
+      a->battery == b->battery && a->data_rate == b->data_rate;
+  }
+  return a->mode == b->mode && a->fields == b->fields &&
+    a->counter == b->counter && a->battery == b->battery &&
+    a->data_rate == b->data_rate && a->age == b->age;
+}
+/*---------------------------------------------------------------------------*/
+static int
+run(enum format f, const struct msg_reading *r, uint32_t n,
+    struct result *res)
+{
+  uint8_t *buf;
+  uint8_t *len;
+  uint8_t *count;
+  struct msg_reading *out;
+  uint32_t i, d, k;
+  uint8_t j;
+  double t0, t1, t2;
+
+  buf = malloc((size_t)n * LEGACY_LEN);
+  len = malloc(n);
+  count = malloc(n);
+  out = malloc((size_t)n * sizeof(*out));
+  if(buf == NULL || len == NULL || count == NULL || out == NULL) {
+    perror("codec-bench");
+    exit(1);
+  }
+  /* Fault the buffers in, so only the codec is timed */
+  memset(buf, 0, (size_t)n * LEGACY_LEN);
+  memset(out, 0, (size_t)n * sizeof(*out));
+
+  t0 = seconds();
+  for(i = 0, d = 0; i < n; d++) {
+    count[d] = encode(f, &buf[(size_t)d * LEGACY_LEN], &len[d], &r[i], n - i);
+    if(count[d] == 0) {
+      printf("%s: reading %u does not fit\n", format_names[f], i);
+      return 1;
+    }
+    i += count[d];
+  }
+  t1 = seconds();
+  for(i = 0, k = 0; i < d; i++) {
+    k += decode(f, &buf[(size_t)i * LEGACY_LEN], len[i], &out[k]);
+  }
+  t2 = seconds();
+
+  res->datagrams = d;
+  res->payload = 0;
+  res->enc_s = t1 - t0;
+  res->dec_s = t2 - t1;
+  for(i = 0, k = 0; i < d; i++) {
+    res->payload += len[i];
+    for(j = 0; j < count[i]; j++, k++) {
+      if(!same(f, &r[k], &out[k])) {
+        printf("%s: reading %u decoded wrong\n", format_names[f], k);
+        return 1;
+      }
+    }
+  }
+
+  free(buf);
+  free(len);
+  free(count);
+  free(out);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  struct msg_reading *r;
+  struct result res[F_NUM];
+  uint32_t n = DEFAULT_READINGS;
+  double check_rate = CHECK_RATE;
+  double air_b, air_us, radio_ms;
+  const char *trace = NULL;
+  int ages = 0;
+  int f;
+  int c;
+
+  while((c = getopt(argc, argv, "n:r:t:a")) != -1) {
+    switch(c) {
+    case 'n':
+      n = strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      check_rate = atof(optarg);
+      break;
+    case 't':
+      trace = optarg;
+      break;
+    case 'a':
+      ages = 1;
+      break;
+    default:
+      fprintf(stderr, USAGE);
+      return 1;
+    }
+  }
+  if(n == 0 || check_rate <= 0) {
+    fprintf(stderr, "codec-bench: bad -n or -r\n");
+    return 1;
+  }
+
+  r = malloc((size_t)n * sizeof(*r));
+  if(r == NULL) {
+    perror("codec-bench");
+    return 1;
+  }
+  if(trace == NULL) {
+    generate(r, n);
+  } else if(load_trace(r, n, trace, ages) < 0) {
+    return 1;
+  }
+
+  printf("%u readings%s%s, %d per datagram in %d bytes, "
+         "ContikiMAC at %g Hz\n", n, trace != NULL ? " from " : "",
+         trace != NULL ? trace : "", BATCH_NUM, BATCH_PAYLOAD, check_rate);
+  printf("format   rd/dgram  payload/rd  ratio  air_B/rd  air_us/rd"
+         "  radio_ms/rd  enc_ns/rd  dec_ns/rd\n");
+  for(f = 0; f < F_NUM; f++) {
+    if(run(f, r, n, &res[f])) {
+      return 1;
+    }
+    air_b = (double)res[f].payload +
+      (double)res[f].datagrams * (PHY_HDR_LEN + FRAME_HDR_LEN);
+    air_us = air_b * US_PER_BYTE;
+    radio_ms = res[f].datagrams * 1e3 / (2 * check_rate) +
+      (air_us + (double)res[f].datagrams * ACK_LEN * US_PER_BYTE) / 1e3;
+    printf("%-8s %8.2f %11.2f %6.1f %9.2f %10.1f %12.2f %10.1f %10.1f\n",
+           format_names[f], (double)n / res[f].datagrams,
+           (double)res[f].payload / n,
+           (double)res[F_LEGACY].payload / res[f].payload,
+           air_b / n, air_us / n, radio_ms / n,
+           res[f].enc_s * 1e9 / n, res[f].dec_s * 1e9 / n);
+  }
+  free(r);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,784 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         MQTT forwarder sink of the host collector.
+ *
+ *         mqtt:host[,port=N][,spill=path] publishes the readings with
+ *         QoS 1 to v2/zolertia/tutorialthings/ID, ID being the last byte
+ *         of the node's address. Readings of one node are coalesced into
+ *         one publish, a JSON array of the "values" objects the python
+ *         forwarder sent one at a time, with the receive time added in us.
+ *         A publish goes out when it is full or MQTT_LINGER_MS after it
+ *         was started, whichever comes first.
+ *
+ *         Publishes are pipelined, up to MQTT_INFLIGHT of them unacked,
+ *         on a non-blocking connection driven from the sink calls, so the
+ *         worker never waits on a broker round trip. When the broker
+ *         stalls the queued publishes grow into a pool of MQTT_POOL
+ *         buffers. Once that is full the oldest queued publish goes to
+ *         the spill file, <path>.<worker>, and is sent again when the
+ *         queue has drained, also after a restart. Without a spill file
+ *         the worker waits up to MQTT_STALL_MS for the broker instead,
+ *         so the socket buffer takes the load, and then drops the oldest
+ *         queued publishes until a quarter of the pool is free.
+ *
+ *         After a reconnect the unacked publishes are sent again, so a
+ *         reading can arrive twice, and spilled ones out of order. The
+ *         time value tells them apart.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "collector.h"
+
+#define MQTT_PORT                 "1883"
+#define MQTT_TOPIC                "v2/zolertia/tutorialthings/"
+
+/* Publish buffers per worker, and the largest publish */
+#define MQTT_POOL                 512
+#define MQTT_MSG_MAX              2048
+
+/* Room kept in front of the payload for the fixed and variable header */
+#define MQTT_HDR_ROOM             64
+
+/* Unacked publishes on the connection */
+#define MQTT_INFLIGHT             32
+
+#define MQTT_LINGER_MS            100
+#define MQTT_STALL_MS             1000
+#define MQTT_RETRY_MS             1000
+#define MQTT_KEEPALIVE            60
+
+/* Longest JSON object of one reading */
+#define MQTT_READING_MAX          320
+
+/* Node IDs, the last byte of the address */
+#define MQTT_IDS                  256
+
+/* MQTT 3.1.1 control packets */
+#define CONNECT                   0x10
+#define CONNACK                   0x20
+#define PUBLISH_QOS1              0x32
+#define PUBLISH_DUP               0x08
+#define PUBACK                    0x40
+#define PINGREQ                   0xc0
+#define PINGRESP                  0xd0
+
+#define NONE                      -1
+
+enum {
+  DOWN,
+  CONNECTING,
+  WAIT_CONNACK,
+  UP
+};
+
+struct mqtt_msg {
+  uint16_t start;            /* First byte of the packet once sealed */
+  uint16_t end;
+  uint16_t pid_off;          /* Where the packet id goes */
+  uint16_t readings;
+  uint8_t id;
+  uint8_t sent;              /* Sent before, set DUP when sent again */
+  uint8_t data[MQTT_MSG_MAX];
+};
+
+/* Spill file record header, followed by the packet */
+struct spill_rec {
+  uint16_t len;
+  uint16_t pid_off;
+  uint16_t readings;
+  uint8_t id;
+  uint8_t sent;
+};
+
+struct mqtt_sink {
+  struct sockaddr_storage addr;
+  socklen_t addr_len;
+  char client_id[32];
+  int fd;
+  int state;
+  uint64_t retry_at;
+  uint64_t last_tx;
+  uint64_t last_sweep;
+
+  struct mqtt_msg pool[MQTT_POOL];
+  int16_t free_list[MQTT_POOL];
+  int num_free;
+  int16_t open[MQTT_IDS];    /* Publish being filled per node ID */
+  int16_t queue[MQTT_POOL];  /* Sealed and waiting, a ring */
+  int q_head;
+  int q_len;
+  int16_t inflight[MQTT_INFLIGHT];
+  uint16_t inflight_pid[MQTT_INFLIGHT];
+  int num_inflight;
+  int out_msg;               /* Packet being sent, and how far */
+  int out_off;
+  uint16_t next_pid;
+
+  uint8_t in[256];
+  int in_len;
+
+  int spill_fd;
+  off_t spill_read;
+  off_t spill_end;
+
+  uint64_t readings;
+  uint64_t published;
+  uint64_t acked;
+  uint64_t spilled;
+  uint64_t dropped;
+  uint64_t reconnects;
+};
+
+static void pump(struct mqtt_sink *s, uint64_t now);
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+/*---------------------------------------------------------------------------*/
+static int
+msg_alloc(struct mqtt_sink *s)
+{
+  return s->num_free > 0 ? s->free_list[--s->num_free] : NONE;
+}
+/*---------------------------------------------------------------------------*/
+static void
+msg_free(struct mqtt_sink *s, int m)
+{
+  s->free_list[s->num_free++] = m;
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_push(struct mqtt_sink *s, int m, int front)
+{
+  if(front) {
+    s->q_head = (s->q_head + MQTT_POOL - 1) % MQTT_POOL;
+    s->queue[s->q_head] = m;
+  } else {
+    s->queue[(s->q_head + s->q_len) % MQTT_POOL] = m;
+  }
+  s->q_len++;
+}
+/*---------------------------------------------------------------------------*/
+static int
+queue_pop(struct mqtt_sink *s)
+{
+  int m;
+
+  if(s->q_len == 0) {
+    return NONE;
+  }
+  m = s->queue[s->q_head];
+  s->q_head = (s->q_head + 1) % MQTT_POOL;
+  s->q_len--;
+  return m;
+}
+/*---------------------------------------------------------------------------*/
+/* Close the JSON array and put the PUBLISH headers in front of it */
+static void
+seal(struct mqtt_sink *s, int m)
+{
+  struct mqtt_msg *msg = &s->pool[m];
+  char topic[sizeof(MQTT_TOPIC) + 4];
+  uint32_t remaining;
+  uint8_t *p;
+  int tlen;
+
+  s->open[msg->id] = NONE;
+  msg->data[msg->end++] = ']';
+
+  tlen = snprintf(topic, sizeof(topic), MQTT_TOPIC "%u", msg->id);
+  remaining = 2 + tlen + 2 + (msg->end - MQTT_HDR_ROOM);
+  msg->start = MQTT_HDR_ROOM - (1 + (remaining < 128 ? 1 : 2) + 2 + tlen + 2);
+  msg->pid_off = MQTT_HDR_ROOM - 2;
+
+  p = &msg->data[msg->start];
+  *p++ = PUBLISH_QOS1;
+  if(remaining < 128) {
+    *p++ = remaining;
+  } else {
+    *p++ = (remaining & 0x7f) | 0x80;
+    *p++ = remaining >> 7;
+  }
+  *p++ = tlen >> 8;
+  *p++ = tlen & 0xff;
+  memcpy(p, topic, tlen);
+
+  queue_push(s, m, 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+sweep(struct mqtt_sink *s, uint64_t now)
+{
+  int i;
+
+  for(i = 0; i < MQTT_IDS; i++) {
+    if(s->open[i] != NONE) {
+      seal(s, s->open[i]);
+    }
+  }
+  s->last_sweep = now;
+}
+/*---------------------------------------------------------------------------*/
+static void
+spill(struct mqtt_sink *s, int m)
+{
+  struct mqtt_msg *msg = &s->pool[m];
+  struct spill_rec rec;
+
+  rec.len = msg->end - msg->start;
+  rec.pid_off = msg->pid_off - msg->start;
+  rec.readings = msg->readings;
+  rec.id = msg->id;
+  rec.sent = msg->sent;
+  if(pwrite(s->spill_fd, &rec, sizeof(rec), s->spill_end) != sizeof(rec) ||
+     pwrite(s->spill_fd, &msg->data[msg->start], rec.len,
+            s->spill_end + sizeof(rec)) != rec.len) {
+    perror("mqtt spill");
+    s->dropped += msg->readings;
+  } else {
+    s->spill_end += sizeof(rec) + rec.len;
+    s->spilled += msg->readings;
+  }
+  msg_free(s, m);
+}
+/*---------------------------------------------------------------------------*/
+static int
+unspill(struct mqtt_sink *s)
+{
+  struct spill_rec rec;
+  struct mqtt_msg *msg;
+  int m;
+
+  if(s->spill_read >= s->spill_end || (m = msg_alloc(s)) == NONE) {
+    return NONE;
+  }
+  msg = &s->pool[m];
+  if(pread(s->spill_fd, &rec, sizeof(rec), s->spill_read) != sizeof(rec) ||
+     rec.len > MQTT_MSG_MAX || rec.pid_off + 2 > rec.len ||
+     pread(s->spill_fd, msg->data, rec.len, s->spill_read + sizeof(rec))
+     != rec.len) {
+    fprintf(stderr, "mqtt: spill file is damaged, dropping the rest\n");
+    s->spill_read = s->spill_end;
+    msg_free(s, m);
+    m = NONE;
+  } else {
+    msg->start = 0;
+    msg->end = rec.len;
+    msg->pid_off = rec.pid_off;
+    msg->readings = rec.readings;
+    msg->id = rec.id;
+    msg->sent = rec.sent;
+    s->spill_read += sizeof(rec) + rec.len;
+  }
+  if(s->spill_read >= s->spill_end) {
+    if(ftruncate(s->spill_fd, 0) == 0) {
+      s->spill_read = s->spill_end = 0;
+    }
+  }
+  return m;
+}
+/*---------------------------------------------------------------------------*/
+static void
+wait_broker(struct mqtt_sink *s, int ms)
+{
+  struct pollfd pfd;
+
+  if(s->state == DOWN) {
+    usleep(ms * 1000);
+    return;
+  }
+  pfd.fd = s->fd;
+  pfd.events = POLLIN;
+  if(s->state == CONNECTING || s->out_msg != NONE) {
+    pfd.events |= POLLOUT;
+  }
+  poll(&pfd, 1, ms);
+}
+/*---------------------------------------------------------------------------*/
+/* A free buffer, made by spilling, waiting or dropping if need be */
+static int
+room(struct mqtt_sink *s)
+{
+  uint64_t deadline;
+  uint64_t now;
+  int m;
+
+  m = msg_alloc(s);
+  if(m != NONE) {
+    return m;
+  }
+  /* With every buffer taken most are queued, MQTT_POOL is well above
+     MQTT_IDS + MQTT_INFLIGHT */
+  if(s->spill_fd >= 0) {
+    spill(s, queue_pop(s));
+    return msg_alloc(s);
+  }
+  deadline = now_ms() + MQTT_STALL_MS;
+  while(s->num_free == 0 && (now = now_ms()) < deadline) {
+    wait_broker(s, deadline - now);
+    pump(s, now_ms());
+  }
+  /* Still stuck, make room for a while rather than stall on every
+     publish */
+  while(s->num_free < MQTT_POOL / 4 && (m = queue_pop(s)) != NONE) {
+    s->dropped += s->pool[m].readings;
+    msg_free(s, m);
+  }
+  return msg_alloc(s);
+}
+/*---------------------------------------------------------------------------*/
+static void
+append(struct mqtt_sink *s, const struct collector_rec *rec)
+{
+  char json[MQTT_READING_MAX];
+  struct mqtt_msg *msg;
+  uint8_t id = rec->node[15];
+  int len;
+  int m;
+
+  len = snprintf(json, sizeof(json),
+                 "{\"values\":[{\"key\":\"id\",\"value\":%u},"
+                 "{\"key\":\"counter\",\"value\":%u},"
+                 "{\"key\":\"battery\",\"value\":%u},"
+                 "{\"key\":\"data_rate\",\"value\":%lu},"
+                 "{\"key\":\"age\",\"value\":%lu},"
+                 "{\"key\":\"mode\",\"value\":\"%s\"},"
+                 "{\"key\":\"time\",\"value\":%llu}]}",
+                 id, rec->r.counter, rec->r.battery,
+                 (unsigned long)rec->r.data_rate, (unsigned long)rec->r.age,
+                 msg_mode_name(rec->r.mode),
+                 (unsigned long long)(rec->rx_ns / 1000));
+
+  m = s->open[id];
+  /* Room for the separator and the closing bracket */
+  if(m != NONE && s->pool[m].end + len + 2 > MQTT_MSG_MAX) {
+    seal(s, m);
+    m = NONE;
+  }
+  if(m == NONE) {
+    m = room(s);
+    msg = &s->pool[m];
+    msg->end = MQTT_HDR_ROOM;
+    msg->data[msg->end++] = '[';
+    msg->readings = 0;
+    msg->id = id;
+    msg->sent = 0;
+    s->open[id] = m;
+  }
+  msg = &s->pool[m];
+  if(msg->readings > 0) {
+    msg->data[msg->end++] = ',';
+  }
+  memcpy(&msg->data[msg->end], json, len);
+  msg->end += len;
+  msg->readings++;
+  s->readings++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+disconnect(struct mqtt_sink *s, uint64_t now)
+{
+  int i;
+
+  if(s->state != DOWN) {
+    close(s->fd);
+    s->fd = -1;
+    s->state = DOWN;
+    s->reconnects++;
+  }
+  s->retry_at = now + MQTT_RETRY_MS;
+  s->out_msg = NONE;
+  s->in_len = 0;
+  /* Unacked publishes go first once connected again */
+  for(i = s->num_inflight - 1; i >= 0; i--) {
+    queue_push(s, s->inflight[i], 1);
+  }
+  s->num_inflight = 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+start_connect(struct mqtt_sink *s, uint64_t now)
+{
+  int on = 1;
+
+  s->fd = socket(s->addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if(s->fd < 0) {
+    s->retry_at = now + MQTT_RETRY_MS;
+    return;
+  }
+  setsockopt(s->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+  if(connect(s->fd, (struct sockaddr *)&s->addr, s->addr_len) < 0 &&
+     errno != EINPROGRESS) {
+    close(s->fd);
+    s->fd = -1;
+    s->retry_at = now + MQTT_RETRY_MS;
+    return;
+  }
+  s->state = CONNECTING;
+}
+/*---------------------------------------------------------------------------*/
+static int
+send_connect(struct mqtt_sink *s)
+{
+  uint8_t p[64];
+  int idlen = strlen(s->client_id);
+  int n = 0;
+
+  p[n++] = CONNECT;
+  p[n++] = 10 + 2 + idlen;
+  memcpy(&p[n], "\0\4MQTT\4\2", 8);
+  n += 8;
+  p[n++] = MQTT_KEEPALIVE >> 8;
+  p[n++] = MQTT_KEEPALIVE & 0xff;
+  p[n++] = idlen >> 8;
+  p[n++] = idlen & 0xff;
+  memcpy(&p[n], s->client_id, idlen);
+  n += idlen;
+  return send(s->fd, p, n, MSG_NOSIGNAL) == n ? 0 : -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+acked(struct mqtt_sink *s, uint16_t pid)
+{
+  int i;
+
+  for(i = 0; i < s->num_inflight; i++) {
+    if(s->inflight_pid[i] == pid) {
+      s->acked += s->pool[s->inflight[i]].readings;
+      msg_free(s, s->inflight[i]);
+      s->num_inflight--;
+      memmove(&s->inflight[i], &s->inflight[i + 1],
+              (s->num_inflight - i) * sizeof(s->inflight[0]));
+      memmove(&s->inflight_pid[i], &s->inflight_pid[i + 1],
+              (s->num_inflight - i) * sizeof(s->inflight_pid[0]));
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Read what the broker sent, -1 if the connection is gone */
+static int
+receive(struct mqtt_sink *s)
+{
+  int n;
+  int len;
+
+  for(;;) {
+    n = recv(s->fd, &s->in[s->in_len], sizeof(s->in) - s->in_len,
+             MSG_DONTWAIT);
+    if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      return -1;
+    }
+    if(n < 0) {
+      return 0;
+    }
+    s->in_len += n;
+    /* Everything we expect back is 2 bytes long, or 4 with the header */
+    while(s->in_len >= 2) {
+      len = 2 + s->in[1];
+      if(s->in[1] & 0x80) {
+        return -1;
+      }
+      if(s->in_len < len) {
+        break;
+      }
+      switch(s->in[0] & 0xf0) {
+      case CONNACK:
+        if(len != 4 || s->in[3] != 0) {
+          fprintf(stderr, "mqtt: connection refused (%u)\n", s->in[3]);
+          return -1;
+        }
+        s->state = UP;
+        break;
+      case PUBACK:
+        if(len == 4) {
+          acked(s, (s->in[2] << 8) | s->in[3]);
+        }
+        break;
+      }
+      s->in_len -= len;
+      memmove(s->in, &s->in[len], s->in_len);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Send publishes while the window and the socket have room */
+static int
+transmit(struct mqtt_sink *s, uint64_t now)
+{
+  static const uint8_t ping[] = { PINGREQ, 0 };
+  struct mqtt_msg *msg;
+  int m;
+  int n;
+
+  for(;;) {
+    if(s->out_msg == NONE) {
+      if(s->num_inflight >= MQTT_INFLIGHT) {
+        break;
+      }
+      m = queue_pop(s);
+      if(m == NONE) {
+        m = unspill(s);
+      }
+      if(m == NONE) {
+        break;
+      }
+      msg = &s->pool[m];
+      if(msg->sent) {
+        msg->data[msg->start] |= PUBLISH_DUP;
+      }
+      msg->sent = 1;
+      if(++s->next_pid == 0) {
+        s->next_pid = 1;
+      }
+      msg->data[msg->pid_off] = s->next_pid >> 8;
+      msg->data[msg->pid_off + 1] = s->next_pid & 0xff;
+      s->inflight[s->num_inflight] = m;
+      s->inflight_pid[s->num_inflight++] = s->next_pid;
+      s->out_msg = m;
+      s->out_off = msg->start;
+      s->published++;
+    }
+    msg = &s->pool[s->out_msg];
+    n = send(s->fd, &msg->data[s->out_off], msg->end - s->out_off,
+             MSG_DONTWAIT | MSG_NOSIGNAL);
+    if(n < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+    }
+    s->last_tx = now;
+    s->out_off += n;
+    if(s->out_off < msg->end) {
+      return 0;
+    }
+    s->out_msg = NONE;
+  }
+
+  if(now - s->last_tx > MQTT_KEEPALIVE * 1000 / 2) {
+    if(send(s->fd, ping, sizeof(ping), MSG_DONTWAIT | MSG_NOSIGNAL) ==
+       sizeof(ping)) {
+      s->last_tx = now;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+pump(struct mqtt_sink *s, uint64_t now)
+{
+  struct pollfd pfd;
+  socklen_t len;
+  int err;
+
+  if(s->state == DOWN) {
+    if(now < s->retry_at) {
+      return;
+    }
+    start_connect(s, now);
+  }
+  if(s->state == CONNECTING) {
+    pfd.fd = s->fd;
+    pfd.events = POLLOUT;
+    if(poll(&pfd, 1, 0) <= 0) {
+      return;
+    }
+    len = sizeof(err);
+    if(getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0 ||
+       send_connect(s) < 0) {
+      disconnect(s, now);
+      return;
+    }
+    s->last_tx = now;
+    s->state = WAIT_CONNACK;
+  }
+  if(receive(s) < 0) {
+    disconnect(s, now);
+    return;
+  }
+  if(s->state == UP && transmit(s, now) < 0) {
+    disconnect(s, now);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void *
+collector_mqtt_open(const char *arg)
+{
+  static unsigned instances;
+  struct addrinfo hints, *ai;
+  struct mqtt_sink *s;
+  char host[256];
+  const char *port = MQTT_PORT;
+  const char *spill_path = NULL;
+  char spill_name[300];
+  unsigned instance;
+  char *opt;
+  int i;
+
+  snprintf(host, sizeof(host), "%s", arg != NULL && *arg ? arg : "localhost");
+  for(opt = strchr(host, ','); opt != NULL; opt = strchr(opt, ',')) {
+    *opt++ = '\0';
+    if(strncmp(opt, "port=", 5) == 0) {
+      port = opt + 5;
+    } else if(strncmp(opt, "spill=", 6) == 0) {
+      spill_path = opt + 6;
+    } else {
+      fprintf(stderr, "mqtt: unknown option %s\n", opt);
+      return NULL;
+    }
+  }
+
+  s = calloc(1, sizeof(*s));
+  if(s == NULL) {
+    return NULL;
+  }
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_socktype = SOCK_STREAM;
+  if((i = getaddrinfo(host, port, &hints, &ai)) != 0) {
+    fprintf(stderr, "mqtt: %s: %s\n", host, gai_strerror(i));
+    free(s);
+    return NULL;
+  }
+  memcpy(&s->addr, ai->ai_addr, ai->ai_addrlen);
+  s->addr_len = ai->ai_addrlen;
+  freeaddrinfo(ai);
+
+  instance = __atomic_fetch_add(&instances, 1, __ATOMIC_RELAXED);
+  snprintf(s->client_id, sizeof(s->client_id), "collector-%d-%u",
+           (int)getpid(), instance);
+  s->spill_fd = -1;
+  if(spill_path != NULL) {
+    snprintf(spill_name, sizeof(spill_name), "%s.%u", spill_path, instance);
+    s->spill_fd = open(spill_name, O_RDWR | O_CREAT, 0644);
+    if(s->spill_fd < 0) {
+      perror(spill_name);
+      free(s);
+      return NULL;
+    }
+    /* Whatever an earlier run left goes out first */
+    s->spill_end = lseek(s->spill_fd, 0, SEEK_END);
+  }
+
+  for(i = 0; i < MQTT_POOL; i++) {
+    s->free_list[i] = MQTT_POOL - 1 - i;
+  }
+  s->num_free = MQTT_POOL;
+  for(i = 0; i < MQTT_IDS; i++) {
+    s->open[i] = NONE;
+  }
+  s->fd = -1;
+  s->state = DOWN;
+  s->out_msg = NONE;
+  s->last_sweep = now_ms();
+  pump(s, s->last_sweep);
+  return s;
+}
+/*---------------------------------------------------------------------------*/
+void
+collector_mqtt_write(void *ctx, const struct collector_rec *rec, int num)
+{
+  struct mqtt_sink *s = ctx;
+  uint64_t now;
+  int i;
+
+  for(i = 0; i < num; i++) {
+    append(s, &rec[i]);
+  }
+  now = now_ms();
+  if(now - s->last_sweep >= MQTT_LINGER_MS) {
+    sweep(s, now);
+  }
+  pump(s, now);
+}
+/*---------------------------------------------------------------------------*/
+void
+collector_mqtt_flush(void *ctx)
+{
+  struct mqtt_sink *s = ctx;
+  uint64_t now = now_ms();
+
+  sweep(s, now);
+  pump(s, now);
+}
+/*---------------------------------------------------------------------------*/
+void
+collector_mqtt_close(void *ctx)
+{
+  struct mqtt_sink *s = ctx;
+  uint64_t deadline;
+  uint64_t now;
+  int m;
+
+  /* Give the broker a moment to take the rest */
+  now = now_ms();
+  sweep(s, now);
+  deadline = now + MQTT_STALL_MS;
+  while((s->q_len > 0 || s->num_inflight > 0) && now < deadline) {
+    wait_broker(s, 10);
+    pump(s, now = now_ms());
+  }
+  if(s->state != DOWN) {
+    close(s->fd);
+  }
+  for(m = 0; m < s->num_inflight; m++) {
+    queue_push(s, s->inflight[m], 0);
+  }
+  while((m = queue_pop(s)) != NONE) {
+    if(s->spill_fd >= 0) {
+      spill(s, m);
+    } else {
+      s->dropped += s->pool[m].readings;
+    }
+  }
+  fprintf(stderr, "mqtt: %llu readings, %llu publishes, %llu acked, "
+          "%llu spilled, %llu dropped, %llu reconnects\n",
+          (unsigned long long)s->readings, (unsigned long long)s->published,
+          (unsigned long long)s->acked, (unsigned long long)s->spilled,
+          (unsigned long long)s->dropped, (unsigned long long)s->reconnects);
+  if(s->spill_fd >= 0) {
+    close(s->spill_fd);
+  }
+  free(s);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,287 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Sinks of the host collector.
+ *
+ *         null    drop the readings, for benchmarks
+ *         print   one text line per reading on stdout
+ *         csv     one CSV row per reading, appended to the file given as
+ *                 csv:<path>, stdout if no path is given
+ *         seg     columnar segments, see segment.h, in the directory given
+ *                 as seg:<dir>, the current directory if none is given
+ *         mqtt    publishes to an MQTT broker, see collector-mqtt.c
+ *
+ *         Each receive batch is formatted into one buffer and written with
+ *         a single write(), so rows from different workers never mix. The
+ *         segment sink gives each worker its own segment files instead.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "collector.h"
+#include "segment.h"
+
+/* Longest line a sink writes for one reading */
+#define LINE_MAX_LEN              160
+
+struct text_sink {
+  int fd;
+  int csv;
+  char buf[COLLECTOR_RECS * LINE_MAX_LEN];
+};
+
+struct seg_sink {
+  char dir[256];
+  unsigned instance;
+  unsigned seq;
+  int open;
+  struct segment seg;
+};
+/*---------------------------------------------------------------------------*/
+static void *
+null_open(const char *arg)
+{
+  static int dummy;
+
+  return &dummy;
+}
+/*---------------------------------------------------------------------------*/
+static void
+null_write(void *ctx, const struct collector_rec *rec, int num)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+null_flush(void *ctx)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+null_close(void *ctx)
+{
+}
+/*---------------------------------------------------------------------------*/
+static struct text_sink *
+text_open(const char *path, int csv)
+{
+  struct text_sink *s;
+
+  s = malloc(sizeof(*s));
+  if(s == NULL) {
+    return NULL;
+  }
+  s->csv = csv;
+  if(path == NULL || *path == '\0') {
+    s->fd = STDOUT_FILENO;
+  } else {
+    s->fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(s->fd < 0) {
+      perror(path);
+      free(s);
+      return NULL;
+    }
+  }
+  return s;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+print_open(const char *arg)
+{
+  return text_open(NULL, 0);
+}
+/*---------------------------------------------------------------------------*/
+static void *
+csv_open(const char *arg)
+{
+  return text_open(arg, 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+text_write(void *ctx, const struct collector_rec *rec, int num)
+{
+  struct text_sink *s = ctx;
+  char addr[INET6_ADDRSTRLEN];
+  size_t pos = 0;
+  int i;
+
+  for(i = 0; i < num; i++) {
+    inet_ntop(AF_INET6, rec[i].node, addr, sizeof(addr));
+    pos += snprintf(&s->buf[pos], sizeof(s->buf) - pos, s->csv ?
+                    "%llu.%06llu,%s,%u,%u,%lu,%lu,%s\n" :
+                    "%llu.%06llu %s counter=%u battery=%u data_rate=%lu "
+                    "age=%lu mode=%s\n",
+                    (unsigned long long)(rec[i].rx_ns / 1000000000ULL),
+                    (unsigned long long)(rec[i].rx_ns / 1000ULL % 1000000ULL),
+                    addr, rec[i].r.counter, rec[i].r.battery,
+                    (unsigned long)rec[i].r.data_rate,
+                    (unsigned long)rec[i].r.age,
+                    msg_mode_name(rec[i].r.mode));
+    if(pos >= sizeof(s->buf)) {
+      pos = sizeof(s->buf) - 1;
+      break;
+    }
+  }
+  if(pos > 0 && write(s->fd, s->buf, pos) < 0) {
+    perror("sink write");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+text_flush(void *ctx)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+text_close(void *ctx)
+{
+  struct text_sink *s = ctx;
+
+  if(s->fd != STDOUT_FILENO) {
+    close(s->fd);
+  }
+  free(s);
+}
+/*---------------------------------------------------------------------------*/
+static int
+seg_next(struct seg_sink *s)
+{
+  char path[sizeof(s->dir) + 64];
+
+  if(s->open) {
+    seg_seal(&s->seg);
+    seg_close(&s->seg);
+    s->open = 0;
+  }
+  /* Start time first, so the files of a directory sort by time */
+  snprintf(path, sizeof(path), "%s/%010lu-%02u-%04u.seg", s->dir,
+           (unsigned long)time(NULL), s->instance, s->seq++);
+  if(seg_create(&s->seg, path, SEG_CAPACITY) < 0) {
+    perror(path);
+    return -1;
+  }
+  s->open = 1;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+seg_sink_open(const char *arg)
+{
+  static unsigned instances;
+  struct seg_sink *s;
+
+  s = calloc(1, sizeof(*s));
+  if(s == NULL) {
+    return NULL;
+  }
+  snprintf(s->dir, sizeof(s->dir), "%s", arg != NULL && *arg ? arg : ".");
+  s->instance = __atomic_fetch_add(&instances, 1, __ATOMIC_RELAXED);
+  if(seg_next(s) < 0) {
+    free(s);
+    return NULL;
+  }
+  return s;
+}
+/*---------------------------------------------------------------------------*/
+static void
+seg_sink_write(void *ctx, const struct collector_rec *rec, int num)
+{
+  struct seg_sink *s = ctx;
+  uint32_t done;
+
+  while(num > 0 && s->open) {
+    done = seg_append(&s->seg, rec, num);
+    rec += done;
+    num -= done;
+    if(num > 0) {
+      seg_next(s);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+seg_sink_flush(void *ctx)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+seg_sink_close(void *ctx)
+{
+  struct seg_sink *s = ctx;
+
+  if(s->open) {
+    seg_seal(&s->seg);
+    seg_close(&s->seg);
+  }
+  free(s);
+}
+/*---------------------------------------------------------------------------*/
+static const struct collector_sink sinks[] = {
+  { "null", "drop the readings",
+    null_open, null_write, null_flush, null_close },
+  { "print", "text lines on stdout",
+    print_open, text_write, text_flush, text_close },
+  { "csv", "csv[:path], CSV rows appended to path or stdout",
+    csv_open, text_write, text_flush, text_close },
+  { "seg", "seg[:dir], columnar segment files in dir",
+    seg_sink_open, seg_sink_write, seg_sink_flush, seg_sink_close },
+  { "mqtt", "mqtt[:host][,port=N][,spill=path], QoS 1 publishes to a broker",
+    collector_mqtt_open, collector_mqtt_write, collector_mqtt_flush,
+    collector_mqtt_close },
+};
+/*---------------------------------------------------------------------------*/
+const struct collector_sink *
+collector_sink_find(const char *name)
+{
+  size_t len;
+  size_t i;
+
+  len = strcspn(name, ":");
+  for(i = 0; i < sizeof(sinks) / sizeof(sinks[0]); i++) {
+    if(strlen(sinks[i].name) == len && strncmp(sinks[i].name, name, len) == 0) {
+      return &sinks[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+void
+collector_sink_list(void)
+{
+  size_t i;
+
+  for(i = 0; i < sizeof(sinks) / sizeof(sinks[0]); i++) {
+    fprintf(stderr, "  %-8s %s\n", sinks[i].name, sinks[i].help);
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,521 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Host collector for the client readings, see collector.h.
+ *
+ *         Usage: collector [-p port] [-t threads] [-s sink[:arg]]
+ *                          [-i stats_interval] [-B seconds]
+ *
+ *         -B runs a loopback benchmark instead: for 1, 2, 4 ... threads
+ *         it floods the collector with delta batches for the given time
+ *         and reports packets/s, readings/s, drops and the p50/p99
+ *         processing latency of a packet (receive to sink done).
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "collector.h"
+
+/* Size of struct my_meddelande_t as laid out by msp430-gcc */
+#define LEGACY_LEN                82
+#define LEGACY_MODE_LEN           73
+
+/* Latency histogram, 1 us buckets and one for everything above */
+#define LAT_BUCKETS               10000
+
+#define MAX_THREADS               64
+
+/* Benchmark: sockets per sender thread, readings per datagram */
+#define BENCH_SOCKETS             4
+#define BENCH_READINGS            8
+
+struct worker {
+  pthread_t thread;
+  int fd;
+  int ep;
+  const struct collector_sink *sink;
+  void *sink_ctx;
+
+  /* Counters, read by the main thread without locking */
+  volatile uint64_t packets;
+  volatile uint64_t readings;
+  volatile uint64_t malformed;
+  uint32_t lat[LAT_BUCKETS + 1];
+
+  /* Receive batch, allocated once */
+  struct mmsghdr msgs[COLLECTOR_BATCH];
+  struct iovec iov[COLLECTOR_BATCH];
+  struct sockaddr_in6 from[COLLECTOR_BATCH];
+  uint8_t buf[COLLECTOR_BATCH][COLLECTOR_PAYLOAD];
+  struct collector_rec recs[COLLECTOR_RECS];
+};
+
+struct sender {
+  pthread_t thread;
+  int port;
+  volatile uint64_t sent;
+};
+
+static volatile sig_atomic_t stop;
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now_ns(clockid_t clock)
+{
+  struct timespec ts;
+
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+/*---------------------------------------------------------------------------*/
+static int
+decode_legacy(const uint8_t *buf, int len, struct msg_reading *r)
+{
+  char mode[LEGACY_MODE_LEN + 1];
+  int i;
+
+  if(len != LEGACY_LEN && len != LEGACY_LEN - 1) {
+    return 0;
+  }
+  r->fields = MSG_F_BATTERY | MSG_F_DATA_RATE;
+  r->counter = buf[0] | (buf[1] << 8);
+  r->battery = buf[2] | (buf[3] << 8);
+  r->data_rate = (uint32_t)buf[4] | ((uint32_t)buf[5] << 8) |
+    ((uint32_t)buf[6] << 16) | ((uint32_t)buf[7] << 24);
+  r->age = 0;
+  memcpy(mode, &buf[8], LEGACY_MODE_LEN);
+  mode[LEGACY_MODE_LEN] = '\0';
+  r->mode = MSG_MODE_NUM;
+  for(i = 0; i < MSG_MODE_NUM; i++) {
+    if(strcmp(mode, msg_mode_name(i)) == 0) {
+      r->mode = i;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+collector_decode(const uint8_t *buf, int len, struct msg_reading *r, int max)
+{
+  int num = 0;
+
+  switch(msg_type(buf, len)) {
+  case MSG_TYPE_READING:
+    num = msg_decode_reading(buf, len, &r[0]) > 0;
+    break;
+  case MSG_TYPE_BATCH:
+  case MSG_TYPE_BATCH_DELTA:
+    num = msg_decode_batch(buf, len, r, max > 255 ? 255 : max);
+    break;
+  }
+  if(num == 0) {
+    num = decode_legacy(buf, len, r);
+  }
+  return num;
+}
+/*---------------------------------------------------------------------------*/
+static int
+open_socket(int port)
+{
+  struct sockaddr_in6 addr;
+  int fd;
+  int on = 1;
+  int off = 0;
+
+  fd = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if(fd < 0) {
+    perror("socket");
+    return -1;
+  }
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+  setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(port);
+  if(bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("bind");
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+/*---------------------------------------------------------------------------*/
+static void
+process(struct worker *w, int n, uint64_t start)
+{
+  uint64_t rx_ns;
+  uint64_t lat;
+  int count = 0;
+  int num;
+  int i, j;
+
+  rx_ns = now_ns(CLOCK_REALTIME);
+  for(i = 0; i < n; i++) {
+    num = 0;
+    if((w->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) == 0) {
+      num = collector_decode(w->buf[i], w->msgs[i].msg_len,
+                             &w->recs[count].r, MSG_BATCH_MAX);
+    }
+    if(num == 0) {
+      w->malformed++;
+      continue;
+    }
+    /* Decoded in place, fill in where they came from */
+    for(j = count; j < count + num; j++) {
+      w->recs[j].rx_ns = rx_ns;
+      memcpy(w->recs[j].node, &w->from[i].sin6_addr, 16);
+    }
+    count += num;
+  }
+  if(count > 0) {
+    w->sink->write(w->sink_ctx, w->recs, count);
+  }
+
+  lat = (now_ns(CLOCK_MONOTONIC) - start) / 1000;
+  w->lat[lat < LAT_BUCKETS ? lat : LAT_BUCKETS] += n;
+  w->packets += n;
+  w->readings += count;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+worker_run(void *arg)
+{
+  struct worker *w = arg;
+  struct epoll_event ev;
+  uint64_t start;
+  int n;
+  int i;
+
+  for(i = 0; i < COLLECTOR_BATCH; i++) {
+    w->iov[i].iov_base = w->buf[i];
+    w->iov[i].iov_len = COLLECTOR_PAYLOAD;
+    memset(&w->msgs[i].msg_hdr, 0, sizeof(w->msgs[i].msg_hdr));
+    w->msgs[i].msg_hdr.msg_iov = &w->iov[i];
+    w->msgs[i].msg_hdr.msg_iovlen = 1;
+    w->msgs[i].msg_hdr.msg_name = &w->from[i];
+  }
+
+  while(!stop) {
+    n = epoll_wait(w->ep, &ev, 1, 100);
+    if(n <= 0) {
+      w->sink->flush(w->sink_ctx);
+      continue;
+    }
+    for(;;) {
+      for(i = 0; i < COLLECTOR_BATCH; i++) {
+        w->msgs[i].msg_hdr.msg_namelen = sizeof(w->from[i]);
+      }
+      n = recvmmsg(w->fd, w->msgs, COLLECTOR_BATCH, MSG_DONTWAIT, NULL);
+      if(n <= 0) {
+        break;
+      }
+      start = now_ns(CLOCK_MONOTONIC);
+      process(w, n, start);
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+workers_start(struct worker *w, int num, int port,
+              const struct collector_sink *sink, const char *sink_arg)
+{
+  struct epoll_event ev;
+  int i;
+
+  for(i = 0; i < num; i++) {
+    memset(&w[i], 0, sizeof(w[i]));
+    w[i].sink = sink;
+    w[i].fd = open_socket(port);
+    w[i].ep = epoll_create1(0);
+    w[i].sink_ctx = sink->open(sink_arg);
+    if(w[i].fd < 0 || w[i].ep < 0 || w[i].sink_ctx == NULL) {
+      return -1;
+    }
+    ev.events = EPOLLIN;
+    ev.data.ptr = &w[i];
+    epoll_ctl(w[i].ep, EPOLL_CTL_ADD, w[i].fd, &ev);
+    pthread_create(&w[i].thread, NULL, worker_run, &w[i]);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+workers_stop(struct worker *w, int num)
+{
+  int i;
+
+  for(i = 0; i < num; i++) {
+    pthread_join(w[i].thread, NULL);
+    w[i].sink->flush(w[i].sink_ctx);
+    w[i].sink->close(w[i].sink_ctx);
+    close(w[i].ep);
+    close(w[i].fd);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+totals(struct worker *w, int num, uint64_t *packets, uint64_t *readings,
+       uint64_t *malformed)
+{
+  int i;
+
+  *packets = *readings = *malformed = 0;
+  for(i = 0; i < num; i++) {
+    *packets += w[i].packets;
+    *readings += w[i].readings;
+    *malformed += w[i].malformed;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Latency below which the given share (in %) of the packets fell, in us */
+static unsigned
+percentile(struct worker *w, int num, unsigned pct)
+{
+  uint64_t total = 0;
+  uint64_t sum = 0;
+  unsigned b;
+  int i;
+
+  for(i = 0; i < num; i++) {
+    for(b = 0; b <= LAT_BUCKETS; b++) {
+      total += w[i].lat[b];
+    }
+  }
+  for(b = 0; b <= LAT_BUCKETS; b++) {
+    for(i = 0; i < num; i++) {
+      sum += w[i].lat[b];
+    }
+    if(sum * 100 >= total * pct) {
+      return b + 1;
+    }
+  }
+  return LAT_BUCKETS;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+sender_run(void *arg)
+{
+  struct sender *s = arg;
+  struct msg_reading r[BENCH_READINGS];
+  uint8_t buf[COLLECTOR_BATCH][COLLECTOR_PAYLOAD];
+  struct mmsghdr msgs[COLLECTOR_BATCH];
+  struct iovec iov[COLLECTOR_BATCH];
+  struct sockaddr_in addr;
+  int fd[BENCH_SOCKETS];
+  uint8_t len;
+  int i, j, n;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(s->port);
+  for(i = 0; i < BENCH_SOCKETS; i++) {
+    fd[i] = socket(AF_INET, SOCK_DGRAM, 0);
+    connect(fd[i], (struct sockaddr *)&addr, sizeof(addr));
+  }
+
+  /* Typical delta batches, a slowly draining battery */
+  memset(msgs, 0, sizeof(msgs));
+  for(i = 0; i < COLLECTOR_BATCH; i++) {
+    for(j = 0; j < BENCH_READINGS; j++) {
+      r[j].mode = MSG_MODE_NORMAL_OP;
+      r[j].fields = MSG_F_BATTERY | MSG_F_DATA_RATE;
+      r[j].counter = i * BENCH_READINGS + j;
+      r[j].battery = 3300 - (i * BENCH_READINGS + j) / 4;
+      r[j].data_rate = 1280;
+      r[j].age = 0;
+    }
+    msg_encode_batch_delta(buf[i], COLLECTOR_PAYLOAD, r, BENCH_READINGS, &len);
+    iov[i].iov_base = buf[i];
+    iov[i].iov_len = len;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  for(i = 0; !stop; i = (i + 1) % BENCH_SOCKETS) {
+    n = sendmmsg(fd[i], msgs, COLLECTOR_BATCH, 0);
+    if(n > 0) {
+      s->sent += n;
+    }
+  }
+  for(i = 0; i < BENCH_SOCKETS; i++) {
+    close(fd[i]);
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+bench(int max_threads, int port, const struct collector_sink *sink,
+      const char *sink_arg, int seconds)
+{
+  static struct worker w[MAX_THREADS];
+  struct sender s[MAX_THREADS];
+  uint64_t packets, readings, malformed, sent;
+  int threads;
+  int i;
+
+  printf("threads  packets/s  readings/s  dropped  p50_us  p99_us\n");
+  for(threads = 1; threads <= max_threads; threads *= 2) {
+    stop = 0;
+    if(workers_start(w, threads, port, sink, sink_arg) < 0) {
+      return 1;
+    }
+    for(i = 0; i < threads; i++) {
+      s[i].port = port;
+      s[i].sent = 0;
+      pthread_create(&s[i].thread, NULL, sender_run, &s[i]);
+    }
+    sleep(seconds);
+    stop = 1;
+    sent = 0;
+    for(i = 0; i < threads; i++) {
+      pthread_join(s[i].thread, NULL);
+      sent += s[i].sent;
+    }
+    workers_stop(w, threads);
+
+    totals(w, threads, &packets, &readings, &malformed);
+    printf("%7d %10.0f %11.0f %7.2f%% %7u %7u\n", threads,
+           (double)packets / seconds, (double)readings / seconds,
+           sent > 0 ? 100.0 * (sent - packets) / sent : 0.0,
+           percentile(w, threads, 50), percentile(w, threads, 99));
+    fflush(stdout);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+on_signal(int sig)
+{
+  stop = 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-p port] [-t threads] [-s sink[:arg]] "
+          "[-i stats_interval] [-B seconds]\nSinks:\n", name);
+  collector_sink_list();
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  static struct worker w[MAX_THREADS];
+  const struct collector_sink *sink;
+  const char *sink_name = "print";
+  const char *sink_arg;
+  uint64_t packets, readings, malformed;
+  uint64_t last = 0;
+  int port = COLLECTOR_PORT;
+  int threads = 1;
+  int interval = 10;
+  int seconds = 0;
+  int opt;
+  int t;
+
+  while((opt = getopt(argc, argv, "p:t:s:i:B:h")) != -1) {
+    switch(opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 't':
+      threads = atoi(optarg);
+      break;
+    case 's':
+      sink_name = optarg;
+      break;
+    case 'i':
+      interval = atoi(optarg);
+      break;
+    case 'B':
+      seconds = atoi(optarg);
+      sink_name = "null";
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(threads < 1 || threads > MAX_THREADS || interval < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  sink = collector_sink_find(sink_name);
+  if(sink == NULL) {
+    usage(argv[0]);
+    return 1;
+  }
+  sink_arg = strchr(sink_name, ':');
+  if(sink_arg != NULL) {
+    sink_arg++;
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  if(seconds > 0) {
+    return bench(threads, port, sink, sink_arg, seconds);
+  }
+
+  if(workers_start(w, threads, port, sink, sink_arg) < 0) {
+    return 1;
+  }
+  fprintf(stderr, "Collecting on port %d, %d thread(s), sink %s\n", port,
+          threads, sink->name);
+  for(t = 0; !stop; t++) {
+    sleep(1);
+    if(t % interval == interval - 1) {
+      totals(w, threads, &packets, &readings, &malformed);
+      fprintf(stderr, "%llu packets (%llu/s), %llu readings, %llu malformed, "
+              "p99 %u us\n", (unsigned long long)packets,
+              (unsigned long long)(packets - last) / interval,
+              (unsigned long long)readings, (unsigned long long)malformed,
+              percentile(w, threads, 99));
+      last = packets;
+    }
+  }
+  workers_stop(w, threads);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,110 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Host collector for the client readings.
+ *
+ *         Listens on UDP_SERVER_PORT with one socket per worker thread
+ *         (SO_REUSEPORT), each drained by epoll and recvmmsg in batches of
+ *         COLLECTOR_BATCH datagrams. Payloads in the msg-codec.h formats
+ *         and the old struct my_meddelande_t layout are decoded into
+ *         preallocated records, with no allocation per packet, and handed
+ *         to a sink one receive batch at a time.
+ *
+ *         Sinks are pluggable, see struct collector_sink. Each worker opens
+ *         its own sink instance, so a sink only has to care about other
+ *         workers when it shares an output with them.
+ */
+
+#ifndef COLLECTOR_H_
+#define COLLECTOR_H_
+
+#include <stdint.h>
+
+#include "msg-codec.h"
+
+/*---------------------------------------------------------------------------*/
+/* Same port as UDP_SERVER_PORT in example.h */
+#define COLLECTOR_PORT            5678
+
+/* Datagrams received per recvmmsg call */
+#define COLLECTOR_BATCH           64
+
+/* Largest payload accepted, a single 802.15.4 frame carries less */
+#define COLLECTOR_PAYLOAD         128
+
+/* Records one receive batch can produce */
+#define COLLECTOR_RECS            (COLLECTOR_BATCH * MSG_BATCH_MAX)
+
+/* A decoded reading and where it came from */
+struct collector_rec {
+  uint64_t rx_ns;            /* Receive time, ns since the epoch */
+  uint8_t node[16];          /* Source IPv6 address, v4-mapped for IPv4 */
+  struct msg_reading r;
+};
+
+/* Output for decoded readings */
+struct collector_sink {
+  const char *name;
+  const char *help;
+  /* Open an instance, arg is the text after "name:" or NULL */
+  void *(*open)(const char *arg);
+  /* Take the records of one receive batch */
+  void (*write)(void *ctx, const struct collector_rec *rec, int num);
+  /* Push out anything buffered, called when the worker is idle */
+  void (*flush)(void *ctx);
+  void (*close)(void *ctx);
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Decode a received payload in any known format
+ * \param buf  Received payload
+ * \param len  Length of the payload
+ * \param r    Decoded readings
+ * \param max  Room in r
+ * \return     Number of readings decoded, 0 if the payload is malformed
+ */
+int collector_decode(const uint8_t *buf, int len, struct msg_reading *r,
+                     int max);
+
+/**
+ * \brief      Find a sink by name, NULL if there is none
+ */
+const struct collector_sink *collector_sink_find(const char *name);
+
+/**
+ * \brief      Print the available sinks
+ */
+void collector_sink_list(void);
+
+/* The MQTT forwarder sink, see collector-mqtt.c */
+void *collector_mqtt_open(const char *arg);
+void collector_mqtt_write(void *ctx, const struct collector_rec *rec, int num);
+void collector_mqtt_flush(void *ctx);
+void collector_mqtt_close(void *ctx);
+/*---------------------------------------------------------------------------*/
+#endif /* COLLECTOR_H_ */
@@ -0,0 +1,201 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Host decoder for the sink's binary log.
+ *
+ *         Reads the sink's serial output, turns the SLIP-framed records of
+ *         udp-server-test/sink-log.h back into text and passes the text
+ *         around them through. With -c it prints the readings as CSV in
+ *         the columns of the collector's csv sink instead, with the node
+ *         as ::<id> and the host receive time, and the other output goes
+ *         to stderr.
+ *
+ *         Usage: log-decode [-c] [-r rtimer_hz] < serial-output
+ *
+ *         e.g. stty -F /dev/ttyUSB0 115200 raw && log-decode < /dev/ttyUSB0
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "msg-codec.h"
+
+/* See udp-server-test/sink-log.h */
+#define REC_LEN                   16
+#define REC_READING               1
+#define REC_PACKET                2
+#define REC_REPLY                 3
+#define REC_STATS                 4
+
+#define SLIP_END                  0300
+#define SLIP_ESC                  0333
+#define SLIP_ESC_END              0334
+#define SLIP_ESC_ESC              0335
+
+/* Clock ticks per second on the motes */
+#define CLOCK_SECOND              128
+
+static int csv;
+static unsigned long rtimer_hz = 32768;   /* Z1 */
+static unsigned long frames;
+static unsigned long bad_frames;
+/*---------------------------------------------------------------------------*/
+static unsigned
+get16(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+get32(const uint8_t *p)
+{
+  return get16(p) | ((unsigned long)get16(p + 2) << 16);
+}
+/*---------------------------------------------------------------------------*/
+static double
+ticks_us(unsigned ticks)
+{
+  return ticks * 1e6 / rtimer_hz;
+}
+/*---------------------------------------------------------------------------*/
+static void
+record(const uint8_t *r)
+{
+  FILE *text = csv ? stderr : stdout;
+  struct timespec now;
+
+  switch(r[0]) {
+  case REC_READING:
+    if(csv) {
+      clock_gettime(CLOCK_REALTIME, &now);
+      printf("%lld.%06ld,::%x,%u,%u,%lu,%u,%s\n", (long long)now.tv_sec,
+             now.tv_nsec / 1000, get16(&r[3]), get16(&r[5]), get16(&r[7]),
+             get32(&r[9]), get16(&r[13]), msg_mode_name(r[15] & 0x0f));
+      fflush(stdout);
+      return;
+    }
+    printf("[%5us] node %04x counter %u battery %u mV rate %lu ticks "
+           "(%.1f s) ", get16(&r[1]), get16(&r[3]), get16(&r[5]),
+           get16(&r[7]), get32(&r[9]), (double)get32(&r[9]) / CLOCK_SECOND);
+    if((r[15] >> 4) & MSG_F_BACKLOG) {
+      printf("age unknown");
+    } else {
+      printf("age %u s", get16(&r[13]));
+    }
+    printf(" mode %s\n", msg_mode_name(r[15] & 0x0f));
+    break;
+  case REC_PACKET:
+    fprintf(text, "[%5us] node %04x packet %u bytes, %u of %u readings, "
+            "rx %u missed %u late %u dups %u, %.0f us\n", get16(&r[1]),
+            get16(&r[3]), r[7], r[6], r[5], get16(&r[8]), get16(&r[10]),
+            r[12], r[13], ticks_us(get16(&r[14])));
+    break;
+  case REC_REPLY:
+    fprintf(text, "[%5us] node %04x reply type %u, %u bytes\n", get16(&r[1]),
+            get16(&r[3]), r[5], r[6]);
+    break;
+  case REC_STATS:
+    fprintf(text, "[%5us] log: %u records dropped, %lu packets, "
+            "at most %.0f us per packet, ring high water %u\n",
+            get16(&r[1]), get16(&r[3]), get32(&r[7]),
+            ticks_us(get16(&r[5])), r[11]);
+    break;
+  default:
+    bad_frames++;
+    return;
+  }
+  fflush(text);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  uint8_t frame[REC_LEN * 2];
+  int in_frame = 0;
+  int esc = 0;
+  int len = 0;
+  int c;
+
+  while((c = getopt(argc, argv, "cr:")) != -1) {
+    switch(c) {
+    case 'c':
+      csv = 1;
+      break;
+    case 'r':
+      rtimer_hz = strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-c] [-r rtimer_hz] < serial-output\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  while((c = getchar()) != EOF) {
+    if(c == SLIP_END) {
+      /* A frame of the right length ends here. Anything else, an empty
+         frame or one we joined halfway, means a frame starts here */
+      if(in_frame && len == REC_LEN) {
+        frames++;
+        record(frame);
+        in_frame = 0;
+      } else {
+        bad_frames += in_frame && len > 0;
+        in_frame = 1;
+      }
+      len = 0;
+      esc = 0;
+      continue;
+    }
+    if(!in_frame) {
+      putc(c, csv ? stderr : stdout);
+      continue;
+    }
+    if(esc) {
+      c = c == SLIP_ESC_END ? SLIP_END : c == SLIP_ESC_ESC ? SLIP_ESC : c;
+      esc = 0;
+    } else if(c == SLIP_ESC) {
+      esc = 1;
+      continue;
+    }
+    if(len == sizeof(frame)) {
+      /* Not ours after all, resynchronise on the next END */
+      bad_frames++;
+      in_frame = 0;
+      len = 0;
+      continue;
+    }
+    frame[len++] = c;
+  }
+  fprintf(stderr, "%lu records, %lu bad frames\n", frames, bad_frames);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
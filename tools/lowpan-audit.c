@@ -0,0 +1,701 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         6LoWPAN header overhead in 802.15.4 captures.
+ *
+ *         Reads pcap or pcapng captures of link type IEEE802_15_4_WITHFCS
+ *         (195, what sensniff writes), IEEE802_15_4_NOFCS (230) or
+ *         IEEE802_15_4_NONASK_PHY (215) and sorts the data frames into
+ *         flows by link-layer source and destination, protocol and
+ *         destination port, or type for ICMPv6. A fragment after the first
+ *         goes to the flow of its first fragment. Prints one line per flow:
+ *
+ *           frames and datagrams, share of datagrams fragmented
+ *           MAC header and FCS bytes per frame
+ *           6LoWPAN, IPv6, extension and UDP header bytes per frame
+ *           application bytes, what is left of the frames
+ *           airtime at 250 kbit/s including preamble, SFD and length
+ *           airtime per application byte
+ *           compression: ipv6 for uncompressed headers, otherwise iphc
+ *           with the source and destination address bytes carried inline,
+ *           e.g. s0d2 for a MAC-derived source and a 16 bit destination,
+ *           m after d for multicast, * if it varied within the flow
+ *
+ *         Addresses are the last two bytes of the link-layer address.
+ *         Acks are counted in the totals only. Frames with security
+ *         enabled, of frame version 2 or with a dispatch other than IPv6,
+ *         IPHC or fragmentation are counted but not audited.
+ *
+ *         Usage: lowpan-audit [-c] capture...
+ *
+ *         -c prints the flows as CSV.
+ */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LINKTYPE_WITHFCS          195
+#define LINKTYPE_NONASK_PHY       215
+#define LINKTYPE_NOFCS            230
+
+/* Preamble, SFD and length byte in front of every PSDU, 32 us a byte */
+#define PHY_HDR_LEN               6
+#define US_PER_BYTE               32
+#define FCS_LEN                   2
+
+/* First fragments remembered to attribute the rest of their datagram */
+#define TAGS                      64
+
+#define MAX_IFACES                16
+
+struct flow {
+  uint8_t src[8];
+  uint8_t dst[8];
+  uint8_t src_len;
+  uint8_t dst_len;
+  uint8_t proto;
+  uint16_t port;
+  char mode[12];
+  uint8_t mixed;
+  uint64_t frames;
+  uint64_t datagrams;
+  uint64_t fragmented;
+  uint64_t mac_bytes;
+  uint64_t lowpan_bytes;
+  uint64_t app_bytes;
+  uint64_t air_us;
+};
+
+struct tag {
+  uint8_t src[8];
+  uint16_t tag;
+  struct flow *flow;
+};
+
+/* One data frame as parsed */
+struct frame {
+  const uint8_t *src;
+  const uint8_t *dst;
+  uint8_t src_len;
+  uint8_t dst_len;
+  unsigned mac_len;
+  unsigned psdu_len;
+};
+
+static struct flow *flows;
+static size_t flows_used;
+static size_t flows_size;
+static struct tag tags[TAGS];
+static unsigned tag_next;
+
+static uint64_t total_frames;
+static uint64_t ack_frames;
+static uint64_t ack_air_us;
+static uint64_t other_frames;
+static uint64_t other_air_us;
+static uint64_t orphans;
+static uint64_t skipped;
+static int csv;
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get16le(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+get16be(const uint8_t *p)
+{
+  return (p[0] << 8) | p[1];
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+get32(const uint8_t *p, int swap)
+{
+  if(swap) {
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+  }
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+/*---------------------------------------------------------------------------*/
+static struct flow *
+lookup(const struct frame *f, uint8_t proto, uint16_t port)
+{
+  struct flow *fl;
+  size_t i;
+
+  for(i = 0; i < flows_used; i++) {
+    fl = &flows[i];
+    if(fl->src_len == f->src_len && fl->dst_len == f->dst_len &&
+       memcmp(fl->src, f->src, f->src_len) == 0 &&
+       memcmp(fl->dst, f->dst, f->dst_len) == 0 &&
+       fl->proto == proto && fl->port == port) {
+      return fl;
+    }
+  }
+  if(flows_used == flows_size) {
+    flows_size = flows_size ? flows_size * 2 : 64;
+    flows = realloc(flows, flows_size * sizeof(*flows));
+    if(flows == NULL) {
+      perror("realloc");
+      exit(1);
+    }
+  }
+  fl = &flows[flows_used++];
+  memset(fl, 0, sizeof(*fl));
+  memcpy(fl->src, f->src, f->src_len);
+  memcpy(fl->dst, f->dst, f->dst_len);
+  fl->src_len = f->src_len;
+  fl->dst_len = f->dst_len;
+  fl->proto = proto;
+  fl->port = port;
+  return fl;
+}
+/*---------------------------------------------------------------------------*/
+static struct tag *
+find_tag(const struct frame *f, uint16_t tag)
+{
+  unsigned i;
+
+  for(i = 0; i < TAGS; i++) {
+    if(tags[i].flow != NULL && tags[i].tag == tag &&
+       memcmp(tags[i].src, f->src, f->src_len) == 0) {
+      return &tags[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+account(struct flow *fl, const struct frame *f, unsigned lowpan_len,
+        const char *mode)
+{
+  fl->frames++;
+  fl->mac_bytes += f->mac_len + FCS_LEN;
+  fl->lowpan_bytes += lowpan_len;
+  fl->app_bytes += f->psdu_len - f->mac_len - FCS_LEN - lowpan_len;
+  fl->air_us += (PHY_HDR_LEN + f->psdu_len) * US_PER_BYTE;
+  if(mode != NULL) {
+    if(fl->mode[0] == '\0') {
+      snprintf(fl->mode, sizeof(fl->mode), "%s", mode);
+    } else if(strcmp(fl->mode, mode) != 0) {
+      fl->mixed = 1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Inline bytes of an IPHC address, RFC 6282 section 3.1.1 */
+static unsigned
+iphc_addr_len(int multicast, int context, int mode)
+{
+  static const uint8_t unicast[4] = { 16, 8, 2, 0 };
+  static const uint8_t mcast[4] = { 16, 6, 4, 1 };
+
+  if(multicast) {
+    return context ? 6 : mcast[mode];
+  }
+  if(context && mode == 0) {
+    return 0;   /* Unspecified address, or reserved for a destination */
+  }
+  return unicast[mode];
+}
+/*---------------------------------------------------------------------------*/
+/*
+ * Walk the IPv6 part of a datagram's first frame: an uncompressed IPv6
+ * header or IPHC, extension headers and UDP or ICMPv6. Returns the header
+ * bytes, 0 if they run past the frame.
+ */
+static unsigned
+ip_headers(const uint8_t *p, unsigned len, char *mode, size_t mode_len,
+           uint8_t *proto, uint16_t *port)
+{
+  unsigned off;
+  unsigned sl, dl;
+  uint8_t nh;
+  int nhc;
+  uint8_t b;
+
+  *proto = 0;
+  *port = 0;
+
+  if(p[0] == 0x41) {
+    if(len < 1 + 40) {
+      return 0;
+    }
+    snprintf(mode, mode_len, "ipv6");
+    nh = p[1 + 6];
+    nhc = 0;
+    off = 1 + 40;
+  } else {
+    if(len < 2) {
+      return 0;
+    }
+    off = 2 + ((p[1] & 0x80) ? 1 : 0);
+    off += (const uint8_t[]){ 4, 3, 1, 0 }[(p[0] >> 3) & 3];
+    nhc = (p[0] & 0x04) != 0;
+    nh = nhc ? 0 : (off < len ? p[off] : 0);
+    off += nhc ? 0 : 1;
+    off += (p[0] & 0x03) == 0 ? 1 : 0;
+    sl = iphc_addr_len(0, p[1] & 0x40, (p[1] >> 4) & 3);
+    dl = iphc_addr_len(p[1] & 0x08, p[1] & 0x04, p[1] & 3);
+    off += sl + dl;
+    snprintf(mode, mode_len, "s%ud%u%s", sl, dl, (p[1] & 0x08) ? "m" : "");
+  }
+
+  /* Extension headers, inline or compressed */
+  for(;;) {
+    if(off > len) {
+      return 0;
+    }
+    if(nhc) {
+      if(off >= len) {
+        return 0;
+      }
+      b = p[off];
+      if((b & 0xf0) != 0xe0) {
+        break;
+      }
+      /* NHC extension header: EID, next header inline unless NH is set */
+      nhc = b & 0x01;
+      off++;
+      if(!nhc) {
+        nh = off < len ? p[off] : 0;
+        off++;
+      }
+      if(off >= len) {
+        return 0;
+      }
+      off += 1 + p[off];
+      continue;
+    }
+    if(nh != 0 && nh != 43 && nh != 60) {
+      break;
+    }
+    if(off + 2 > len) {
+      return 0;
+    }
+    b = p[off];
+    off += (p[off + 1] + 1) * 8;
+    nh = b;
+  }
+
+  if(nhc) {
+    b = p[off];
+    if((b & 0xf8) != 0xf0) {
+      /* Some other compressed header, counted as application data */
+      *proto = 0xff;
+      return off;
+    }
+    /* NHC UDP: ports as per P, checksum unless C */
+    *proto = 17;
+    off++;
+    switch(b & 0x03) {
+    case 0:
+      if(off + 4 > len) {
+        return 0;
+      }
+      *port = get16be(&p[off + 2]);
+      off += 4;
+      break;
+    case 1:
+      if(off + 3 > len) {
+        return 0;
+      }
+      *port = 0xf000 | p[off + 2];
+      off += 3;
+      break;
+    case 2:
+      if(off + 3 > len) {
+        return 0;
+      }
+      *port = get16be(&p[off + 1]);
+      off += 3;
+      break;
+    default:
+      if(off + 1 > len) {
+        return 0;
+      }
+      *port = 0xf0b0 | (p[off] & 0x0f);
+      off += 1;
+      break;
+    }
+    off += (b & 0x04) ? 0 : 2;
+    return off <= len ? off : 0;
+  }
+
+  *proto = nh;
+  if(nh == 17) {
+    if(off + 8 > len) {
+      return 0;
+    }
+    *port = get16be(&p[off + 2]);
+    off += 8;
+  } else if(nh == 58) {
+    if(off + 4 > len) {
+      return 0;
+    }
+    *port = p[off];
+    off += 4;
+  }
+  return off;
+}
+/*---------------------------------------------------------------------------*/
+static void
+lowpan(const struct frame *f, const uint8_t *p, unsigned len)
+{
+  struct flow *fl;
+  struct tag *t;
+  char mode[12];
+  unsigned frag_len = 0;
+  unsigned hdr;
+  uint16_t tag = 0;
+  uint16_t port;
+  uint8_t proto;
+
+  if(len >= 5 && (p[0] & 0xf8) == 0xe0) {
+    /* Later fragment, all of it application data of the first one's flow */
+    t = find_tag(f, get16be(&p[2]));
+    if(t == NULL) {
+      orphans++;
+      other_frames++;
+      other_air_us += (PHY_HDR_LEN + f->psdu_len) * US_PER_BYTE;
+      return;
+    }
+    account(t->flow, f, 5, NULL);
+    return;
+  }
+  if(len >= 4 && (p[0] & 0xf8) == 0xc0) {
+    tag = get16be(&p[2]);
+    frag_len = 4;
+    p += 4;
+    len -= 4;
+  }
+  if(len == 0 || (p[0] != 0x41 && (p[0] & 0xe0) != 0x60) ||
+     (hdr = ip_headers(p, len, mode, sizeof(mode), &proto, &port)) == 0) {
+    other_frames++;
+    other_air_us += (PHY_HDR_LEN + f->psdu_len) * US_PER_BYTE;
+    return;
+  }
+
+  fl = lookup(f, proto, port);
+  fl->datagrams++;
+  if(frag_len > 0) {
+    fl->fragmented++;
+    t = find_tag(f, tag);
+    if(t == NULL) {
+      t = &tags[tag_next];
+      tag_next = (tag_next + 1) % TAGS;
+    }
+    memcpy(t->src, f->src, f->src_len);
+    t->tag = tag;
+    t->flow = fl;
+  }
+  account(fl, f, frag_len + hdr, mode);
+}
+/*---------------------------------------------------------------------------*/
+/* One captured PSDU, FCS already dropped from data */
+static void
+frame(const uint8_t *data, unsigned caplen, unsigned psdu_len)
+{
+  static const uint8_t addr_len[4] = { 0, 0, 2, 8 };
+  struct frame f;
+  uint16_t fcf;
+  unsigned off;
+
+  total_frames++;
+  if(caplen < 3) {
+    skipped++;
+    return;
+  }
+  fcf = get16le(data);
+  if((fcf & 7) == 2) {
+    ack_frames++;
+    ack_air_us += (PHY_HDR_LEN + psdu_len) * US_PER_BYTE;
+    return;
+  }
+  if((fcf & 7) != 1 || (fcf & 0x08) || ((fcf >> 12) & 3) > 1) {
+    other_frames++;
+    other_air_us += (PHY_HDR_LEN + psdu_len) * US_PER_BYTE;
+    return;
+  }
+
+  /* Sequence number, then destination PAN and address, then source PAN
+     unless PAN ID compression, then source address */
+  off = 3;
+  f.dst_len = addr_len[(fcf >> 10) & 3];
+  f.src_len = addr_len[(fcf >> 14) & 3];
+  off += f.dst_len ? 2 : 0;
+  f.dst = &data[off];
+  off += f.dst_len;
+  off += (f.src_len && !(fcf & 0x40)) ? 2 : 0;
+  f.src = &data[off];
+  off += f.src_len;
+  if(off > caplen || psdu_len < off + FCS_LEN) {
+    skipped++;
+    return;
+  }
+  f.mac_len = off;
+  f.psdu_len = psdu_len;
+  lowpan(&f, &data[off], caplen - off);
+}
+/*---------------------------------------------------------------------------*/
+/* A captured packet of the given link type */
+static void
+packet(unsigned linktype, const uint8_t *data, unsigned caplen,
+       unsigned origlen)
+{
+  switch(linktype) {
+  case LINKTYPE_NONASK_PHY:
+    /* Preamble, SFD and length in front, FCS at the end */
+    if(caplen < 6 || origlen < 6) {
+      skipped++;
+      return;
+    }
+    data += 6;
+    caplen -= 6;
+    origlen -= 6;
+    /* Fall through */
+  case LINKTYPE_WITHFCS:
+    if(caplen == origlen) {
+      caplen = caplen >= FCS_LEN ? caplen - FCS_LEN : 0;
+    }
+    frame(data, caplen, origlen);
+    break;
+  case LINKTYPE_NOFCS:
+    frame(data, caplen, origlen + FCS_LEN);
+    break;
+  default:
+    skipped++;
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_pcap(const uint8_t *buf, size_t len)
+{
+  uint32_t magic = get32(buf, 0);
+  int swap = magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1;
+  unsigned linktype = get32(&buf[20], swap);
+  size_t off = 24;
+  uint32_t caplen;
+
+  while(off + 16 <= len) {
+    caplen = get32(&buf[off + 8], swap);
+    if(off + 16 + caplen > len) {
+      break;
+    }
+    packet(linktype, &buf[off + 16], caplen, get32(&buf[off + 12], swap));
+    off += 16 + caplen;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_pcapng(const uint8_t *buf, size_t len)
+{
+  unsigned linktypes[MAX_IFACES];
+  unsigned ifaces = 0;
+  unsigned iface;
+  uint32_t type, blen, caplen, origlen;
+  size_t off = 0;
+  int swap = 0;
+
+  while(off + 12 <= len) {
+    type = get32(&buf[off], swap);
+    if(type == 0x0a0d0d0a) {
+      /* Section header, its byte order magic sets ours */
+      swap = get32(&buf[off + 8], 0) != 0x1a2b3c4d;
+      ifaces = 0;
+    }
+    blen = get32(&buf[off + 4], swap);
+    if(blen < 12 || off + blen > len) {
+      break;
+    }
+    if(type == 1 && blen >= 20) {
+      if(ifaces < MAX_IFACES) {
+        linktypes[ifaces++] = swap ? get16be(&buf[off + 8]) :
+                                     get16le(&buf[off + 8]);
+      }
+    } else if(type == 6 && blen >= 32) {
+      iface = get32(&buf[off + 8], swap);
+      caplen = get32(&buf[off + 20], swap);
+      origlen = get32(&buf[off + 24], swap);
+      if(iface < ifaces && caplen <= blen - 32) {
+        packet(linktypes[iface], &buf[off + 28], caplen, origlen);
+      } else {
+        skipped++;
+      }
+    } else if(type == 3 && blen >= 16 && ifaces > 0) {
+      origlen = get32(&buf[off + 8], swap);
+      caplen = origlen < blen - 16 ? origlen : blen - 16;
+      packet(linktypes[0], &buf[off + 12], caplen, origlen);
+    }
+    off += blen;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+read_capture(const char *name)
+{
+  FILE *fp;
+  uint8_t *buf = NULL;
+  size_t len = 0;
+  size_t size = 0;
+  size_t n;
+  uint32_t magic;
+  int ret = -1;
+
+  fp = fopen(name, "rb");
+  if(fp == NULL) {
+    perror(name);
+    return -1;
+  }
+  do {
+    if(len == size) {
+      size = size ? size * 2 : 1 << 16;
+      buf = realloc(buf, size);
+      if(buf == NULL) {
+        perror("realloc");
+        exit(1);
+      }
+    }
+    n = fread(buf + len, 1, size - len, fp);
+    len += n;
+  } while(n > 0);
+  fclose(fp);
+
+  magic = len >= 24 ? get32(buf, 0) : 0;
+  if(magic == 0x0a0d0d0a) {
+    ret = read_pcapng(buf, len);
+  } else if(magic == 0xa1b2c3d4 || magic == 0xd4c3b2a1 ||
+            magic == 0xa1b23c4d || magic == 0x4d3cb2a1) {
+    ret = read_pcap(buf, len);
+  } else {
+    fprintf(stderr, "%s: not a pcap or pcapng capture\n", name);
+  }
+  free(buf);
+  return ret;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_addr(char *out, const uint8_t *a, uint8_t len)
+{
+  /* Addresses are little endian in the frame, the last bytes come first */
+  if(len == 0) {
+    sprintf(out, "-");
+  } else {
+    sprintf(out, "%02x%02x", a[1], a[0]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_flow(const struct flow *fl)
+{
+  char src[8], dst[8];
+  char mode[16];
+  double frames = fl->frames ? fl->frames : 1;
+
+  print_addr(src, fl->src, fl->src_len);
+  print_addr(dst, fl->dst, fl->dst_len);
+  snprintf(mode, sizeof(mode), "%s%s", fl->mode, fl->mixed ? "*" : "");
+  if(csv) {
+    printf("%s,%s,%u,%u,%" PRIu64 ",%" PRIu64 ",%.3f,%.1f,%.1f,%"
+           PRIu64 ",%" PRIu64 ",%.2f,%s\n", src, dst, fl->proto,
+           fl->port, fl->frames, fl->datagrams,
+           fl->datagrams ? (double)fl->fragmented / fl->datagrams : 0,
+           fl->mac_bytes / frames, fl->lowpan_bytes / frames,
+           fl->app_bytes, fl->air_us,
+           fl->app_bytes ? (double)fl->air_us / fl->app_bytes : 0, mode);
+    return;
+  }
+  printf("%-4s %-4s %5u %5u %7" PRIu64 " %7" PRIu64 " %5.1f%% %5.1f "
+         "%6.1f %9" PRIu64 " %10" PRIu64 " %7.2f  %s\n", src, dst,
+         fl->proto, fl->port, fl->frames, fl->datagrams,
+         fl->datagrams ? 100.0 * fl->fragmented / fl->datagrams : 0,
+         fl->mac_bytes / frames, fl->lowpan_bytes / frames, fl->app_bytes,
+         fl->air_us,
+         fl->app_bytes ? (double)fl->air_us / fl->app_bytes : 0, mode);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  uint64_t app = 0;
+  uint64_t air = 0;
+  size_t i;
+  int c;
+
+  while((c = getopt(argc, argv, "c")) != -1) {
+    switch(c) {
+    case 'c':
+      csv = 1;
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-c] capture...\n", argv[0]);
+      return 1;
+    }
+  }
+  if(optind >= argc) {
+    fprintf(stderr, "Usage: %s [-c] capture...\n", argv[0]);
+    return 1;
+  }
+  for(; optind < argc; optind++) {
+    read_capture(argv[optind]);
+  }
+
+  if(csv) {
+    printf("src,dst,proto,port,frames,datagrams,fragmented,"
+           "mac_per_frame,lowpan_per_frame,app_bytes,air_us,"
+           "us_per_app_byte,mode\n");
+  } else {
+    printf("%-4s %-4s %5s %5s %7s %7s %6s %5s %6s %9s %10s %7s  %s\n",
+           "src", "dst", "proto", "port", "frames", "dgrams", "frag",
+           "mac", "lowpan", "app", "air_us", "us/B", "mode");
+  }
+  for(i = 0; i < flows_used; i++) {
+    print_flow(&flows[i]);
+    app += flows[i].app_bytes;
+    air += flows[i].air_us;
+  }
+
+  fprintf(csv ? stderr : stdout,
+          "%" PRIu64 " frames, %zu flows, %" PRIu64 " application bytes in "
+          "%" PRIu64 " us, %.2f us/B\n"
+          "%" PRIu64 " acks in %" PRIu64 " us, %" PRIu64 " other frames in %"
+          PRIu64 " us (%" PRIu64 " fragments without a first), %" PRIu64
+          " skipped\n", total_frames, flows_used, app, air,
+          app ? (double)air / app : 0, ack_frames, ack_air_us, other_frames,
+          other_air_us, orphans, skipped);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
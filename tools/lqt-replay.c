@@ -0,0 +1,275 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Native replay of battery traces through the LQ tracking send
+ *         rate controller, udp-client-test/lqt.c, built from the same
+ *         source as the firmware.
+ *
+ *         Reads one battery sample per line, "<seconds> <mV>", and steps
+ *         the controller every TICK seconds as the client's pid_timer
+ *         does, with the battery interpolated between samples. Prints the
+ *         packets the controller would have sent over the trace next to
+ *         the threshold ladder it replaced, and the time spent under the
+ *         low and critical levels. The trace is replayed as recorded, the
+ *         send rate does not feed back into it.
+ *
+ *         Usage: lqt-replay [-v] [-c] [-p err,slope,integ] [-t mV]
+ *                           [-r mHz] < trace
+ *                lqt-replay -g days > trace
+ *
+ *         -v prints every tick as CSV, -c checks that the rate stays in
+ *         bounds and moves with the battery and exits 1 if not. -p, -t
+ *         and -r set the gains, the battery target and the feed-forward
+ *         rate, by default those of udp-client-test.c. -g writes a
+ *         synthetic trace of a few diurnal harvest cycles with a battery
+ *         swap in the middle.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "contiki.h"
+#include "lqt.h"
+
+/* Controller period, as the pid_timer in udp-client-test.c */
+#define TICK                      5
+
+/* Battery levels of udp-client-test.c */
+#define CRIT_BAT                  2700
+#define LOW_BAT                   2900
+#define HIGH_BAT                  3400
+
+/* Around the target, the band in which -c does not look at the rate */
+#define CHECK_BAND                100
+
+struct run {
+  double packets;
+  int16_t rate_min;
+  int16_t rate_max;
+};
+/*---------------------------------------------------------------------------*/
+/* The send interval the client used before lqt.c, in seconds */
+static double
+ladder_interval(int16_t bat)
+{
+  if(bat < CRIT_BAT) {
+    return 100;
+  }
+  if(bat < LOW_BAT) {
+    return 50;
+  }
+  if(bat > HIGH_BAT) {
+    return 0.5;
+  }
+  return 5;
+}
+/*---------------------------------------------------------------------------*/
+static void
+account(struct run *r, double interval, int16_t rate)
+{
+  r->packets += TICK / interval;
+  if(rate < r->rate_min) {
+    r->rate_min = rate;
+  }
+  if(rate > r->rate_max) {
+    r->rate_max = rate;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+generate(int days)
+{
+  unsigned long t;
+  unsigned long end = days * 86400UL;
+  uint32_t seed = 1;
+  double mv;
+  double noise;
+
+  printf("# synthetic trace, %d days, seconds mV\n", days);
+  for(t = 0; t <= end; t += 60) {
+    seed = seed * 1103515245 + 12345;
+    noise = (double)((seed >> 16) % 21) - 10;
+    /* Charged by day, drained by night, slowly losing capacity */
+    mv = 3100 + 300 * sin(2 * M_PI * ((double)t / 86400 - 0.25)) -
+         (double)t / 3600 + noise;
+    /* The battery is swapped for a fuller one half way */
+    if(t >= end / 2) {
+      mv += 600;
+    }
+    printf("%lu %d\n", t, (int)mv);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+usage(void)
+{
+  fprintf(stderr, "usage: lqt-replay [-v] [-c] [-p err,slope,integ] "
+          "[-t mV] [-r mHz] < trace\n"
+          "       lqt-replay -g days > trace\n");
+  exit(2);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  int16_t param_vector[LQT_PARAM_LEN] = { 920, 1024, 13 };
+  int16_t feature_vector[LQT_FEATURE_LEN] = { 0 };
+  int16_t init_vector[LQT_FEATURE_LEN] = { 0, 200, 3200, 0 };
+  struct run lqt = { 0, LQT_RATE_MAX, LQT_RATE_MIN };
+  struct run ladder = { 0, LQT_RATE_MAX, LQT_RATE_MIN };
+  unsigned long t0 = 0, t1, tick = 0, ticks = 0;
+  unsigned long below_low = 0, below_crit = 0;
+  double above_sum = 0, below_sum = 0;
+  unsigned long above_n = 0, below_n = 0;
+  unsigned long bounds_failed = 0;
+  int mv0 = 0, mv1;
+  int have = 0;
+  int verbose = 0, check = 0;
+  int16_t bat;
+  clock_time_t interval;
+  char line[128];
+  int opt;
+
+  while((opt = getopt(argc, argv, "vcp:t:r:g:")) != -1) {
+    switch(opt) {
+    case 'v':
+      verbose = 1;
+      break;
+    case 'c':
+      check = 1;
+      break;
+    case 'p':
+      if(sscanf(optarg, "%hd,%hd,%hd", &param_vector[LQT_K_ERR],
+                &param_vector[LQT_K_SLOPE], &param_vector[LQT_K_INTEG]) != 3) {
+        usage();
+      }
+      break;
+    case 't':
+      init_vector[LQT_F_TARGET] = atoi(optarg);
+      break;
+    case 'r':
+      init_vector[LQT_F_RATE] = atoi(optarg);
+      break;
+    case 'g':
+      generate(atoi(optarg));
+      return 0;
+    default:
+      usage();
+    }
+  }
+
+  if(verbose) {
+    printf("t,mv,lqt_mhz,lqt_interval_s,ladder_interval_s\n");
+  }
+
+  while(fgets(line, sizeof(line), stdin) != NULL) {
+    if(line[0] == '#' || sscanf(line, "%lu %d", &t1, &mv1) != 2) {
+      continue;
+    }
+    if(!have) {
+      t0 = t1;
+      mv0 = mv1;
+      tick = t1;
+      have = 1;
+    }
+
+    /* Every tick up to this sample, the battery on the line between the
+       two samples */
+    for(; tick <= t1; tick += TICK) {
+      bat = t1 > t0 ? mv0 + (long)(mv1 - mv0) * (long)(tick - t0) /
+        (long)(t1 - t0) : mv1;
+      interval = get_send_rate(bat, param_vector, feature_vector,
+                               init_vector);
+
+      account(&lqt, (double)interval / CLOCK_SECOND,
+              feature_vector[LQT_F_RATE]);
+      account(&ladder, ladder_interval(bat),
+              (int16_t)(1000 / ladder_interval(bat)));
+      ticks++;
+      below_low += bat < LOW_BAT;
+      below_crit += bat < CRIT_BAT;
+
+      if(interval == 0 ||
+         feature_vector[LQT_F_RATE] < LQT_RATE_MIN ||
+         feature_vector[LQT_F_RATE] > LQT_RATE_MAX) {
+        bounds_failed++;
+      }
+      if(bat > init_vector[LQT_F_TARGET] + CHECK_BAND) {
+        above_sum += feature_vector[LQT_F_RATE];
+        above_n++;
+      } else if(bat < init_vector[LQT_F_TARGET] - CHECK_BAND) {
+        below_sum += feature_vector[LQT_F_RATE];
+        below_n++;
+      }
+
+      if(verbose) {
+        printf("%lu,%d,%d,%.2f,%.1f\n", tick, bat,
+               feature_vector[LQT_F_RATE], (double)interval / CLOCK_SECOND,
+               ladder_interval(bat));
+      }
+    }
+    t0 = t1;
+    mv0 = mv1;
+  }
+
+  if(ticks == 0) {
+    fprintf(stderr, "lqt-replay: no samples\n");
+    return 1;
+  }
+
+  fprintf(verbose ? stderr : stdout,
+          "%lu ticks over %.1f h, %.1f%% under %d mV, %.1f%% under %d mV\n"
+          "          packets    per h  min mHz  max mHz\n"
+          "lqt    %10.0f %8.1f %8d %8d\n"
+          "ladder %10.0f %8.1f %8d %8d\n",
+          ticks, ticks * TICK / 3600.0,
+          100.0 * below_low / ticks, LOW_BAT,
+          100.0 * below_crit / ticks, CRIT_BAT,
+          lqt.packets, lqt.packets * 3600 / (ticks * TICK),
+          lqt.rate_min, lqt.rate_max,
+          ladder.packets, ladder.packets * 3600 / (ticks * TICK),
+          ladder.rate_min, ladder.rate_max);
+
+  if(!check) {
+    return 0;
+  }
+  fflush(stdout);
+  if(bounds_failed > 0) {
+    fprintf(stderr, "FAIL: rate out of bounds in %lu ticks\n", bounds_failed);
+    return 1;
+  }
+  if(above_n > 0 && below_n > 0 && above_sum / above_n <= below_sum / below_n) {
+    fprintf(stderr, "FAIL: mean rate above the target %.0f mHz, "
+            "below it %.0f mHz\n", above_sum / above_n, below_sum / below_n);
+    return 1;
+  }
+  fprintf(stderr, "OK\n");
+  return 0;
+}
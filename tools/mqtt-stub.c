@@ -0,0 +1,304 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Stand-in MQTT broker for testing the collector's forwarder.
+ *
+ *         Accepts MQTT 3.1.1 clients, acks every QoS 1 publish and drops
+ *         it. Counts the readings in each publish by their "time" values
+ *         and reports publishes/s, readings/s and the p50/p99 latency from
+ *         collector receive to broker, every interval.
+ *
+ *         Usage: mqtt-stub [-p port] [-i interval] [-S after,seconds]
+ *
+ *         -S stops reading from the clients for the given seconds once
+ *         after the given seconds, as a stalled broker would.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#define MAX_CLIENTS               64
+#define CLIENT_BUF                65536
+
+/* Latency histogram, 100 us buckets and one for everything above */
+#define LAT_BUCKET_US             100
+#define LAT_BUCKETS               100000
+
+struct client {
+  int fd;
+  int len;
+  uint8_t buf[CLIENT_BUF];
+};
+
+static struct client clients[MAX_CLIENTS];
+static uint32_t lat[LAT_BUCKETS + 1];
+static uint64_t publishes;
+static uint64_t readings;
+/*---------------------------------------------------------------------------*/
+static uint64_t
+now_us(clockid_t clock)
+{
+  struct timespec ts;
+
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+/*---------------------------------------------------------------------------*/
+static double
+percentile(double p)
+{
+  uint64_t total = 0;
+  uint64_t seen = 0;
+  int i;
+
+  for(i = 0; i <= LAT_BUCKETS; i++) {
+    total += lat[i];
+  }
+  for(i = 0; i <= LAT_BUCKETS; i++) {
+    seen += lat[i];
+    if(total > 0 && seen >= total * p) {
+      return (i + 1) * LAT_BUCKET_US / 1000.0;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+payload(const uint8_t *p, int len)
+{
+  static const char key[] = "\"time\",\"value\":";
+  const char *s = (const char *)p;
+  const char *end = s + len;
+  uint64_t now = now_us(CLOCK_REALTIME);
+  uint64_t t;
+  uint64_t l;
+
+  while((s = memmem(s, end - s, key, sizeof(key) - 1)) != NULL) {
+    s += sizeof(key) - 1;
+    t = strtoull(s, NULL, 10);
+    l = now > t ? (now - t) / LAT_BUCKET_US : 0;
+    lat[l < LAT_BUCKETS ? l : LAT_BUCKETS]++;
+    readings++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Handle the complete packets in the buffer, -1 to drop the client */
+static int
+packets(struct client *c)
+{
+  uint8_t reply[4];
+  uint32_t remaining;
+  int hdr;
+  int pos;
+  int tlen;
+  int shift;
+
+  for(;;) {
+    remaining = 0;
+    shift = 0;
+    for(hdr = 1; hdr < c->len && hdr <= 4; hdr++) {
+      remaining |= (uint32_t)(c->buf[hdr] & 0x7f) << shift;
+      shift += 7;
+      if((c->buf[hdr] & 0x80) == 0) {
+        break;
+      }
+    }
+    if(hdr >= c->len) {
+      return 0;
+    }
+    if(hdr > 4 || remaining > CLIENT_BUF - 5) {
+      return -1;
+    }
+    hdr++;
+    if(c->len < hdr + (int)remaining) {
+      return 0;
+    }
+
+    switch(c->buf[0] & 0xf0) {
+    case 0x10:                             /* CONNECT */
+      reply[0] = 0x20;
+      reply[1] = 2;
+      reply[2] = 0;
+      reply[3] = 0;
+      write(c->fd, reply, 4);
+      break;
+    case 0x30:                             /* PUBLISH */
+      pos = hdr;
+      tlen = (c->buf[pos] << 8) | c->buf[pos + 1];
+      pos += 2 + tlen;
+      if((c->buf[0] & 0x06) != 0) {
+        reply[0] = 0x40;
+        reply[1] = 2;
+        reply[2] = c->buf[pos];
+        reply[3] = c->buf[pos + 1];
+        write(c->fd, reply, 4);
+        pos += 2;
+      }
+      publishes++;
+      payload(&c->buf[pos], hdr + remaining - pos);
+      break;
+    case 0xc0:                             /* PINGREQ */
+      reply[0] = 0xd0;
+      reply[1] = 0;
+      write(c->fd, reply, 2);
+      break;
+    case 0xe0:                             /* DISCONNECT */
+      return -1;
+    }
+    c->len -= hdr + remaining;
+    memmove(c->buf, &c->buf[hdr + remaining], c->len);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  struct sockaddr_in6 addr;
+  struct epoll_event ev, events[MAX_CLIENTS];
+  struct client *c;
+  uint64_t start = 0, now, last, stall_at = 0, stall_for = 0;
+  uint64_t last_pub = 0, last_read = 0;
+  int port = 1883;
+  int interval = 1;
+  int lfd, ep, fd;
+  int on = 1;
+  int n, i, r;
+  int opt;
+
+  while((opt = getopt(argc, argv, "p:i:S:")) != -1) {
+    switch(opt) {
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'i':
+      interval = atoi(optarg);
+      break;
+    case 'S':
+      if(sscanf(optarg, "%llu,%llu", (unsigned long long *)&stall_at,
+                (unsigned long long *)&stall_for) != 2) {
+        fprintf(stderr, "bad -S %s\n", optarg);
+        return 1;
+      }
+      stall_at *= 1000000;
+      stall_for *= 1000000;
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-p port] [-i interval] "
+              "[-S after,seconds]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  lfd = socket(AF_INET6, SOCK_STREAM, 0);
+  setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(port);
+  if(bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+     listen(lfd, 16) < 0) {
+    perror("listen");
+    return 1;
+  }
+  ep = epoll_create1(0);
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  epoll_ctl(ep, EPOLL_CTL_ADD, lfd, &ev);
+  for(i = 0; i < MAX_CLIENTS; i++) {
+    clients[i].fd = -1;
+  }
+  fprintf(stderr, "Broker stand-in on port %d\n", port);
+  printf("publishes/s  readings/s  p50_ms  p99_ms\n");
+
+  last = now_us(CLOCK_MONOTONIC);
+  for(;;) {
+    now = now_us(CLOCK_MONOTONIC);
+    if(start > 0 && stall_for > 0 && now - start >= stall_at &&
+       now - start < stall_at + stall_for) {
+      usleep(10000);
+      n = 0;
+    } else {
+      n = epoll_wait(ep, events, MAX_CLIENTS, 100);
+    }
+    for(i = 0; i < n; i++) {
+      c = events[i].data.ptr;
+      if(c == NULL) {
+        fd = accept(lfd, NULL, NULL);
+        for(r = 0; r < MAX_CLIENTS && clients[r].fd >= 0; r++);
+        if(fd < 0 || r == MAX_CLIENTS) {
+          close(fd);
+          continue;
+        }
+        clients[r].fd = fd;
+        clients[r].len = 0;
+        ev.events = EPOLLIN;
+        ev.data.ptr = &clients[r];
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+        continue;
+      }
+      r = read(c->fd, &c->buf[c->len], CLIENT_BUF - c->len);
+      if(r > 0) {
+        c->len += r;
+        if(start == 0) {
+          start = now;
+        }
+      }
+      if(r <= 0 || packets(c) < 0) {
+        close(c->fd);
+        c->fd = -1;
+      }
+    }
+
+    now = now_us(CLOCK_MONOTONIC);
+    if(now - last >= (uint64_t)interval * 1000000 && publishes > last_pub) {
+      printf("%11.0f %11.0f %7.1f %7.1f\n",
+             (publishes - last_pub) * 1e6 / (now - last),
+             (readings - last_read) * 1e6 / (now - last),
+             percentile(0.5), percentile(0.99));
+      fflush(stdout);
+      memset(lat, 0, sizeof(lat));
+      last_pub = publishes;
+      last_read = readings;
+      last = now;
+    } else if(now - last >= (uint64_t)interval * 1000000) {
+      last = now;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,137 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+
+#include "msg-batch.h"
+
+#define CACHE_LINE                64
+/*---------------------------------------------------------------------------*/
+static void *
+column(uint32_t cap, size_t width)
+{
+  size_t size = (cap * width + CACHE_LINE - 1) & ~(size_t)(CACHE_LINE - 1);
+
+  return aligned_alloc(CACHE_LINE, size ? size : CACHE_LINE);
+}
+/*---------------------------------------------------------------------------*/
+int
+msg_cols_alloc(struct msg_cols *c, uint32_t cap)
+{
+  c->cap = cap;
+  c->payload = column(cap, sizeof(*c->payload));
+  c->counter = column(cap, sizeof(*c->counter));
+  c->battery = column(cap, sizeof(*c->battery));
+  c->data_rate = column(cap, sizeof(*c->data_rate));
+  c->age = column(cap, sizeof(*c->age));
+  c->mode = column(cap, sizeof(*c->mode));
+  c->fields = column(cap, sizeof(*c->fields));
+  if(c->payload == NULL || c->counter == NULL || c->battery == NULL ||
+     c->data_rate == NULL || c->age == NULL || c->mode == NULL ||
+     c->fields == NULL) {
+    msg_cols_free(c);
+    return -1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+msg_cols_free(struct msg_cols *c)
+{
+  free(c->payload);
+  free(c->counter);
+  free(c->battery);
+  free(c->data_rate);
+  free(c->age);
+  free(c->mode);
+  free(c->fields);
+  c->cap = 0;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+msg_batch_decode(const uint8_t *base, size_t stride, const uint32_t *len,
+                 uint32_t n, struct msg_cols *out, uint8_t *count)
+{
+  /* Column pointers held locally, the stores through them could
+     otherwise alias out and force a reload per field */
+  uint32_t *restrict payload = out->payload;
+  uint16_t *restrict counter = out->counter;
+  uint16_t *restrict battery = out->battery;
+  uint32_t *restrict data_rate = out->data_rate;
+  uint32_t *restrict age = out->age;
+  uint8_t *restrict mode = out->mode;
+  uint8_t *restrict fields = out->fields;
+  struct msg_cursor c;
+  struct msg_reading r;
+  const uint8_t *p;
+  uint32_t total = 0;
+  uint32_t start;
+  uint32_t i;
+  uint8_t type;
+  uint8_t batch;
+  uint8_t ok;
+
+  /* Headers first: readings claimed by each payload, 0 if the version,
+     type or count is wrong. Selects instead of branches, so the compiler
+     can vectorise it */
+  for(i = 0, p = base; i < n; i++, p += stride) {
+    type = p[0] & 0x0f;
+    batch = (type == MSG_TYPE_BATCH) | (type == MSG_TYPE_BATCH_DELTA);
+    ok = (len[i] >= 1) & ((p[0] >> 4) == MSG_VERSION);
+    ok &= (type == MSG_TYPE_READING) |
+      (batch & (len[i] >= MSG_BATCH_HDR_LEN) & (p[1] <= MSG_BATCH_MAX));
+    count[i] = ok ? (batch ? p[1] : 1) : 0;
+  }
+
+  /* Then the readings, each payload whole or not at all */
+  for(i = 0, p = base; i < n; i++, p += stride) {
+    if(count[i] == 0) {
+      continue;
+    }
+    if(count[i] > out->cap - total ||
+       msg_cursor_init(&c, p, len[i]) != count[i]) {
+      count[i] = 0;
+      continue;
+    }
+    start = total;
+    while(msg_cursor_next(&c, &r)) {
+      payload[total] = i;
+      counter[total] = r.counter;
+      battery[total] = r.battery;
+      data_rate[total] = r.data_rate;
+      age[total] = r.age;
+      mode[total] = r.mode;
+      fields[total] = r.fields;
+      total++;
+    }
+    if(c.next < c.num) {
+      total = start;
+      count[i] = 0;
+    }
+  }
+  return total;
+}
+/*---------------------------------------------------------------------------*/
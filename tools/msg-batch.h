@@ -0,0 +1,90 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Host batch decoder for received payloads.
+ *
+ *         Decodes many payloads per call into one column per field
+ *         (structure of arrays), the layout the collector's sinks and
+ *         scans want. Payloads lie at a fixed stride, as recvmmsg leaves
+ *         them, so a first pass can check every header and add up the
+ *         readings claimed in a tight loop over the batch before a second
+ *         pass decodes the readings with the length checks of msg-codec.
+ */
+
+#ifndef MSG_BATCH_H_
+#define MSG_BATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "msg-codec.h"
+
+/*---------------------------------------------------------------------------*/
+/* Decoded readings, column i of every array belongs to reading i */
+struct msg_cols {
+  uint32_t cap;
+  uint32_t *payload;         /* Index of the payload it came from */
+  uint16_t *counter;
+  uint16_t *battery;
+  uint32_t *data_rate;
+  uint32_t *age;
+  uint8_t *mode;
+  uint8_t *fields;
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Allocate columns for cap readings, cache line aligned
+ * \return     0, or -1 if out of memory
+ */
+int msg_cols_alloc(struct msg_cols *c, uint32_t cap);
+
+/**
+ * \brief      Free columns allocated by msg_cols_alloc()
+ */
+void msg_cols_free(struct msg_cols *c);
+
+/**
+ * \brief      Validate and decode a batch of payloads
+ * \param base First payload
+ * \param stride Bytes from one payload to the next, at least
+ *             MSG_BATCH_HDR_LEN as the header bytes are read whatever len
+ * \param len  Length of each payload
+ * \param n    Number of payloads
+ * \param out  Decoded readings, appended in payload order
+ * \param count Readings decoded from each payload, 0 if it is malformed
+ *             or not a reading or batch
+ * \return     Number of readings decoded
+ *
+ *             A payload is decoded whole or not at all. Payloads that no
+ *             longer fit in out are counted as 0.
+ */
+uint32_t msg_batch_decode(const uint8_t *base, size_t stride,
+                          const uint32_t *len, uint32_t n,
+                          struct msg_cols *out, uint8_t *count);
+/*---------------------------------------------------------------------------*/
+#endif /* MSG_BATCH_H_ */
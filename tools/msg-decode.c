@@ -0,0 +1,581 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Host decoder for the client readings.
+ *
+ *         Reads one UDP payload per line as hex (as copied from Wireshark,
+ *         separators are ignored) and prints the decoded readings and
+ *         control messages. Payloads in the old struct my_meddelande_t
+ *         layout are also recognised.
+ *
+ *         Usage: msg-decode < payloads.txt
+ *                msg-decode -b payloads
+ *                msg-decode -f rounds
+ *
+ *         -b times decoding the given number of generated payloads, one
+ *         at a time and with msg_batch_decode(), and checks that both
+ *         agree.
+ *
+ *         -f encodes random readings, batches, controls, acks and slots
+ *         and checks that every decoder gives them back. It then feeds
+ *         the decoders truncated, bit-flipped and random payloads and
+ *         checks that the reading decoders agree with each other. It
+ *         exits 1 at the first failure. make fuzz-decode runs it built
+ *         with the address and undefined behavior sanitizers.
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "msg-codec.h"
+#include "msg-batch.h"
+
+#define LINE_LEN                 1024
+#define PAYLOAD_LEN              (LINE_LEN / 2)
+
+/* Benchmark: room per generated payload, one in this many is corrupted */
+#define BENCH_STRIDE             128
+#define BENCH_CORRUPT            16
+
+/* Fuzzing: room for a payload, the bytes a random payload may have */
+#define FUZZ_LEN                 128
+#define FUZZ_RANDOM_LEN          48
+
+/* Size of struct my_meddelande_t as laid out by msp430-gcc */
+#define LEGACY_LEN               82
+#define LEGACY_MODE_LEN          73
+
+/*---------------------------------------------------------------------------*/
+static int
+hex_value(int c)
+{
+  if(c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c = tolower(c);
+  if(c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+parse_hex(const char *line, uint8_t *buf, int len)
+{
+  int n = 0;
+  int high = -1;
+  int v;
+
+  for(; *line != '\0'; line++) {
+    v = hex_value((unsigned char)*line);
+    if(v < 0) {
+      continue;
+    }
+    if(high < 0) {
+      high = v;
+    } else {
+      if(n >= len) {
+        return -1;
+      }
+      buf[n++] = (high << 4) | v;
+      high = -1;
+    }
+  }
+  return high < 0 ? n : -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+decode_legacy(const uint8_t *buf, int len)
+{
+  char mode[LEGACY_MODE_LEN + 1];
+
+  if(len < LEGACY_LEN - 1) {
+    return 0;
+  }
+  memcpy(mode, &buf[8], LEGACY_MODE_LEN);
+  mode[LEGACY_MODE_LEN] = '\0';
+  printf("legacy len=%d counter=%u battery=%u data_rate=%lu mode=%s\n", len,
+         buf[0] | (buf[1] << 8), buf[2] | (buf[3] << 8),
+         (unsigned long)buf[4] | ((unsigned long)buf[5] << 8) |
+         ((unsigned long)buf[6] << 16) | ((unsigned long)buf[7] << 24),
+         mode);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+decode_control(const uint8_t *buf, int len)
+{
+  struct msg_control c;
+  uint8_t epoch;
+  uint8_t seq;
+
+  if(msg_decode_control_ack(buf, len, &epoch, &seq)) {
+    printf("v%d len=%d control ack epoch=%u seq=%u\n", MSG_VERSION, len,
+           epoch, seq);
+    return 1;
+  }
+  if(!msg_decode_control(buf, len, &c)) {
+    return 0;
+  }
+  printf("v%d len=%d control epoch=%u seq=%u", MSG_VERSION, len, c.epoch,
+         c.seq);
+  if(c.cmds & MSG_C_INTERVAL) {
+    printf(" interval=%lu", (unsigned long)c.interval);
+  }
+  if(c.cmds & MSG_C_THRESHOLDS) {
+    printf(" thresh=%d,%d,%d,%d", c.thresholds[0], c.thresholds[1],
+           c.thresholds[2], c.thresholds[3]);
+  }
+  if(c.cmds & MSG_C_PARAM) {
+    printf(" param=%d,%d,%d", c.param[0], c.param[1], c.param[2]);
+  }
+  if(c.cmds & MSG_C_FEATURE) {
+    printf(" feature=%d,%d,%d,%d", c.feature[0], c.feature[1], c.feature[2],
+           c.feature[3]);
+  }
+  if(c.cmds & MSG_C_TIME) {
+    printf(" time=%lu", (unsigned long)c.time);
+  }
+  printf("\n");
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static double
+seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+/*---------------------------------------------------------------------------*/
+static int
+bench(uint32_t n)
+{
+  struct msg_reading r[MSG_BATCH_MAX];
+  struct msg_reading *aos;
+  struct msg_cols cols;
+  uint8_t *buf;
+  uint32_t *len;
+  uint8_t *count;
+  uint8_t out_len;
+  uint64_t one = 0;
+  uint64_t sum = 0;
+  uint32_t batch;
+  uint32_t i;
+  int num;
+  int j;
+  double t0, t1, t2;
+
+  buf = calloc(n, BENCH_STRIDE);
+  len = calloc(n, sizeof(*len));
+  count = calloc(n, sizeof(*count));
+  aos = calloc((size_t)n * MSG_BATCH_MAX, sizeof(*aos));
+  if(buf == NULL || len == NULL || count == NULL || aos == NULL ||
+     msg_cols_alloc(&cols, n * MSG_BATCH_MAX) < 0) {
+    perror("bench");
+    return 1;
+  }
+
+  /* A mix of single readings, batches and delta batches, as a sink sees */
+  srand(1);
+  for(i = 0; i < n; i++) {
+    num = 1 + rand() % MSG_BATCH_MAX;
+    for(j = 0; j < num; j++) {
+      r[j].mode = rand() % MSG_MODE_NUM;
+      r[j].fields = MSG_F_BATTERY | MSG_F_DATA_RATE;
+      r[j].counter = i * MSG_BATCH_MAX + j;
+      r[j].battery = 3000 - i % 1000 + j;
+      r[j].data_rate = 1280 * (1 + rand() % 8);
+      r[j].age = 0;
+    }
+    switch(i % 3) {
+    case 0:
+      len[i] = msg_encode_reading(&buf[i * BENCH_STRIDE], BENCH_STRIDE, r);
+      break;
+    case 1:
+      msg_encode_batch(&buf[i * BENCH_STRIDE], BENCH_STRIDE, r, num, &out_len);
+      len[i] = out_len;
+      break;
+    default:
+      msg_encode_batch_delta(&buf[i * BENCH_STRIDE], BENCH_STRIDE, r, num,
+                             &out_len);
+      len[i] = out_len;
+      break;
+    }
+    if(rand() % BENCH_CORRUPT == 0) {
+      len[i] = rand() % (len[i] + 1);
+    }
+  }
+
+  /* Fault the outputs in, so both runs start warm */
+  msg_batch_decode(buf, BENCH_STRIDE, len, n, &cols, count);
+  memset(aos, 0, (size_t)n * MSG_BATCH_MAX * sizeof(*aos));
+
+  /* One at a time into an array of records, as the collector used to */
+  t0 = seconds();
+  for(i = 0; i < n; i++) {
+    num = msg_decode_reading(&buf[i * BENCH_STRIDE], len[i], &aos[one]) > 0;
+    if(num == 0) {
+      num = msg_decode_batch(&buf[i * BENCH_STRIDE], len[i], &aos[one],
+                             MSG_BATCH_MAX);
+    }
+    one += num;
+  }
+  t1 = seconds();
+  batch = msg_batch_decode(buf, BENCH_STRIDE, len, n, &cols, count);
+  t2 = seconds();
+
+  for(i = 0; i < one; i++) {
+    sum += aos[i].counter;
+  }
+  for(i = 0; i < batch; i++) {
+    sum -= cols.counter[i];
+  }
+  printf("%u payloads, %llu readings\n", n, (unsigned long long)one);
+  printf("one at a time  %6.1f ns/payload %6.1f M readings/s\n",
+         (t1 - t0) * 1e9 / n, one / (t1 - t0) / 1e6);
+  printf("batch          %6.1f ns/payload %6.1f M readings/s\n",
+         (t2 - t1) * 1e9 / n, batch / (t2 - t1) / 1e6);
+  if(batch != one || sum != 0) {
+    printf("MISMATCH: batch decoded %u readings\n", batch);
+    return 1;
+  }
+  msg_cols_free(&cols);
+  free(aos);
+  free(buf);
+  free(len);
+  free(count);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* xorshift32, rand() has only 15 bits on some hosts */
+static uint32_t fuzz_state = 1;
+static struct msg_cols fuzz_cols;
+
+static uint32_t
+fuzz_rand(void)
+{
+  fuzz_state ^= fuzz_state << 13;
+  fuzz_state ^= fuzz_state >> 17;
+  fuzz_state ^= fuzz_state << 5;
+  return fuzz_state;
+}
+/*---------------------------------------------------------------------------*/
+/* Values near the ends of the range, where the deltas wrap, or anywhere */
+static uint32_t
+fuzz_value(uint32_t max)
+{
+  switch(fuzz_rand() % 4) {
+  case 0:
+    return fuzz_rand() % 4;
+  case 1:
+    return max - fuzz_rand() % 4;
+  default:
+    return max == 0xffffffffUL ? fuzz_rand() : fuzz_rand() % (max + 1);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+fuzz_same(const struct msg_reading *a, const struct msg_reading *b)
+{
+  return a->mode == b->mode && a->fields == b->fields &&
+    a->counter == b->counter &&
+    a->battery == ((a->fields & MSG_F_BATTERY) ? b->battery : 0) &&
+    a->data_rate == ((a->fields & MSG_F_DATA_RATE) ? b->data_rate : 0) &&
+    a->age == ((a->fields & MSG_F_AGE) ? b->age : 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Decode a payload every way there is, returns the readings, -1 if the
+   decoders disagree */
+static int
+fuzz_decode(const uint8_t *buf, uint16_t len, struct msg_reading *out)
+{
+  struct msg_reading r[MSG_BATCH_MAX];
+  struct msg_cursor c;
+  uint8_t padded[FUZZ_LEN];
+  uint32_t blen = len;
+  uint32_t batch;
+  uint8_t count;
+  uint8_t claimed;
+  int num = 0;
+  int i;
+
+  if(msg_type(buf, len) == MSG_TYPE_READING) {
+    num = msg_decode_reading(buf, len, &out[0]) > 0;
+  } else {
+    num = msg_decode_batch(buf, len, out, MSG_BATCH_MAX);
+  }
+
+  /* The cursor stops at the first bad reading, the batch decoders give
+     up on the whole payload */
+  claimed = msg_cursor_init(&c, buf, len);
+  for(i = 0; msg_cursor_next(&c, &r[i % MSG_BATCH_MAX]); i++) {
+    if(i < num && !fuzz_same(&r[i], &out[i])) {
+      printf("cursor reading %d differs\n", i);
+      return -1;
+    }
+  }
+  if(i > claimed || (num > 0 && i != num)) {
+    printf("cursor decoded %d of %u, batch %d\n", i, claimed, num);
+    return -1;
+  }
+
+  /* msg_batch_decode() reads the header bytes whatever the length */
+  memset(padded, 0, sizeof(padded));
+  memcpy(padded, buf, len);
+  batch = msg_batch_decode(padded, sizeof(padded), &blen, 1, &fuzz_cols,
+                           &count);
+  if(batch != (uint32_t)num || count != num) {
+    printf("msg_batch_decode %u readings, msg_decode_batch %d\n", batch, num);
+    return -1;
+  }
+  return num;
+}
+/*---------------------------------------------------------------------------*/
+static int
+fuzz_round_trip(void)
+{
+  uint8_t buf[FUZZ_LEN];
+  uint8_t mut[FUZZ_LEN];
+  struct msg_reading r[MSG_BATCH_MAX];
+  struct msg_reading out[MSG_BATCH_MAX];
+  struct msg_control c, cd;
+  uint32_t bitmap, frame, delay;
+  uint16_t cumulative;
+  uint8_t fields = fuzz_rand() % 16;
+  uint8_t num = 1 + fuzz_rand() % MSG_BATCH_MAX;
+  uint8_t len;
+  uint8_t cut;
+  uint8_t epoch;
+  uint8_t seq;
+  int got;
+  int i;
+
+  memset(r, 0, sizeof(r));
+  r[0].counter = fuzz_value(0xffff);
+  for(i = 0; i < num; i++) {
+    r[i].mode = fuzz_rand() % MSG_MODE_NUM;
+    r[i].fields = fields;
+    r[i].counter = r[0].counter +
+      (fuzz_rand() % 8 == 0 ? fuzz_value(0xffff) : (uint32_t)i);
+    if(fields & MSG_F_BATTERY) {
+      r[i].battery = fuzz_value(0xffff);
+    }
+    if(fields & MSG_F_DATA_RATE) {
+      r[i].data_rate = fuzz_value(0xffffffffUL);
+    }
+    if(fields & MSG_F_AGE) {
+      r[i].age = fuzz_value(0xffffffffUL);
+    }
+  }
+
+  switch(fuzz_rand() % 3) {
+  case 0:
+    len = msg_encode_reading(buf, sizeof(buf), r);
+    num = len > 0;
+    break;
+  case 1:
+    num = msg_encode_batch(buf, sizeof(buf), r, num, &len);
+    break;
+  default:
+    num = msg_encode_batch_delta(buf, sizeof(buf), r, num, &len);
+    break;
+  }
+  if(num == 0) {
+    printf("nothing encoded\n");
+    return -1;
+  }
+  got = fuzz_decode(buf, len, out);
+  if(got != num) {
+    printf("encoded %u readings, decoded %d\n", num, got);
+    return -1;
+  }
+  for(i = 0; i < num; i++) {
+    if(!fuzz_same(&r[i], &out[i])) {
+      printf("reading %d of %u decoded wrong\n", i, num);
+      return -1;
+    }
+  }
+
+  memset(&c, 0, sizeof(c));
+  c.epoch = fuzz_rand();
+  c.seq = fuzz_rand();
+  c.cmds = fuzz_rand() & 0x1f;
+  c.interval = (c.cmds & MSG_C_INTERVAL) ? fuzz_value(0xffffffffUL) : 0;
+  for(i = 0; i < MSG_C_THRESH_LEN; i++) {
+    c.thresholds[i] = (c.cmds & MSG_C_THRESHOLDS) ? (int16_t)fuzz_rand() : 0;
+  }
+  for(i = 0; i < MSG_C_PARAM_LEN; i++) {
+    c.param[i] = (c.cmds & MSG_C_PARAM) ? (int16_t)fuzz_rand() : 0;
+  }
+  for(i = 0; i < MSG_C_FEATURE_LEN; i++) {
+    c.feature[i] = (c.cmds & MSG_C_FEATURE) ? (int16_t)fuzz_rand() : 0;
+  }
+  c.time = (c.cmds & MSG_C_TIME) ? fuzz_value(0xffffffffUL) : 0;
+  len = msg_encode_control(buf, sizeof(buf), &c);
+  memset(&cd, 0, sizeof(cd));
+  if(len == 0 || len > MSG_CONTROL_MAX_LEN ||
+     msg_decode_control(buf, len, &cd) != len ||
+     memcmp(&c, &cd, sizeof(c)) != 0) {
+    printf("control 0x%02x decoded wrong\n", c.cmds);
+    return -1;
+  }
+  len = msg_encode_control_ack(buf, sizeof(buf), c.epoch, c.seq);
+  if(len != MSG_CONTROL_ACK_LEN ||
+     msg_decode_control_ack(buf, len, &epoch, &seq) != len ||
+     epoch != c.epoch || seq != c.seq) {
+    printf("control ack decoded wrong\n");
+    return -1;
+  }
+
+  len = msg_encode_ack(buf, sizeof(buf), r[0].counter,
+                       fuzz_value(0xffffffffUL));
+  if(len == 0 || len > MSG_ACK_MAX_LEN ||
+     msg_decode_ack(buf, len, &cumulative, &bitmap) != len ||
+     cumulative != r[0].counter) {
+    printf("ack decoded wrong\n");
+    return -1;
+  }
+  /* A slot starts within the frame */
+  frame = 1 + fuzz_value(0xfffffffeUL);
+  seq = fuzz_rand() % 2;
+  len = msg_encode_slot(buf, sizeof(buf), frame, seq ? frame - 1 : 0);
+  if(len == 0 || len > MSG_SLOT_MAX_LEN ||
+     msg_decode_slot(buf, len, &frame, &delay) != len ||
+     delay != (seq ? frame - 1 : 0)) {
+    printf("slot decoded wrong\n");
+    return -1;
+  }
+
+  /* A delta batch cut short or with a bit flipped */
+  msg_encode_batch_delta(buf, sizeof(buf), r, num, &len);
+  for(i = 0; i < 8; i++) {
+    memcpy(mut, buf, len);
+    cut = fuzz_rand() % (len + 1);
+    if(cut > 0 && fuzz_rand() % 2) {
+      mut[fuzz_rand() % cut] ^= 1 << (fuzz_rand() % 8);
+    }
+    if(fuzz_decode(mut, cut, out) < 0) {
+      return -1;
+    }
+  }
+
+  /* And random bytes, often with a valid header */
+  len = fuzz_rand() % FUZZ_RANDOM_LEN;
+  for(i = 0; i < len; i++) {
+    buf[i] = fuzz_rand();
+  }
+  if(len > 0 && fuzz_rand() % 2) {
+    buf[0] = (MSG_VERSION << 4) | (fuzz_rand() % 7);
+  }
+  if(fuzz_decode(buf, len, out) < 0) {
+    return -1;
+  }
+  msg_decode_control(buf, len, &cd);
+  msg_decode_control_ack(buf, len, &epoch, &seq);
+  msg_decode_ack(buf, len, &cumulative, &bitmap);
+  msg_decode_slot(buf, len, &frame, &delay);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+fuzz(uint32_t rounds)
+{
+  uint32_t i;
+
+  if(msg_cols_alloc(&fuzz_cols, MSG_BATCH_MAX) < 0) {
+    perror("fuzz");
+    return 1;
+  }
+  for(i = 0; i < rounds; i++) {
+    if(fuzz_round_trip() < 0) {
+      printf("FAIL in round %u\n", i);
+      return 1;
+    }
+  }
+  msg_cols_free(&fuzz_cols);
+  printf("OK %u rounds\n", rounds);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  char line[LINE_LEN];
+  uint8_t buf[PAYLOAD_LEN];
+  struct msg_reading r[MSG_BATCH_MAX];
+  int len;
+  int num;
+  int i;
+
+  if(argc == 3 && strcmp(argv[1], "-b") == 0) {
+    return bench(strtoul(argv[2], NULL, 10));
+  }
+  if(argc == 3 && strcmp(argv[1], "-f") == 0) {
+    return fuzz(strtoul(argv[2], NULL, 10));
+  }
+
+  while(fgets(line, sizeof(line), stdin) != NULL) {
+    len = parse_hex(line, buf, sizeof(buf));
+    if(len <= 0) {
+      continue;
+    }
+    switch(msg_type(buf, len)) {
+    case MSG_TYPE_READING:
+      num = msg_decode_reading(buf, len, &r[0]) > 0;
+      break;
+    case MSG_TYPE_BATCH:
+    case MSG_TYPE_BATCH_DELTA:
+      num = msg_decode_batch(buf, len, r, MSG_BATCH_MAX);
+      break;
+    default:
+      num = 0;
+      break;
+    }
+    for(i = 0; i < num; i++) {
+      printf("v%d len=%d counter=%u battery=%u data_rate=%lu ",
+             MSG_VERSION, len, r[i].counter, r[i].battery,
+             (unsigned long)r[i].data_rate);
+      if(r[i].fields & MSG_F_BACKLOG) {
+        printf("age=backlog");
+      } else {
+        printf("age=%lu", (unsigned long)r[i].age);
+      }
+      printf(" mode=%s\n", msg_mode_name(r[i].mode));
+    }
+    if(num == 0 && !decode_control(buf, len) && !decode_legacy(buf, len)) {
+      printf("malformed len=%d\n", len);
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
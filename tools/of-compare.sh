@@ -0,0 +1,33 @@
+#!/bin/sh
+# Network lifetime and delivery with MRHOF against the energy OF
+# (rpl-energy-of.h), in Cooja.
+#
+#   tools/of-compare.sh [battery_mv]     default 3500
+#
+# Builds both firmwares with and without WITH_ENERGY_OF, the clients on a
+# virtual battery, and plays cooja_energy_of_lifetime.csc in Cooja without
+# the GUI. CONTIKI defaults to where the Makefiles look for it. Prints the
+# LIFETIME and PDR lines of each run, see the script in the .csc.
+
+set -e
+cd "$(dirname "$0")/.."
+TOP=$(pwd)
+CONTIKI=${CONTIKI:-$TOP/../../../..}
+COOJA=${COOJA:-$CONTIKI/tools/cooja/dist/cooja.jar}
+MV=${1:-3500}
+CSC=/tmp/of-compare.$$.csc
+
+for of in 0 1; do
+  (cd udp-server-test && make -s TARGET=z1 clean &&
+   make -s TARGET=z1 WITH_ENERGY_OF=$of DEFINES=COOJA_SIM=1 \
+     udp-server-test.z1)
+  (cd udp-client-test && make -s TARGET=z1 clean &&
+   make -s TARGET=z1 WITH_ENERGY_OF=$of \
+     DEFINES=COOJA_SIM=1,BATTERY_EST_CONF_SIM_MV=$MV udp-client-test.z1)
+  sed -e "s|\[CONFIG_DIR\]|$TOP|" cooja_energy_of_lifetime.csc > $CSC
+  (cd /tmp && java -mx512m -jar "$COOJA" -nogui=$CSC -contiki="$CONTIKI" \
+     > /dev/null)
+  echo "energy OF $of"
+  grep "LIFETIME\|PDR" /tmp/COOJA.testlog
+done
+rm -f $CSC
@@ -0,0 +1,38 @@
+#!/bin/sh
+# Static RAM against the budget of the linked firmware.
+#
+#   tools/ram-gate.sh contiki-z1.map [stack]
+#
+# Takes the size of the ram region and of .data and .bss from the map the
+# linker wrote, and fails when .data+.bss leave less than stack bytes
+# (default 1024) for the stack. The Makefiles run it after every z1 link,
+# RAM_STACK=n sets the reserve there. Prints one line:
+#
+#   RAM <data> + <bss> = <used> of <budget> (<ram> - <stack> stack), <left> left
+
+MAP=${1:?usage: ram-gate.sh contiki-z1.map [stack]}
+STACK=${2:-1024}
+
+# Output sections and memory regions start in the first column
+set -- $(awk '/^ram / { ram = $3 }
+              /^\.data / { data = $3 }
+              /^\.bss / { bss = $3 }
+              END { print ram, data, bss }' "$MAP")
+if [ $# -ne 3 ]; then
+  echo "$MAP: no ram region, .data or .bss" >&2
+  exit 1
+fi
+
+ram=$(($1))
+data=$(($2))
+bss=$(($3))
+used=$((data + bss))
+budget=$((ram - STACK))
+
+echo "RAM $data + $bss = $used of $budget ($ram - $STACK stack)," \
+     "$((budget - used)) left"
+if [ $used -gt $budget ]; then
+  echo "$MAP: .data+.bss over the RAM budget by $((used - budget)) bytes," \
+       "see RAM_PROFILE in project-conf.h" >&2
+  exit 1
+fi
@@ -0,0 +1,92 @@
+#!/bin/sh
+# RPL storing against non-storing mode across network sizes and depths,
+# in Cooja.
+#
+#   NODES="10 25 50 100" DEPTHS="2 4 6" tools/rpl-bench.sh
+#
+# For each mode and node count builds both firmwares with WITH_RPL_BENCH=1
+# and MAX_ROUTES set to the node count, takes the sink's static RAM (data
+# and bss) from msp430-size, then for each depth places the clients on
+# rays out from the sink, one hop of 40 m apart with a 50 m radio range,
+# and plays cooja_rpl_bench.csc without the GUI. A build that does not fit
+# the Z1's RAM, as tools/ram-gate.sh checks it, is reported as such.
+# Prints one line per run:
+#
+#   mode nodes depth sink_ram <RESULT fields, see the .csc>
+#
+# CONTIKI defaults to where the Makefiles look for it. MODES="0" or "1"
+# runs only storing or non-storing mode, MAKEARGS is passed to both builds
+# and CLIENT_DEFINES is added to the clients' DEFINES, see rpl-timing.sh.
+#
+# Not run yet: the matrix needs the Contiki tree, msp430-gcc and Cooja,
+# and there are no results from it to compare against.
+
+cd "$(dirname "$0")/.."
+TOP=$(pwd)
+CONTIKI=${CONTIKI:-$TOP/../../../..}
+COOJA=${COOJA:-$CONTIKI/tools/cooja/dist/cooja.jar}
+NODES=${NODES:-10 25 50 100}
+DEPTHS=${DEPTHS:-2 4 6}
+MODES=${MODES:-0 1}
+CSC=/tmp/rpl-bench.$$.csc
+
+# Clients on ceil(n / depth) rays, hop h of a ray at 40 * h m
+clients()
+{
+  awk -v n=$1 -v d=$2 'BEGIN {
+    rays = int((n + d - 1) / d)
+    for(i = 0; i < n; i++) {
+      a = 6.283185 * (i % rays) / rays
+      r = 40 * (int(i / rays) + 1)
+      printf "    <mote>\n      <breakpoints />\n"
+      printf "      <interface_config>\n"
+      printf "        org.contikios.cooja.interfaces.Position\n"
+      printf "        <x>%.1f</x>\n        <y>%.1f</y>\n", r * cos(a), r * sin(a)
+      printf "        <z>0.0</z>\n      </interface_config>\n"
+      printf "      <interface_config>\n"
+      printf "        org.contikios.cooja.mspmote.interfaces.MspClock\n"
+      printf "        <deviation>1.0</deviation>\n      </interface_config>\n"
+      printf "      <interface_config>\n"
+      printf "        org.contikios.cooja.mspmote.interfaces.MspMoteID\n"
+      printf "        <id>%d</id>\n      </interface_config>\n", i + 2
+      printf "      <motetype_identifier>z12</motetype_identifier>\n"
+      printf "    </mote>\n"
+    }
+  }'
+}
+
+echo "mode nodes depth sink_ram clients joined icmp/h listen listen_max" \
+     "transmit routes links switches pdr rpl/h rpl_B/h"
+for ns in $MODES; do
+  mode=$([ $ns = 1 ] && echo non-storing || echo storing)
+  for n in $NODES; do
+    if ! (cd udp-server-test && make -s TARGET=z1 clean &&
+          make -s TARGET=z1 WITH_RPL_BENCH=1 MAKE_WITH_NON_STORING=$ns \
+            MAX_ROUTES=$n DEFINES=COOJA_SIM=1 $MAKEARGS udp-server-test &&
+          cd ../udp-client-test && make -s TARGET=z1 clean &&
+          make -s TARGET=z1 WITH_RPL_BENCH=1 MAKE_WITH_NON_STORING=$ns \
+            MAX_ROUTES=$n DEFINES=COOJA_SIM=1$CLIENT_DEFINES $MAKEARGS \
+            udp-client-test) \
+          > /dev/null 2>&1; then
+      echo "$mode $n - does not build, MAX_ROUTES=$n does not fit"
+      continue
+    fi
+    ram=$(msp430-size udp-server-test/udp-server-test.z1 |
+          awk 'NR == 2 { print $2 + $3 }')
+    for d in $DEPTHS; do
+      sed -e "s|\[CONFIG_DIR\]|$TOP|" cooja_rpl_bench.csc |
+        while IFS= read -r line; do
+          if [ "$line" = "    <!-- clients -->" ]; then
+            clients $n $d
+          else
+            printf '%s\n' "$line"
+          fi
+        done > $CSC
+      (cd /tmp && java -mx1024m -jar "$COOJA" -nogui=$CSC \
+         -contiki="$CONTIKI" > /dev/null)
+      echo "$mode $n $d $ram" \
+           "$(grep RESULT /tmp/COOJA.testlog | cut -d' ' -f2-)"
+    done
+  done
+done
+rm -f $CSC
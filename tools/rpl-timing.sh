@@ -0,0 +1,42 @@
+#!/bin/sh
+# RPL control traffic with and without the per energy mode timing of
+# udp-client-test/rpl-profile.h, in Cooja.
+#
+#   NODES=25 DEPTHS=4 tools/rpl-timing.sh [battery_mv...]
+#
+# For each battery level, default 3300 (Normal_op) and 2850 (Lo_Bat), runs
+# tools/rpl-bench.sh in storing mode with the clients on an undrained
+# virtual battery at that level, once with WITH_RPL_PROFILE=0 and once
+# with 1. Prints the rpl-bench.sh line of each run after the battery level
+# and the profile setting, then one line per level:
+#
+#   saved <mv> <rpl bytes per client and hour, % less with the profiles>
+#
+# The joined, switches and pdr columns show whether the routes held.
+
+cd "$(dirname "$0")"
+export NODES=${NODES:-25}
+export DEPTHS=${DEPTHS:-4}
+export MODES=0
+LEVELS=${*:-3300 2850}
+OUT=/tmp/rpl-timing.$$
+
+echo "mv profile mode nodes depth sink_ram clients joined icmp/h listen" \
+     "listen_max transmit routes links switches pdr rpl/h rpl_B/h"
+for mv in $LEVELS; do
+  for p in 0 1; do
+    MAKEARGS="WITH_RPL_PROFILE=$p" \
+    CLIENT_DEFINES=",BATTERY_EST_CONF_SIM_MV=$mv,BATTERY_EST_CONF_SIM_DRAIN=0" \
+      ./rpl-bench.sh | tail -n +2 | sed -e "s/^/$mv $p /"
+  done
+done | tee $OUT
+
+awk '$5 != "-" { bytes[$1 " " $2] += $NF; mv[$1] = 1 }
+     END {
+       for(m in mv) {
+         off = bytes[m " 0"]
+         printf "saved %s %.1f%%\n", m,
+                (off > 0 ? 100.0 * (off - bytes[m " 1"]) / off : 0)
+       }
+     }' $OUT
+rm -f $OUT
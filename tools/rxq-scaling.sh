@@ -0,0 +1,34 @@
+#!/bin/sh
+# Sink-side loss against the number of clients sending at once, without
+# and with the sink's receive queue (udp-server-test/rx-queue.h).
+#
+#   tools/rxq-scaling.sh [senders...]     default 1 2 4 8 12 16
+#
+# Builds both firmwares for every run and plays cooja_rx_queue_scaling.csc
+# in Cooja without the GUI. CONTIKI defaults to where the Makefiles look
+# for it. Prints one SCALE line per run, see the script in the .csc.
+
+set -e
+cd "$(dirname "$0")/.."
+TOP=$(pwd)
+CONTIKI=${CONTIKI:-$TOP/../../../..}
+COOJA=${COOJA:-$CONTIKI/tools/cooja/dist/cooja.jar}
+SENDERS=${*:-1 2 4 8 12 16}
+CSC=/tmp/rxq-scaling.$$.csc
+
+(cd udp-client-test && make -s TARGET=z1 WITH_RETX=0 udp-client-test.z1)
+
+for q in 0 1; do
+  (cd udp-server-test && make -s TARGET=z1 clean &&
+   make -s TARGET=z1 WITH_RX_QUEUE=$q DEFINES=NODE_SLOT_CONF_NUM=1 \
+     udp-server-test.z1)
+  for n in $SENDERS; do
+    sed -e "s/var SENDERS = [0-9]*;/var SENDERS = $n;/" \
+        -e "s|\[CONFIG_DIR\]|$TOP|" cooja_rx_queue_scaling.csc > $CSC
+    (cd /tmp && java -mx512m -jar "$COOJA" -nogui=$CSC -contiki="$CONTIKI" \
+       > /dev/null)
+    printf "queue %s " $q
+    grep "SCALE" /tmp/COOJA.testlog
+  done
+done
+rm -f $CSC
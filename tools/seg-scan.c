@@ -0,0 +1,242 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Scan of the collector's segment files.
+ *
+ *         Maps each segment, skips it when its min/max index rules out the
+ *         node or time range asked for, and otherwise walks the columns in
+ *         place. Prints one line per node: readings, time span, battery at
+ *         the first and last reading and its minimum, mean data rate and
+ *         the share of readings taken in each energy mode.
+ *
+ *         Usage: seg-scan [-n node] [-f from] [-t to] segment...
+ *
+ *         node is the interface identifier in hex, from and to are
+ *         seconds since the epoch.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "segment.h"
+
+struct node_sum {
+  uint64_t node;
+  uint64_t readings;
+  uint64_t first;
+  uint64_t last;
+  uint64_t rate_sum;
+  uint16_t first_battery;
+  uint16_t last_battery;
+  uint16_t min_battery;
+  uint8_t used;
+  uint64_t modes[MSG_MODE_NUM];
+};
+
+static struct node_sum *table;
+static size_t table_size;
+static size_t table_used;
+/*---------------------------------------------------------------------------*/
+static struct node_sum *
+lookup(uint64_t node)
+{
+  struct node_sum *old;
+  size_t old_size;
+  size_t i;
+
+  if(table_used * 2 >= table_size) {
+    old = table;
+    old_size = table_size;
+    table_size = table_size ? table_size * 2 : 1024;
+    table = calloc(table_size, sizeof(*table));
+    if(table == NULL) {
+      perror("calloc");
+      exit(1);
+    }
+    table_used = 0;
+    for(i = 0; i < old_size; i++) {
+      if(old[i].used) {
+        *lookup(old[i].node) = old[i];
+      }
+    }
+    free(old);
+  }
+
+  i = (node * 0x9e3779b97f4a7c15ULL) >> 32;
+  for(i &= table_size - 1; table[i].used; i = (i + 1) & (table_size - 1)) {
+    if(table[i].node == node) {
+      return &table[i];
+    }
+  }
+  table[i].used = 1;
+  table[i].node = node;
+  table_used++;
+  return &table[i];
+}
+/*---------------------------------------------------------------------------*/
+static void
+scan(const struct segment *s, int by_node, uint64_t want, uint64_t from,
+     uint64_t to)
+{
+  const uint64_t *node = seg_col(s, SEG_COL_NODE);
+  const uint64_t *time = seg_col(s, SEG_COL_TIME);
+  const uint16_t *battery = seg_col(s, SEG_COL_BATTERY);
+  const uint32_t *rate = seg_col(s, SEG_COL_DATA_RATE);
+  const uint8_t *mode = seg_col(s, SEG_COL_MODE);
+  uint32_t rows = __atomic_load_n(&s->hdr->rows, __ATOMIC_ACQUIRE);
+  struct node_sum *n = NULL;
+  uint32_t i;
+
+  for(i = 0; i < rows; i++) {
+    if((by_node && node[i] != want) || time[i] < from || time[i] > to) {
+      continue;
+    }
+    /* Readings of a node tend to come in runs, try the last one first */
+    if(n == NULL || n->node != node[i]) {
+      n = lookup(node[i]);
+    }
+    if(n->readings == 0 || time[i] < n->first) {
+      n->first = time[i];
+      n->first_battery = battery[i];
+    }
+    if(n->readings == 0 || time[i] >= n->last) {
+      n->last = time[i];
+      n->last_battery = battery[i];
+    }
+    if(n->readings == 0 || battery[i] < n->min_battery) {
+      n->min_battery = battery[i];
+    }
+    n->readings++;
+    n->rate_sum += rate[i];
+    if(mode[i] < MSG_MODE_NUM) {
+      n->modes[mode[i]]++;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-n node] [-f from] [-t to] segment...\n",
+          name);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char *argv[])
+{
+  struct segment s;
+  struct timespec t0, t1;
+  const struct seg_minmax *range;
+  uint64_t want = 0;
+  uint64_t from = 0;
+  uint64_t to = UINT64_MAX;
+  uint64_t bytes = 0;
+  unsigned scanned = 0;
+  unsigned skipped = 0;
+  int by_node = 0;
+  double secs;
+  size_t i;
+  int m;
+  int c;
+
+  while((c = getopt(argc, argv, "n:f:t:")) != -1) {
+    switch(c) {
+    case 'n':
+      want = strtoull(optarg, NULL, 16);
+      by_node = 1;
+      break;
+    case 'f':
+      from = strtoull(optarg, NULL, 10) * 1000000ULL;
+      break;
+    case 't':
+      to = strtoull(optarg, NULL, 10) * 1000000ULL + 999999;
+      break;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if(optind >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  for(; optind < argc; optind++) {
+    if(seg_open(&s, argv[optind]) < 0) {
+      perror(argv[optind]);
+      continue;
+    }
+    range = s.hdr->range;
+    if(s.hdr->rows == 0 ||
+       (by_node && (want < range[SEG_COL_NODE].min ||
+                    want > range[SEG_COL_NODE].max)) ||
+       to < range[SEG_COL_TIME].min || from > range[SEG_COL_TIME].max) {
+      skipped++;
+    } else {
+      scan(&s, by_node, want, from, to);
+      scanned++;
+      /* The columns read, the counter is not */
+      bytes += (uint64_t)s.hdr->rows * (8 + 8 + 2 + 4 + 1);
+    }
+    seg_close(&s);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+  printf("%-16s %10s %10s %10s %6s %6s %6s %10s", "node", "readings",
+         "first", "last", "bat0", "bat1", "batmin", "rate");
+  for(m = 0; m < MSG_MODE_NUM; m++) {
+    printf(" %9s", msg_mode_name(m));
+  }
+  printf("\n");
+  for(i = 0; i < table_size; i++) {
+    if(!table[i].used || table[i].readings == 0) {
+      continue;
+    }
+    printf("%016" PRIx64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+           " %6u %6u %6u %10.1f", table[i].node, table[i].readings,
+           table[i].first / 1000000, table[i].last / 1000000,
+           table[i].first_battery, table[i].last_battery,
+           table[i].min_battery,
+           (double)table[i].rate_sum / table[i].readings);
+    for(m = 0; m < MSG_MODE_NUM; m++) {
+      printf(" %8.1f%%", 100.0 * table[i].modes[m] / table[i].readings);
+    }
+    printf("\n");
+  }
+  fprintf(stderr, "%u segment(s) scanned, %u skipped, %.1f MB in %.3f s"
+          " (%.0f MB/s)\n", scanned, skipped, bytes / 1e6, secs,
+          secs > 0 ? bytes / 1e6 / secs : 0.0);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,180 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "segment.h"
+
+static const uint8_t width[SEG_COLS] = { 8, 8, 2, 2, 4, 1 };
+/*---------------------------------------------------------------------------*/
+static void
+minmax(struct seg_minmax *m, uint64_t v, uint32_t rows)
+{
+  if(rows == 0 || v < m->min) {
+    m->min = v;
+  }
+  if(rows == 0 || v > m->max) {
+    m->max = v;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+seg_create(struct segment *s, const char *path, uint32_t capacity)
+{
+  uint64_t off = SEG_HEADER_LEN;
+  int i;
+
+  s->fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if(s->fd < 0) {
+    return -1;
+  }
+
+  /* Columns back to back, each aligned for its type */
+  s->size = SEG_HEADER_LEN;
+  for(i = 0; i < SEG_COLS; i++) {
+    s->size += (uint64_t)capacity * width[i];
+  }
+  if(ftruncate(s->fd, s->size) < 0) {
+    close(s->fd);
+    return -1;
+  }
+  s->base = mmap(NULL, s->size, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+  if(s->base == MAP_FAILED) {
+    close(s->fd);
+    return -1;
+  }
+  s->writable = 1;
+  s->hdr = (struct seg_header *)s->base;
+
+  memset(s->hdr, 0, sizeof(*s->hdr));
+  memcpy(s->hdr->magic, SEG_MAGIC, 4);
+  s->hdr->version = SEG_VERSION;
+  s->hdr->capacity = capacity;
+  for(i = 0; i < SEG_COLS; i++) {
+    s->hdr->offset[i] = off;
+    off += (uint64_t)capacity * width[i];
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+seg_open(struct segment *s, const char *path)
+{
+  struct stat st;
+
+  s->fd = open(path, O_RDONLY);
+  if(s->fd < 0) {
+    return -1;
+  }
+  if(fstat(s->fd, &st) < 0 || st.st_size < SEG_HEADER_LEN) {
+    close(s->fd);
+    return -1;
+  }
+  s->size = st.st_size;
+  s->base = mmap(NULL, s->size, PROT_READ, MAP_SHARED, s->fd, 0);
+  if(s->base == MAP_FAILED) {
+    close(s->fd);
+    return -1;
+  }
+  s->writable = 0;
+  s->hdr = (struct seg_header *)s->base;
+
+  if(memcmp(s->hdr->magic, SEG_MAGIC, 4) != 0 ||
+     s->hdr->version != SEG_VERSION ||
+     s->hdr->offset[SEG_COL_MODE] + s->hdr->capacity > s->size ||
+     s->hdr->rows > s->hdr->capacity) {
+    seg_close(s);
+    errno = EINVAL;
+    return -1;
+  }
+  madvise(s->base, s->size, MADV_SEQUENTIAL);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+seg_append(struct segment *s, const struct collector_rec *rec, uint32_t num)
+{
+  struct seg_header *h = s->hdr;
+  uint64_t *node = (uint64_t *)(s->base + h->offset[SEG_COL_NODE]);
+  uint64_t *time = (uint64_t *)(s->base + h->offset[SEG_COL_TIME]);
+  uint16_t *counter = (uint16_t *)(s->base + h->offset[SEG_COL_COUNTER]);
+  uint16_t *battery = (uint16_t *)(s->base + h->offset[SEG_COL_BATTERY]);
+  uint32_t *rate = (uint32_t *)(s->base + h->offset[SEG_COL_DATA_RATE]);
+  uint8_t *mode = s->base + h->offset[SEG_COL_MODE];
+  uint32_t row = h->rows;
+  uint64_t iid;
+  uint32_t i;
+  int j;
+
+  if(num > h->capacity - row) {
+    num = h->capacity - row;
+  }
+  for(i = 0; i < num; i++, row++) {
+    iid = 0;
+    for(j = 8; j < 16; j++) {
+      iid = (iid << 8) | rec[i].node[j];
+    }
+    node[row] = iid;
+    time[row] = rec[i].rx_ns / 1000 - (uint64_t)rec[i].r.age * 1000000;
+    counter[row] = rec[i].r.counter;
+    battery[row] = rec[i].r.battery;
+    rate[row] = rec[i].r.data_rate;
+    mode[row] = rec[i].r.mode;
+
+    minmax(&h->range[SEG_COL_NODE], node[row], row);
+    minmax(&h->range[SEG_COL_TIME], time[row], row);
+    minmax(&h->range[SEG_COL_COUNTER], counter[row], row);
+    minmax(&h->range[SEG_COL_BATTERY], battery[row], row);
+    minmax(&h->range[SEG_COL_DATA_RATE], rate[row], row);
+    minmax(&h->range[SEG_COL_MODE], mode[row], row);
+  }
+
+  /* Publish the rows only once they and the ranges are in place */
+  __atomic_store_n(&h->rows, row, __ATOMIC_RELEASE);
+  return num;
+}
+/*---------------------------------------------------------------------------*/
+void
+seg_seal(struct segment *s)
+{
+  s->hdr->sealed = 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+seg_close(struct segment *s)
+{
+  if(s->writable) {
+    msync(s->base, s->size, MS_ASYNC);
+  }
+  munmap(s->base, s->size);
+  close(s->fd);
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,139 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Memory-mapped columnar segments of collected readings.
+ *
+ *         A segment is one file holding up to capacity readings, one
+ *         column per field, each column a packed array in host byte order:
+ *
+ *           node       uint64  interface identifier, big endian value
+ *           time       uint64  when the reading was taken, us since epoch
+ *           counter    uint16
+ *           battery    uint16  mV
+ *           data_rate  uint32  clock ticks
+ *           mode       uint8   MSG_MODE_*
+ *
+ *         The file starts with a SEG_HEADER_LEN byte header holding the
+ *         row count, the column offsets and the min/max of every column.
+ *         A scan skips a segment whose min/max rule it out and otherwise
+ *         walks the columns it needs straight from the mapping.
+ *
+ *         The writer keeps the file mapped and bumps rows after every
+ *         batch, so readers can map a segment that is still being
+ *         written and see a consistent prefix. A full segment is sealed.
+ */
+
+#ifndef SEGMENT_H_
+#define SEGMENT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "collector.h"
+
+/*---------------------------------------------------------------------------*/
+#define SEG_MAGIC                 "RSEG"
+#define SEG_VERSION               1
+#define SEG_HEADER_LEN            4096
+
+/* Readings per segment unless told otherwise */
+#define SEG_CAPACITY              (1UL << 20)
+
+enum seg_col {
+  SEG_COL_NODE = 0,
+  SEG_COL_TIME,
+  SEG_COL_COUNTER,
+  SEG_COL_BATTERY,
+  SEG_COL_DATA_RATE,
+  SEG_COL_MODE,
+  SEG_COLS
+};
+
+struct seg_minmax {
+  uint64_t min;
+  uint64_t max;
+};
+
+struct seg_header {
+  char magic[4];
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t rows;             /* Rows written, grows while not sealed */
+  uint32_t sealed;
+  uint32_t reserved;
+  uint64_t offset[SEG_COLS]; /* Of each column from the start of the file */
+  struct seg_minmax range[SEG_COLS];
+};
+
+struct segment {
+  int fd;
+  int writable;
+  size_t size;
+  uint8_t *base;
+  struct seg_header *hdr;
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Create a segment file for writing
+ * \return     0, or -1 with errno set
+ */
+int seg_create(struct segment *s, const char *path, uint32_t capacity);
+
+/**
+ * \brief      Map an existing segment read-only
+ * \return     0, or -1 if it cannot be opened or is not a segment
+ */
+int seg_open(struct segment *s, const char *path);
+
+/**
+ * \brief      Append readings
+ * \return     Number of readings appended, fewer than num when it is full
+ */
+uint32_t seg_append(struct segment *s, const struct collector_rec *rec,
+                    uint32_t num);
+
+/**
+ * \brief      Mark a segment complete, no more rows will be added
+ */
+void seg_seal(struct segment *s);
+
+/**
+ * \brief      Unmap and close, syncing a writable segment
+ */
+void seg_close(struct segment *s);
+
+/**
+ * \brief      Start of a column
+ */
+static inline const void *
+seg_col(const struct segment *s, enum seg_col col)
+{
+  return s->base + s->hdr->offset[col];
+}
+/*---------------------------------------------------------------------------*/
+#endif /* SEGMENT_H_ */
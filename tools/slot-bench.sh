@@ -0,0 +1,45 @@
+#!/bin/sh
+# Client radio-on time and CSMA retransmissions against the number of
+# clients, without and with the sink's slot replies
+# (udp-server-test/node-slot.h).
+#
+#   tools/slot-bench.sh [clients...]     default 5 10 20
+#
+# Builds both firmwares with WITH_RPL_BENCH=1 and the clients on an
+# undrained virtual battery in Normal_op, so the energy modes stay the same
+# across runs. The sink is built with WITH_SLOT=0 and then with the slots.
+# Plays cooja_slot_scaling.csc in Cooja without the GUI. CONTIKI defaults
+# to where the Makefiles look for it. Prints one SLOT line per run, see the
+# script in the .csc.
+#
+# Not run yet: it needs the Contiki tree, msp430-gcc and Cooja, and there
+# are no results from it to compare against.
+
+set -e
+cd "$(dirname "$0")/.."
+TOP=$(pwd)
+CONTIKI=${CONTIKI:-$TOP/../../../..}
+COOJA=${COOJA:-$CONTIKI/tools/cooja/dist/cooja.jar}
+CLIENTS=${*:-5 10 20}
+CSC=/tmp/slot-bench.$$.csc
+BATTERY=BATTERY_EST_CONF_SIM_MV=3300,BATTERY_EST_CONF_SIM_DRAIN=0
+
+(cd udp-client-test && make -s TARGET=z1 clean &&
+ make -s TARGET=z1 WITH_RPL_BENCH=1 \
+   DEFINES=COOJA_SIM=1,$BATTERY udp-client-test.z1)
+
+echo "slots SLOT clients radio_on radio_on_max frames transmissions retx% pdr"
+for s in 0 1; do
+  (cd udp-server-test && make -s TARGET=z1 clean &&
+   make -s TARGET=z1 WITH_RPL_BENCH=1 WITH_SLOT=$s DEFINES=COOJA_SIM=1 \
+     udp-server-test.z1)
+  for n in $CLIENTS; do
+    sed -e "s/var CLIENTS = [0-9]*;/var CLIENTS = $n;/" \
+        -e "s|\[CONFIG_DIR\]|$TOP|" cooja_slot_scaling.csc > $CSC
+    (cd /tmp && java -mx512m -jar "$COOJA" -nogui=$CSC -contiki="$CONTIKI" \
+       > /dev/null)
+    printf "%s " $s
+    grep "SLOT" /tmp/COOJA.testlog
+  done
+done
+rm -f $CSC
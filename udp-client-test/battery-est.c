@@ -0,0 +1,191 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "sys/ctimer.h"
+#include "dev/battery-sensor.h"
+#include "battery-est.h"
+#ifdef BATTERY_EST_CONF_SIM_MV
+#include "sys/energest.h"
+#endif
+
+/* Ring of the last samples, in arrival order, and the same samples sorted */
+static int16_t window[BATTERY_EST_WINDOW];
+static int16_t sorted[BATTERY_EST_WINDOW];
+static uint8_t next;
+static uint8_t filled;
+
+static int32_t level_q4;      /* Filtered level, mV * 16 */
+static int32_t last_level_q4;
+static clock_time_t last_time;
+static int32_t drain;         /* mV per hour * 16 */
+
+static struct ctimer sample_timer;
+static clock_time_t sample_interval;
+/*---------------------------------------------------------------------------*/
+/* Insert a value into the first n sorted entries, keeping the order */
+static void
+sorted_insert(int16_t mv, uint8_t n)
+{
+  uint8_t i;
+
+  for(i = n; i > 0 && sorted[i - 1] > mv; i--) {
+    sorted[i] = sorted[i - 1];
+  }
+  sorted[i] = mv;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a value from the first n sorted entries */
+static void
+sorted_remove(int16_t mv, uint8_t n)
+{
+  uint8_t i;
+
+  for(i = 0; i < n && sorted[i] != mv; i++);
+  for(; i + 1 < n; i++) {
+    sorted[i] = sorted[i + 1];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+sample(void *ptr)
+{
+  uint32_t mv;
+
+  ctimer_set(&sample_timer, sample_interval, sample, NULL);
+
+#ifdef BATTERY_EST_CONF_SIM_MV
+  /* Virtual battery drained by radio on-time */
+  energest_flush();
+  mv = (energest_type_time(ENERGEST_TYPE_LISTEN) +
+        energest_type_time(ENERGEST_TYPE_TRANSMIT)) / RTIMER_SECOND *
+       BATTERY_EST_SIM_DRAIN;
+  mv = mv < BATTERY_EST_CONF_SIM_MV ? BATTERY_EST_CONF_SIM_MV - mv : 0;
+#else
+  /* Convert from ADC units to mV */
+  mv = battery_sensor.value(0);
+  mv *= 5000;
+  mv /= 4096;
+#endif
+
+  battery_est_add((int16_t)mv, clock_time());
+}
+/*---------------------------------------------------------------------------*/
+void
+battery_est_init(void)
+{
+  next = 0;
+  filled = 0;
+  level_q4 = 0;
+  drain = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+battery_est_start(clock_time_t interval)
+{
+  sample_interval = interval;
+  sample(NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+battery_est_set_interval(clock_time_t interval)
+{
+  if(interval != sample_interval) {
+    sample_interval = interval;
+    ctimer_set(&sample_timer, sample_interval, sample, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+battery_est_stop(void)
+{
+  ctimer_stop(&sample_timer);
+}
+/*---------------------------------------------------------------------------*/
+void
+battery_est_add(int16_t mv, clock_time_t now)
+{
+  int16_t median;
+  int32_t delta;
+  clock_time_t dt;
+
+  /* Running median: drop the oldest sample, insert the new one */
+  if(filled < BATTERY_EST_WINDOW) {
+    sorted_insert(mv, filled);
+    window[filled++] = mv;
+  } else {
+    sorted_remove(window[next], BATTERY_EST_WINDOW);
+    sorted_insert(mv, BATTERY_EST_WINDOW - 1);
+    window[next] = mv;
+    next = (next + 1) % BATTERY_EST_WINDOW;
+  }
+  median = sorted[filled / 2];
+
+  if(level_q4 == 0) {
+    level_q4 = (int32_t)median << 4;
+    last_level_q4 = level_q4;
+    last_time = now;
+    return;
+  }
+  level_q4 += (((int32_t)median << 4) - level_q4) >> BATTERY_EST_LEVEL_SHIFT;
+
+  /* Update the trend once the level has had time to move */
+  dt = now - last_time;
+  if(dt >= CLOCK_SECOND * 10) {
+    delta = level_q4 - last_level_q4;
+    /* Keep delta * 3600 * CLOCK_SECOND within 32 bits */
+    if(delta > 4000) {
+      delta = 4000;
+    } else if(delta < -4000) {
+      delta = -4000;
+    }
+    delta = delta * 3600L * CLOCK_SECOND / (int32_t)dt;
+    drain += (delta - drain) >> BATTERY_EST_DRAIN_SHIFT;
+    last_level_q4 = level_q4;
+    last_time = now;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int16_t
+battery_est_level(void)
+{
+  return (int16_t)((level_q4 + 8) >> 4);
+}
+/*---------------------------------------------------------------------------*/
+int16_t
+battery_est_drain(void)
+{
+  int32_t d = drain >> 4;
+
+  if(d > INT16_MAX) {
+    return INT16_MAX;
+  }
+  if(d < INT16_MIN) {
+    return INT16_MIN;
+  }
+  return (int16_t)d;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,115 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Streaming battery level and drain rate estimator.
+ *
+ *         The battery sensor is read once per sampling interval instead of
+ *         in bursts. Each sample goes through a running median over the
+ *         last BATTERY_EST_WINDOW samples, which rejects the odd incorrect
+ *         ADC value, and then an EWMA. The drain rate is an EWMA of the
+ *         change of the filtered level, in mV per hour.
+ *
+ *         battery_est_add() does not touch the hardware, so the filter can
+ *         be fed recorded traces on the native target.
+ */
+
+#ifndef BATTERY_EST_H_
+#define BATTERY_EST_H_
+
+#include "contiki.h"
+
+/*---------------------------------------------------------------------------*/
+/* Number of samples in the running median, odd */
+#ifdef BATTERY_EST_CONF_WINDOW
+#define BATTERY_EST_WINDOW        BATTERY_EST_CONF_WINDOW
+#else
+#define BATTERY_EST_WINDOW        5
+#endif
+
+/* EWMA weights are 1/2^shift */
+#define BATTERY_EST_LEVEL_SHIFT   2
+#define BATTERY_EST_DRAIN_SHIFT   3
+
+/* In Cooja the battery sensor reads a constant. BATTERY_EST_CONF_SIM_MV
+   replaces it with a virtual battery that starts at that level and loses
+   BATTERY_EST_SIM_DRAIN mV per second of radio on-time, so that nodes
+   which relay more run down first */
+#ifdef BATTERY_EST_CONF_SIM_DRAIN
+#define BATTERY_EST_SIM_DRAIN     BATTERY_EST_CONF_SIM_DRAIN
+#else
+#define BATTERY_EST_SIM_DRAIN     4
+#endif
+
+/* Default sampling interval */
+#ifdef BATTERY_EST_CONF_INTERVAL
+#define BATTERY_EST_INTERVAL      BATTERY_EST_CONF_INTERVAL
+#else
+#define BATTERY_EST_INTERVAL      (CLOCK_SECOND * 2)
+#endif
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Reset the estimator
+ */
+void battery_est_init(void);
+
+/**
+ * \brief      Start sampling the battery sensor periodically
+ * \param interval Sampling interval in clock ticks
+ *
+ *             The battery sensor must be activated by the caller.
+ */
+void battery_est_start(clock_time_t interval);
+
+/**
+ * \brief      Change the sampling interval, e.g. on an energy mode change
+ */
+void battery_est_set_interval(clock_time_t interval);
+
+/**
+ * \brief      Stop sampling
+ */
+void battery_est_stop(void);
+
+/**
+ * \brief      Feed one battery sample to the filter
+ * \param mv   Battery voltage in mV
+ * \param now  Time of the sample in clock ticks
+ */
+void battery_est_add(int16_t mv, clock_time_t now);
+
+/**
+ * \brief      Filtered battery level in mV, 0 before the first sample
+ */
+int16_t battery_est_level(void);
+
+/**
+ * \brief      Battery trend in mV per hour, negative while draining
+ */
+int16_t battery_est_drain(void);
+/*---------------------------------------------------------------------------*/
+#endif /* BATTERY_EST_H_ */
@@ -38,6 +38,8 @@
 #include "net/ip/uip-udp-packet.h"
 #include "sys/ctimer.h"
 #include "../example.h"
+#include "../msg-codec.h"
+#include "reading-batch.h"
 #include <stdio.h>
 #include <string.h>
 #include "powertrace.h"
@@ -90,11 +92,10 @@ static uint8_t toggleTime = 0;
 
 /*---------------------------------------------------------------------------*/
 
-/* Create a structure and pointer to store the data to be sent as payload,
-   just like my_msg_t above but with less payload */
+/* Create a structure to store the data to be sent as payload, see
+   msg-codec.h. Readings are batched before sending, see reading-batch.h */
 
-static struct my_meddelande_t meddelande; 
-static struct my_meddelande_t *meddelandePtr = &meddelande; 
+static struct msg_reading meddelande = { .fields = MSG_F_BATTERY | MSG_F_DATA_RATE }; 
 
 /*---------------------------------------------------------------------------*/
 PROCESS(udp_client_process, "UDP client example process");
@@ -102,23 +103,41 @@ AUTOSTART_PROCESSES(&udp_client_process);
 /*---------------------------------------------------------------------------*/
 /* Whenever we receive a packet from another node (or the server), this callback
  * is invoked.  We use the "uip_newdata()" to check if there is actually data for
- * us
+ * us. The server tells us where our transmission slot is, see node-slot.h
  */
+static void send_packet_info(void *ptr);
+
 static void
 tcpip_handler(void)
 {
-  char *str;
+  uint32_t frame;
+  uint32_t delay;
 
   if(uip_newdata()) {
-    str = uip_appdata;
-    str[uip_datalen()] = '\0';
-    printf("Received from the server: '%s'\n", str);
+    if(msg_decode_slot(uip_appdata, uip_datalen(), &frame, &delay)) {
+      ctimer_set(&periodic, delay, send_packet_info, NULL);
+      printf("Slot: next send in %lu ticks\n", (unsigned long)delay);
+    } else {
+      printf("Received %u bytes from the server\n", uip_datalen());
+    }
   }
 }
 
 /*---------------------------------------------------------------------------*/
 
 
+/*---------------------------------------------------------------------------*/
+
+static void
+send_batch(const uint8_t *buf, uint8_t len)
+{
+  PRINTF("Sent %u bytes to %u \n", len,
+                server_ipaddr.u8[sizeof(server_ipaddr.u8) - 1]);
+
+  uip_udp_packet_sendto(client_conn, buf, len,
+                         &server_ipaddr, UIP_HTONS(UDP_SERVER_PORT));
+}
+
 /*---------------------------------------------------------------------------*/
 
 static void 
@@ -148,14 +167,13 @@ send_packet_info(void *ptr)
   aux *= 5000;
   aux /= 4095;
   meddelande.battery = aux;
+  meddelande.data_rate = send_t_vec[toggleTime];
 
-  PRINTF("Sent packet to %u, toggleTime: %d \n", 
-                server_ipaddr.u8[sizeof(server_ipaddr.u8) - 1], toggleTime);
-  PRINTF("Message-> Battery: %u mV, Counter: %u \n", meddelandePtr->battery, 
-                                                     meddelandePtr->counter);
+  PRINTF("Queued reading, toggleTime: %d \n", toggleTime);
+  PRINTF("Message-> Battery: %u mV, Counter: %u \n", meddelande.battery, 
+                                                     meddelande.counter);
 
-  uip_udp_packet_sendto(client_conn, meddelandePtr, sizeof(meddelande),
-                         &server_ipaddr, UIP_HTONS(UDP_SERVER_PORT));
+  reading_batch_add(&meddelande);
   
 
   /*After sending 10 packets change sending interval */ 
@@ -169,7 +187,8 @@ send_packet_info(void *ptr)
     PRINTF("Send interval changed to: %u \n", send_t_vec[toggleTime]);
   } 
   
-  else ctimer_reset(&periodic);
+  /* Not ctimer_reset(), a slot message may have changed the interval */
+  else ctimer_set(&periodic, send_t_vec[toggleTime], send_packet_info, NULL);
 }
 
 /*---------------------------------------------------------------------------*/
@@ -287,12 +306,15 @@ PROCESS_THREAD(udp_client_process, ev, data)
   PRINTF(" local/remote port %u/%u\n", UIP_HTONS(client_conn->lport),
                                        UIP_HTONS(client_conn->rport));
 
+  reading_batch_init(send_batch);
   ctimer_set(&periodic, (random_rand()%(60*CLOCK_SECOND)) , send_packet_info, NULL);
 
   while(1) {
 
     PROCESS_YIELD();
-
+    if(ev == tcpip_event) {
+      tcpip_handler();
+    }
 
     } 
   
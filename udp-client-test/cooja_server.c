@@ -33,6 +33,7 @@
 #include "net/ip/uip.h"
 #include "net/rpl/rpl.h"
 #include "../example.h"
+#include "../msg-codec.h"
 #include "powertrace.h"
 
 #include "net/netstack.h"
@@ -61,16 +62,21 @@ static void
 tcpip_handler(void)
 {
 
-  struct my_meddelande_t *medPtr;
+  struct msg_cursor cursor;
+  struct msg_reading med;
 
   if(uip_newdata()) {
     
-    struct my_meddelande_t *medPtr = (struct my_meddelande_t *) uip_appdata;
-
-    PRINTF("DATA recvieved from %d, size: %d \n", 
-           UIP_IP_BUF->srcipaddr.u8[sizeof(UIP_IP_BUF->srcipaddr.u8) - 1], sizeof(uip_appdata));
-    PRINTF("Battery: %u mV , counter: %u \n", medPtr->battery, 
-                     medPtr->counter);
+    PRINTF("DATA recvieved from %d, size: %u \n", 
+           UIP_IP_BUF->srcipaddr.u8[sizeof(UIP_IP_BUF->srcipaddr.u8) - 1], uip_datalen());
+    msg_cursor_init(&cursor, uip_appdata, uip_datalen());
+    while(msg_cursor_next(&cursor, &med)) {
+      PRINTF("Battery: %u mV , counter: %u \n", med.battery, 
+                       med.counter);
+    }
+    if(cursor.next < cursor.num || cursor.num == 0) {
+      PRINTF("Malformed packet\n");
+    }
     PRINTF("\n");
 
     received_packet_attributes();
@@ -0,0 +1,172 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "harvest-forecast.h"
+
+/* Learned harvest per slot in mV/hour, and a bit per slot seen */
+static int16_t profile[HARVEST_FORECAST_SLOTS];
+static uint32_t learned;
+
+/* Observations of the slot in progress */
+static uint8_t cur_slot;
+static int32_t cur_sum;
+static uint16_t cur_num;
+
+#if HARVEST_FORECAST_SLOTS >= 32
+#define ALL_LEARNED               0xffffffffUL
+#else
+#define ALL_LEARNED               ((1UL << HARVEST_FORECAST_SLOTS) - 1)
+#endif
+/*---------------------------------------------------------------------------*/
+static uint8_t
+slot_of(uint32_t now)
+{
+  return (now % 86400UL) / HARVEST_FORECAST_SLOT_LEN;
+}
+/*---------------------------------------------------------------------------*/
+static void
+commit_slot(void)
+{
+  int16_t mean;
+
+  if(cur_num == 0) {
+    return;
+  }
+  mean = cur_sum / cur_num;
+  if(learned & (1UL << cur_slot)) {
+    profile[cur_slot] += (mean - profile[cur_slot]) >> HARVEST_FORECAST_SHIFT;
+  } else {
+    profile[cur_slot] = mean;
+    learned |= 1UL << cur_slot;
+  }
+  cur_sum = 0;
+  cur_num = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+harvest_forecast_init(void)
+{
+  learned = 0;
+  cur_sum = 0;
+  cur_num = 0;
+}
+/*---------------------------------------------------------------------------*/
+int16_t
+harvest_forecast_consumption(int16_t rate)
+{
+  /* rate mHz * 3.6 = packets per hour */
+  return HARVEST_FORECAST_IDLE +
+         (int32_t)rate * 36 * HARVEST_FORECAST_TX_COST / 10000;
+}
+/*---------------------------------------------------------------------------*/
+void
+harvest_forecast_update(uint32_t now, int16_t harvest)
+{
+  uint8_t slot = slot_of(now);
+
+  if(slot != cur_slot) {
+    commit_slot();
+    cur_slot = slot;
+  }
+  if(cur_num < 0xffff) {
+    cur_sum += harvest;
+    cur_num++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Reverse the slots from..to-1 of the profile and of the learned bits */
+static void
+reverse(uint8_t from, uint8_t to)
+{
+  int16_t p;
+  uint32_t a, b;
+
+  for(to--; from < to; from++, to--) {
+    p = profile[from];
+    profile[from] = profile[to];
+    profile[to] = p;
+    a = (learned >> from) & 1;
+    b = (learned >> to) & 1;
+    learned &= ~((1UL << from) | (1UL << to));
+    learned |= (b << from) | (a << to);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+harvest_forecast_shift(uint32_t seconds)
+{
+  uint8_t k;
+
+  k = ((seconds + HARVEST_FORECAST_SLOT_LEN / 2) /
+       HARVEST_FORECAST_SLOT_LEN) % HARVEST_FORECAST_SLOTS;
+  commit_slot();
+  if(k == 0) {
+    return;
+  }
+  /* Rotate right by k slots in place: slot s moves to s + k */
+  reverse(0, HARVEST_FORECAST_SLOTS);
+  reverse(0, k);
+  reverse(k, HARVEST_FORECAST_SLOTS);
+  cur_slot = (cur_slot + k) % HARVEST_FORECAST_SLOTS;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+harvest_forecast_ready(void)
+{
+  return learned == ALL_LEARNED;
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+harvest_forecast_next(uint32_t now, uint8_t hours)
+{
+  int32_t sum = 0;
+  uint32_t t;
+  uint32_t end = now + hours * 3600UL;
+
+  for(t = now; t < end; t += HARVEST_FORECAST_SLOT_LEN) {
+    sum += profile[slot_of(t)];
+  }
+  /* Each slot holds mV/hour, scale to the slot length */
+  return sum * (int32_t)HARVEST_FORECAST_SLOT_LEN / 3600;
+}
+/*---------------------------------------------------------------------------*/
+int16_t
+harvest_forecast_rate(uint32_t now, int16_t bat, int16_t target)
+{
+  int32_t budget;
+
+  /* mV/hour we can spend over the next day and still end at the target */
+  budget = (harvest_forecast_next(now, 24) + bat - target) / 24;
+  budget -= HARVEST_FORECAST_IDLE;
+  if(budget <= 0) {
+    return 0;
+  }
+
+  budget = budget * 10000 / (36L * HARVEST_FORECAST_TX_COST);
+  return budget > INT16_MAX ? INT16_MAX : (int16_t)budget;
+}
+/*---------------------------------------------------------------------------*/
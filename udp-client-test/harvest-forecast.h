@@ -0,0 +1,123 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Diurnal harvest forecaster.
+ *
+ *         Keeps one EWMA of the harvested power per time-of-day slot. The
+ *         harvest is not measured directly: it is the battery trend plus
+ *         the estimated consumption of the node at its current send rate.
+ *         From the profile the node can budget its transmissions to end
+ *         the next day at the battery target (energy neutrality), instead
+ *         of reacting only after the battery has dropped.
+ *
+ *         The profile lives in RAM and is learned again after a reboot.
+ */
+
+#ifndef HARVEST_FORECAST_H_
+#define HARVEST_FORECAST_H_
+
+#include "contiki.h"
+
+/*---------------------------------------------------------------------------*/
+/* Number of time-of-day slots, one per hour by default, at most 32 */
+#ifdef HARVEST_FORECAST_CONF_SLOTS
+#define HARVEST_FORECAST_SLOTS    HARVEST_FORECAST_CONF_SLOTS
+#else
+#define HARVEST_FORECAST_SLOTS    24
+#endif
+
+#define HARVEST_FORECAST_SLOT_LEN (86400UL / HARVEST_FORECAST_SLOTS)
+
+/* EWMA weight of a new day in a slot, 1/2^shift */
+#define HARVEST_FORECAST_SHIFT    2
+
+/* Consumption model, calibrate per deployment. Battery drop in mV/hour
+   with the radio duty cycling and no data traffic ... */
+#ifdef HARVEST_FORECAST_CONF_IDLE
+#define HARVEST_FORECAST_IDLE     HARVEST_FORECAST_CONF_IDLE
+#else
+#define HARVEST_FORECAST_IDLE     2
+#endif
+
+/* ... and battery drop per packet sent, in uV */
+#ifdef HARVEST_FORECAST_CONF_TX_COST
+#define HARVEST_FORECAST_TX_COST  HARVEST_FORECAST_CONF_TX_COST
+#else
+#define HARVEST_FORECAST_TX_COST  50
+#endif
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Forget the learned profile
+ */
+void harvest_forecast_init(void);
+
+/**
+ * \brief      Estimated consumption in mV/hour at a send rate
+ * \param rate Send rate in mHz
+ */
+int16_t harvest_forecast_consumption(int16_t rate);
+
+/**
+ * \brief      Feed one harvest observation
+ * \param now  Time of day in seconds
+ * \param harvest Harvested power in mV/hour (battery trend + consumption)
+ */
+void harvest_forecast_update(uint32_t now, int16_t harvest);
+
+/**
+ * \brief      Move the learned profile to a new clock
+ * \param seconds How far the new time of day is ahead of the old one,
+ *             0 to 86399
+ *
+ *             Called when the node learns the time of day, so that what
+ *             was learned against the time since boot is kept.
+ */
+void harvest_forecast_shift(uint32_t seconds);
+
+/**
+ * \brief      Whether every slot has been observed at least once
+ */
+uint8_t harvest_forecast_ready(void);
+
+/**
+ * \brief      Expected harvest in mV over the next hours
+ * \param now  Time of day in seconds
+ * \param hours Horizon in hours
+ */
+int32_t harvest_forecast_next(uint32_t now, uint8_t hours);
+
+/**
+ * \brief      Send rate that reaches the battery target in 24 hours
+ * \param now  Time of day in seconds
+ * \param bat  Current battery level in mV
+ * \param target Battery target in mV
+ * \return     Send rate in mHz, 0 if the forecast cannot afford any
+ */
+int16_t harvest_forecast_rate(uint32_t now, int16_t bat, int16_t target);
+/*---------------------------------------------------------------------------*/
+#endif /* HARVEST_FORECAST_H_ */
@@ -0,0 +1,92 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "lqt.h"
+
+/*---------------------------------------------------------------------------*/
+static int16_t
+clamp16(int32_t value, int16_t low, int16_t high)
+{
+  if(value < low) {
+    return low;
+  }
+  if(value > high) {
+    return high;
+  }
+  return (int16_t)value;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+lqt_rate_to_interval(int16_t rate)
+{
+  rate = clamp16(rate, LQT_RATE_MIN, LQT_RATE_MAX);
+  return (clock_time_t)((1000UL * CLOCK_SECOND) / (uint16_t)rate);
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+get_send_rate(int16_t bat, const int16_t *param_vector,
+              int16_t *feature_vector, const int16_t *init_vector)
+{
+  int16_t err;
+  int16_t slope;
+  int32_t u;
+  int16_t rate;
+  uint8_t i;
+
+  /* First call, or a discontinuity in the battery reading: start over */
+  if(feature_vector[LQT_F_BAT] == 0 ||
+     bat - feature_vector[LQT_F_BAT] > LQT_RESET_STEP ||
+     feature_vector[LQT_F_BAT] - bat > LQT_RESET_STEP) {
+    for(i = 0; i < LQT_FEATURE_LEN; i++) {
+      feature_vector[i] = init_vector[i];
+    }
+    feature_vector[LQT_F_BAT] = bat;
+  }
+
+  err = bat - feature_vector[LQT_F_TARGET];
+  slope = bat - feature_vector[LQT_F_BAT];
+
+  /* u = u_ff + K * [e, de, sum(e)]' */
+  u = (int32_t)param_vector[LQT_K_ERR] * err +
+      (int32_t)param_vector[LQT_K_SLOPE] * slope +
+      (int32_t)param_vector[LQT_K_INTEG] * feature_vector[LQT_F_INTEG];
+  u = init_vector[LQT_F_RATE] + (u >> LQT_GAIN_SHIFT);
+  rate = clamp16(u, LQT_RATE_MIN, LQT_RATE_MAX);
+
+  /* Only integrate while the output is not saturated in the same direction */
+  if((u < LQT_RATE_MAX || err < 0) && (u > LQT_RATE_MIN || err > 0)) {
+    feature_vector[LQT_F_INTEG] =
+      clamp16((int32_t)feature_vector[LQT_F_INTEG] + err,
+              -LQT_INTEG_MAX, LQT_INTEG_MAX);
+  }
+
+  feature_vector[LQT_F_BAT] = bat;
+  feature_vector[LQT_F_RATE] = rate;
+
+  return lqt_rate_to_interval(rate);
+}
+/*---------------------------------------------------------------------------*/
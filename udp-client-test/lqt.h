@@ -0,0 +1,87 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Fixed-point LQ tracking controller for the client send rate.
+ *
+ *         The gains in param_vector are computed offline (LQ design on the
+ *         battery/send-rate model) and applied on the node with integer
+ *         arithmetic only, since the MSP430 has no FPU.
+ */
+
+#ifndef LQT_H_
+#define LQT_H_
+
+#include "contiki.h"
+
+/*---------------------------------------------------------------------------*/
+/* Send rates are expressed in mHz, i.e. packets per 1000 seconds */
+#define LQT_RATE_MIN              10    /* One packet every 100 s */
+#define LQT_RATE_MAX              2000  /* One packet every 0.5 s */
+
+/* Gains are Q8 fixed point, in mHz per mV */
+#define LQT_GAIN_SHIFT            8
+
+/* Bound on the accumulated battery error (mV * ticks) to avoid windup */
+#define LQT_INTEG_MAX             20000
+
+/* A jump larger than this between two samples (battery swapped, sensor
+   glitch) resets the controller state to init_vector */
+#define LQT_RESET_STEP            500
+
+/* Index of the gains in param_vector */
+#define LQT_K_ERR                 0   /* Battery error to target */
+#define LQT_K_SLOPE               1   /* Battery change since last tick */
+#define LQT_K_INTEG               2   /* Accumulated battery error */
+#define LQT_PARAM_LEN             3
+
+/* Index of the controller state in feature_vector / init_vector */
+#define LQT_F_BAT                 0   /* Last battery sample, mV */
+#define LQT_F_RATE                1   /* Last/feed-forward rate, mHz */
+#define LQT_F_TARGET              2   /* Battery target, mV */
+#define LQT_F_INTEG               3   /* Accumulated battery error */
+#define LQT_FEATURE_LEN           4
+
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Compute the next send interval from the battery level
+ * \param bat  Filtered battery level in mV
+ * \param param_vector   LQ gains, LQT_PARAM_LEN entries (Q8)
+ * \param feature_vector Controller state, LQT_FEATURE_LEN entries, updated
+ * \param init_vector    Initial state, used for feed-forward and resets
+ * \return     Send interval in clock ticks
+ */
+clock_time_t get_send_rate(int16_t bat, const int16_t *param_vector,
+                           int16_t *feature_vector,
+                           const int16_t *init_vector);
+
+/**
+ * \brief      Convert a send rate in mHz to clock ticks
+ */
+clock_time_t lqt_rate_to_interval(int16_t rate);
+/*---------------------------------------------------------------------------*/
+#endif /* LQT_H_ */
@@ -0,0 +1,163 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "power-state.h"
+#include "../msg-codec.h"
+
+#include <stdio.h>
+
+#define RANK_NUM 4
+
+/* Modes from the least to the most energy */
+static const uint8_t rank_mode[RANK_NUM] = {
+  MSG_MODE_SLEEP, MSG_MODE_LO_BAT, MSG_MODE_NORMAL_OP, MSG_MODE_HI_BAT
+};
+
+static struct power_state_conf conf;
+static uint8_t rank;
+static uint8_t prev_rank;
+static clock_time_t entered;
+static unsigned long day_start;
+static struct power_state_stats stats;
+/*---------------------------------------------------------------------------*/
+/* Threshold between rank i and rank i + 1 */
+static int16_t
+threshold(uint8_t i)
+{
+  switch(i) {
+  case 0:
+    return conf.crit;
+  case 1:
+    return conf.low;
+  default:
+    return conf.high;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+new_day(void)
+{
+  printf("PSM day: %u transitions, %u flaps\n",
+         stats.transitions, stats.flaps);
+  stats.transitions = 0;
+  stats.flaps = 0;
+  day_start = clock_seconds();
+}
+/*---------------------------------------------------------------------------*/
+void
+power_state_init(const struct power_state_conf *c)
+{
+  conf = *c;
+  rank = 2;
+  prev_rank = rank;
+  entered = clock_time();
+  day_start = clock_seconds();
+  stats.transitions = 0;
+  stats.flaps = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+power_state_configure(const struct power_state_conf *c)
+{
+  conf = *c;
+}
+/*---------------------------------------------------------------------------*/
+const struct power_state_conf *
+power_state_conf(void)
+{
+  return &conf;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+power_state_update(int16_t bat)
+{
+  uint8_t next = rank;
+  clock_time_t dwell = clock_time() - entered;
+
+  if(clock_seconds() - day_start >= 86400UL) {
+    new_day();
+  }
+
+  /* Drop as soon as we are below a threshold ... */
+  while(next > 0 && bat < threshold(next - 1)) {
+    next--;
+  }
+  /* ... but only climb with a margin */
+  if(next == rank) {
+    while(next < RANK_NUM - 1 && bat >= threshold(next) + conf.hyst) {
+      next++;
+    }
+  }
+
+  /* Drops are never held back, only climbs wait out min_dwell */
+  if(next == rank || (next > rank && dwell < conf.min_dwell)) {
+    return rank_mode[rank];
+  }
+
+  stats.transitions++;
+  if(next == prev_rank && dwell < POWER_STATE_FLAP_TIME) {
+    stats.flaps++;
+  }
+  printf("PSM %s -> %s at %d mV after %lu s, today %u transitions %u flaps\n",
+         msg_mode_name(rank_mode[rank]), msg_mode_name(rank_mode[next]), bat,
+         (unsigned long)(dwell / CLOCK_SECOND), stats.transitions, stats.flaps);
+
+  prev_rank = rank;
+  rank = next;
+  entered = clock_time();
+  return rank_mode[rank];
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+power_state_mode(void)
+{
+  return rank_mode[rank];
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+power_state_shutdown_time(int16_t bat)
+{
+  int32_t deficit;
+
+  /* Deficit to the level where we may leave Sleep */
+  deficit = (int32_t)conf.crit + conf.hyst - bat;
+  if(deficit <= 0) {
+    return POWER_STATE_SHUTDOWN_MIN;
+  }
+  if(deficit > (int32_t)((POWER_STATE_SHUTDOWN_MAX - POWER_STATE_SHUTDOWN_MIN) /
+                          POWER_STATE_SHUTDOWN_PER_MV)) {
+    return POWER_STATE_SHUTDOWN_MAX;
+  }
+  return POWER_STATE_SHUTDOWN_MIN + deficit * POWER_STATE_SHUTDOWN_PER_MV;
+}
+/*---------------------------------------------------------------------------*/
+const struct power_state_stats *
+power_state_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
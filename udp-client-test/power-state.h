@@ -0,0 +1,112 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Power-state machine with hysteresis for the client energy modes.
+ *
+ *         The modes are ordered Sleep < Lo_Bat < Normal_op < Hi_bat, with
+ *         the thresholds crit, low and high between them. The node drops
+ *         to a lower mode as soon as the battery is below its threshold,
+ *         but only climbs back once the battery is hyst above it and the
+ *         node has stayed min_dwell in its current mode. Drops ignore
+ *         min_dwell. This keeps a battery hovering around a threshold
+ *         from flipping the mode (and the radio) on every tick.
+ *
+ *         Every transition is logged. A transition back to the mode the
+ *         node just left, within POWER_STATE_FLAP_TIME, counts as a flap.
+ *         The counters are printed and reset once a day.
+ */
+
+#ifndef POWER_STATE_H_
+#define POWER_STATE_H_
+
+#include "contiki.h"
+
+/*---------------------------------------------------------------------------*/
+/* A transition back within this time is counted as a flap */
+#ifdef POWER_STATE_CONF_FLAP_TIME
+#define POWER_STATE_FLAP_TIME     POWER_STATE_CONF_FLAP_TIME
+#else
+#define POWER_STATE_FLAP_TIME     (CLOCK_SECOND * 600UL)
+#endif
+
+/* Shutdown length: min plus per_mv for every mV of deficit, up to max */
+#define POWER_STATE_SHUTDOWN_MIN  (CLOCK_SECOND * 15)
+#define POWER_STATE_SHUTDOWN_MAX  (CLOCK_SECOND * 600UL)
+#define POWER_STATE_SHUTDOWN_PER_MV CLOCK_SECOND
+
+struct power_state_conf {
+  int16_t crit;              /* Sleep below, mV */
+  int16_t low;               /* Lo_Bat below, mV */
+  int16_t high;              /* Hi_bat above, mV */
+  int16_t hyst;              /* Extra margin to climb a mode, mV */
+  clock_time_t min_dwell;    /* Least time in a mode before climbing */
+};
+
+struct power_state_stats {
+  uint16_t transitions;      /* Today */
+  uint16_t flaps;            /* Today */
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Start in Normal_op with the given thresholds
+ */
+void power_state_init(const struct power_state_conf *conf);
+
+/**
+ * \brief      Replace the thresholds, keeping the current mode
+ */
+void power_state_configure(const struct power_state_conf *conf);
+
+/**
+ * \brief      Current thresholds
+ */
+const struct power_state_conf *power_state_conf(void);
+
+/**
+ * \brief      Feed a battery level and get the resulting mode
+ * \param bat  Filtered battery level in mV
+ * \return     Energy mode, one of MSG_MODE_*
+ */
+uint8_t power_state_update(int16_t bat);
+
+/**
+ * \brief      Current energy mode, one of MSG_MODE_*
+ */
+uint8_t power_state_mode(void);
+
+/**
+ * \brief      How long to shut the radio down for, given the battery level
+ */
+clock_time_t power_state_shutdown_time(int16_t bat);
+
+/**
+ * \brief      Transition counters for the current day
+ */
+const struct power_state_stats *power_state_stats(void);
+/*---------------------------------------------------------------------------*/
+#endif /* POWER_STATE_H_ */
@@ -0,0 +1,221 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "sys/ctimer.h"
+#include "sys/energest.h"
+#include "net/netstack.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "net/rpl/rpl.h"
+#include "rdc-profile.h"
+
+#include <stdio.h>
+
+static struct rdc_profile profiles[MSG_MODE_NUM] = {
+  /* MSG_MODE_NORMAL_OP */ { 0, 1, 0 },
+  /* MSG_MODE_LO_BAT */    { 0, RDC_PROFILE_LO_BAT_LISTEN, RDC_PROFILE_LO_BAT_OFF },
+  /* MSG_MODE_HI_BAT */    { 1, 0, 0 },
+  /* MSG_MODE_SLEEP */     { 0, 0, 0 },
+};
+
+static uint8_t cur_mode;
+static uint8_t in_window;     /* Listen phase of a duty cycled profile */
+static uint8_t holding;       /* Kept on after a send */
+static uint8_t shutdown;      /* Radio off until the shutdown path ends */
+static struct ctimer window_timer;
+static struct ctimer hold_timer;
+
+/* Listen time (rtimer ticks) and elapsed time (clock ticks) per profile */
+static unsigned long listen_time[MSG_MODE_NUM];
+static unsigned long elapsed_time[MSG_MODE_NUM];
+static unsigned long last_listen;
+static clock_time_t last_time;
+/*---------------------------------------------------------------------------*/
+static void
+account(void)
+{
+  unsigned long listen;
+  clock_time_t now = clock_time();
+
+  energest_flush();
+  listen = energest_type_time(ENERGEST_TYPE_LISTEN);
+  listen_time[cur_mode] += listen - last_listen;
+  elapsed_time[cur_mode] += now - last_time;
+  last_listen = listen;
+  last_time = now;
+}
+/*---------------------------------------------------------------------------*/
+/* Whether RPL children may be sending through us. In storing mode we
+   hold a route for each descendant. Non-storing mode keeps no routes on
+   the way down, so there only an RPL leaf is sure to have none */
+static uint8_t
+is_router(void)
+{
+#if WITH_NON_STORING
+  return rpl_get_mode() != RPL_MODE_LEAF;
+#else
+  return uip_ds6_route_num_routes() > 0;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+update(void)
+{
+  const struct rdc_profile *p = &profiles[cur_mode];
+
+  if(shutdown || cur_mode == MSG_MODE_SLEEP) {
+    /* The shutdown path owns the radio, also once the energy climbs out
+       of Sleep before its timer fires */
+    return;
+  }
+
+  /* ContikiMAC's on() only resumes duty cycling, off(1) keeps the radio
+     on so that the sink's replies are acked on their first strobe */
+  if(p->always_on || holding) {
+    NETSTACK_MAC.off(1);
+  } else if(p->off == 0 ? p->listen > 0 : in_window) {
+    NETSTACK_MAC.on();
+  } else {
+    NETSTACK_MAC.off(0);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+window(void *ptr)
+{
+  const struct rdc_profile *p = &profiles[cur_mode];
+
+  if(p->off > 0) {
+    /* A router stays in the listen window, its children cannot know when
+       it is off and their uplinks would be lost */
+    in_window = !in_window || is_router();
+    ctimer_set(&window_timer, in_window ? p->listen : p->off, window, NULL);
+  }
+  update();
+}
+/*---------------------------------------------------------------------------*/
+static void
+hold_expired(void *ptr)
+{
+  holding = 0;
+  update();
+}
+/*---------------------------------------------------------------------------*/
+void
+rdc_profile_init(void)
+{
+  cur_mode = MSG_MODE_NORMAL_OP;
+  in_window = 0;
+  holding = 0;
+  shutdown = 0;
+  energest_flush();
+  last_listen = energest_type_time(ENERGEST_TYPE_LISTEN);
+  last_time = clock_time();
+}
+/*---------------------------------------------------------------------------*/
+void
+rdc_profile_set(uint8_t mode)
+{
+  if(mode >= MSG_MODE_NUM || mode == cur_mode) {
+    return;
+  }
+  account();
+  cur_mode = mode;
+  ctimer_stop(&window_timer);
+  if(mode == MSG_MODE_SLEEP) {
+    ctimer_stop(&hold_timer);
+    holding = 0;
+  }
+
+  /* Start duty cycled profiles with a listen window */
+  in_window = 0;
+  window(NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+rdc_profile_configure(uint8_t mode, const struct rdc_profile *p)
+{
+  if(mode < MSG_MODE_NUM) {
+    profiles[mode] = *p;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rdc_profile_shutdown(uint8_t on)
+{
+  if(on) {
+    shutdown = 1;
+    ctimer_stop(&hold_timer);
+    holding = 0;
+    NETSTACK_MAC.off(0);
+    return;
+  }
+  shutdown = 0;
+  if(cur_mode == MSG_MODE_SLEEP) {
+    /* Up for the sends between two shutdowns */
+    NETSTACK_MAC.on();
+  } else {
+    update();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rdc_profile_hold(clock_time_t t)
+{
+  if(shutdown || cur_mode == MSG_MODE_SLEEP) {
+    /* Never turn the radio on behind the shutdown path */
+    return;
+  }
+  if(!holding) {
+    holding = 1;
+    update();
+  }
+  ctimer_set(&hold_timer, t, hold_expired, NULL);
+}
+/*---------------------------------------------------------------------------*/
+void
+rdc_profile_print_stats(void)
+{
+  uint8_t i;
+  unsigned long duty;
+
+  account();
+  for(i = 0; i < MSG_MODE_NUM; i++) {
+    if(elapsed_time[i] == 0) {
+      continue;
+    }
+    /* Duty cycle in 1/10000, listen in rtimer ticks vs elapsed in clock
+       ticks. In 64 bits, the product would leave 32 bits within seconds */
+    duty = (unsigned long long)listen_time[i] * CLOCK_SECOND * 10000 /
+      ((unsigned long long)elapsed_time[i] * RTIMER_SECOND);
+    printf("RDC %s: listen %lu ms in %lu s, duty %lu.%02lu%%\n",
+           msg_mode_name(i),
+           listen_time[i] / (RTIMER_SECOND / 1000),
+           elapsed_time[i] / CLOCK_SECOND,
+           duty / 100, duty % 100);
+  }
+}
+/*---------------------------------------------------------------------------*/
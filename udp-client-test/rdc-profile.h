@@ -0,0 +1,129 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Radio duty-cycle profiles switched at runtime per energy mode.
+ *
+ *         ContikiMAC's channel check rate is fixed at compile time and has
+ *         to be the same on all nodes, since a sender strobes for one
+ *         cycle of its own check rate. So the profiles do not change the
+ *         check rate. Instead they choose how much of the time the node
+ *         listens at all:
+ *
+ *           Hi_bat     radio always on, reachable with no strobe wait
+ *           Normal_op  ContikiMAC at NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE
+ *           Lo_Bat     ContikiMAC during listen windows, radio off between
+ *           Sleep      radio off, owned by the shutdown path
+ *
+ *         The shutdown path brackets its radio off time with
+ *         rdc_profile_shutdown(). Until it ends, the radio stays off
+ *         whatever mode the energy climbs to, and sends are not held.
+ *
+ *         The Lo_Bat radio off time would cut off RPL children, which
+ *         cannot tell when their parent listens, so a node that routes
+ *         for others stays in its listen window. In storing mode that is
+ *         a node with downward routes. In non-storing mode only RPL leaves
+ *         (RPL_MODE_LEAF) take the off time.
+ *
+ *         Sending with rdc_profile_hold() first keeps the radio on, not
+ *         duty cycled, for RDC_PROFILE_HOLD after an uplink. The sink's
+ *         ack, slot and control replies then get through on their first
+ *         strobe instead of waiting for a channel check. The profile is
+ *         restored when the hold ends. It does nothing in Sleep.
+ *
+ *         The time spent listening in each profile is measured with
+ *         energest, see rdc_profile_print_stats().
+ */
+
+#ifndef RDC_PROFILE_H_
+#define RDC_PROFILE_H_
+
+#include "contiki.h"
+#include "../msg-codec.h"
+
+/*---------------------------------------------------------------------------*/
+/* Lo_Bat listen window and the radio off time between windows */
+#ifdef RDC_PROFILE_CONF_LO_BAT_LISTEN
+#define RDC_PROFILE_LO_BAT_LISTEN RDC_PROFILE_CONF_LO_BAT_LISTEN
+#else
+#define RDC_PROFILE_LO_BAT_LISTEN (CLOCK_SECOND * 2)
+#endif
+
+#ifdef RDC_PROFILE_CONF_LO_BAT_OFF
+#define RDC_PROFILE_LO_BAT_OFF    RDC_PROFILE_CONF_LO_BAT_OFF
+#else
+#define RDC_PROFILE_LO_BAT_OFF    (CLOCK_SECOND * 8)
+#endif
+
+/* How long to keep the radio on after a send, room for the sink's
+   replies to go out one after the other */
+#ifdef RDC_PROFILE_CONF_HOLD
+#define RDC_PROFILE_HOLD          RDC_PROFILE_CONF_HOLD
+#else
+#define RDC_PROFILE_HOLD          (CLOCK_SECOND / 2)
+#endif
+
+struct rdc_profile {
+  uint8_t always_on;       /* Keep the radio on, no duty cycling */
+  clock_time_t listen;     /* Duty cycled listen window, 0 = radio off */
+  clock_time_t off;        /* Radio off between windows, 0 = never off */
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Start with the Normal_op profile
+ */
+void rdc_profile_init(void);
+
+/**
+ * \brief      Switch to the profile of an energy mode
+ * \param mode One of MSG_MODE_*
+ */
+void rdc_profile_set(uint8_t mode);
+
+/**
+ * \brief      Replace the profile of an energy mode
+ */
+void rdc_profile_configure(uint8_t mode, const struct rdc_profile *p);
+
+/**
+ * \brief      Start or end a Sleep shutdown
+ * \param on   Non-zero turns the radio off and keeps it off, zero hands
+ *             the radio back to the profile of the current mode
+ */
+void rdc_profile_shutdown(uint8_t on);
+
+/**
+ * \brief      Keep the radio on, not duty cycled, for at least t ticks
+ */
+void rdc_profile_hold(clock_time_t t);
+
+/**
+ * \brief      Print the listen time and duty cycle measured per profile
+ */
+void rdc_profile_print_stats(void);
+/*---------------------------------------------------------------------------*/
+#endif /* RDC_PROFILE_H_ */
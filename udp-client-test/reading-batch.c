@@ -0,0 +1,127 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "sys/ctimer.h"
+#include "reading-batch.h"
+
+#include <string.h>
+
+#define DEBUG DEBUG_PRINT
+#include "net/ip/uip-debug.h"
+
+#if READING_BATCH_PAYLOAD < MSG_BATCH_HDR_LEN + MSG_READING_MAX_LEN
+#error "READING_BATCH_PAYLOAD does not fit one reading"
+#endif
+
+static struct msg_reading pending[READING_BATCH_NUM];
+static uint8_t count;
+
+static uint8_t buf[READING_BATCH_PAYLOAD];
+static struct ctimer deadline;
+static reading_batch_send_t send_cb;
+static struct reading_batch_stats stats;
+/*---------------------------------------------------------------------------*/
+static void
+deadline_expired(void *ptr)
+{
+  reading_batch_flush();
+}
+/*---------------------------------------------------------------------------*/
+void
+reading_batch_init(reading_batch_send_t send)
+{
+  send_cb = send;
+  count = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+reading_batch_add(const struct msg_reading *r)
+{
+  if(count == READING_BATCH_NUM) {
+    /* Cannot happen unless a flush failed to encode, drop the oldest */
+    memmove(&pending[0], &pending[1], (count - 1) * sizeof(pending[0]));
+    count--;
+  }
+  pending[count++] = *r;
+
+  if(count == 1) {
+    ctimer_set(&deadline, READING_BATCH_DEADLINE, deadline_expired, NULL);
+  }
+  if(count == READING_BATCH_NUM) {
+    reading_batch_flush();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+reading_batch_flush(void)
+{
+  uint8_t i;
+  uint8_t sent;
+  uint8_t len;
+
+  ctimer_stop(&deadline);
+
+  /* Readings that do not fit one frame go out in the next datagram */
+  i = 0;
+  while(i < count) {
+#if READING_BATCH_DELTA
+    sent = msg_encode_batch_delta(buf, sizeof(buf), &pending[i], count - i,
+                                  &len);
+#else
+    sent = msg_encode_batch(buf, sizeof(buf), &pending[i], count - i, &len);
+#endif
+    if(sent == 0) {
+      break;
+    }
+    send_cb(buf, len);
+    stats.readings += sent;
+    stats.datagrams++;
+    stats.bytes += len;
+    i += sent;
+  }
+
+  if(count > 0) {
+    PRINTF("Batch: %lu readings in %lu datagrams of %lu bytes, saved %lu header bytes and %lu wakeups\n",
+           stats.readings, stats.datagrams, stats.bytes,
+           (stats.readings - stats.datagrams) * READING_BATCH_HDR_COST,
+           stats.readings - stats.datagrams);
+  }
+  count = 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+reading_batch_pending(void)
+{
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+const struct reading_batch_stats *
+reading_batch_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
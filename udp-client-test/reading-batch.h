@@ -0,0 +1,116 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Batching of client readings into single-frame datagrams.
+ *
+ *         Readings are kept in a fixed RAM buffer and sent together, so the
+ *         ContikiMAC strobe and the IPv6/UDP header are paid once per
+ *         batch instead of once per reading. The batch is flushed when
+ *         READING_BATCH_NUM readings are pending, when the oldest pending
+ *         reading is READING_BATCH_DEADLINE old, or explicitly by the
+ *         application (e.g. on an energy mode change).
+ */
+
+#ifndef READING_BATCH_H_
+#define READING_BATCH_H_
+
+#include "contiki.h"
+#include "../msg-codec.h"
+
+/*---------------------------------------------------------------------------*/
+/* Number of readings kept in RAM before a flush is forced */
+#ifdef READING_BATCH_CONF_NUM
+#define READING_BATCH_NUM         READING_BATCH_CONF_NUM
+#else
+#define READING_BATCH_NUM         8
+#endif
+
+/* Longest time a reading may wait in the batch */
+#ifdef READING_BATCH_CONF_DEADLINE
+#define READING_BATCH_DEADLINE    READING_BATCH_CONF_DEADLINE
+#else
+#define READING_BATCH_DEADLINE    (CLOCK_SECOND * 30)
+#endif
+
+/* UDP payload that still fits a single 802.15.4 frame, see example.h.
+   WITH_ONE_FRAME takes the worst case of the server address mode from
+   project-conf.h instead of the one-hop header measured with Wireshark */
+#ifdef READING_BATCH_CONF_PAYLOAD
+#define READING_BATCH_PAYLOAD     READING_BATCH_CONF_PAYLOAD
+#elif WITH_ONE_FRAME
+#define READING_BATCH_PAYLOAD     FRAME_PAYLOAD_MAX
+#else
+#define READING_BATCH_PAYLOAD     80
+#endif
+
+/* Delta-code the readings in a batch, see msg-codec.h */
+#ifdef READING_BATCH_CONF_DELTA
+#define READING_BATCH_DELTA       READING_BATCH_CONF_DELTA
+#else
+#define READING_BATCH_DELTA       1
+#endif
+
+/* UDP+6LoWPAN header bytes saved for every reading that shares a datagram */
+#define READING_BATCH_HDR_COST    45
+
+/* Send callback, called once per datagram */
+typedef void (*reading_batch_send_t)(const uint8_t *buf, uint8_t len);
+
+struct reading_batch_stats {
+  uint32_t readings;      /* Readings sent */
+  uint32_t datagrams;     /* Datagrams (radio wakeups) used to send them */
+  uint32_t bytes;         /* UDP payload bytes used to send them */
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Initialise the batch
+ * \param send Function that puts one encoded datagram on the air
+ */
+void reading_batch_init(reading_batch_send_t send);
+
+/**
+ * \brief      Queue a reading, flushing if the batch is full
+ */
+void reading_batch_add(const struct msg_reading *r);
+
+/**
+ * \brief      Send all pending readings now
+ */
+void reading_batch_flush(void);
+
+/**
+ * \brief      Number of readings waiting in the batch
+ */
+uint8_t reading_batch_pending(void);
+
+/**
+ * \brief      Readings and datagrams sent so far
+ */
+const struct reading_batch_stats *reading_batch_stats(void);
+/*---------------------------------------------------------------------------*/
+#endif /* READING_BATCH_H_ */
@@ -0,0 +1,382 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "cfs/cfs-coffee.h"
+#include "reading-log.h"
+
+#include <stdio.h>
+
+#define DEBUG DEBUG_PRINT
+#include "net/ip/uip-debug.h"
+
+#define MARKER                    0xa5
+/* Segment header marker, changed with the record layout so segments of an
+   older layout are dropped instead of misread */
+#define SEG_MARKER                0xa6
+#define SEG_SIZE                  (READING_LOG_HDR_LEN + \
+                                   READING_LOG_SEG_RECORDS * \
+                                   READING_LOG_RECORD_LEN)
+#define COUNTER_FILE              "rctr"
+#define COUNTER_SIZE              (READING_LOG_COUNTER_RECORDS * \
+                                   READING_LOG_COUNTER_LEN)
+
+static uint8_t used;          /* Segments holding data */
+static uint8_t read_seg;      /* Oldest segment */
+static uint16_t read_rec;     /* Next record to read in it */
+static uint8_t write_seg;     /* Newest segment */
+static uint16_t write_rec;    /* Records in it */
+static uint16_t generation;   /* Of the newest segment */
+static uint16_t count;
+static uint16_t dropped;
+static uint16_t boot;         /* Boot number, from the counter file */
+static uint16_t counter_start;
+static uint16_t reserved;     /* Counters below this one are reserved */
+static uint8_t counter_recs;  /* Reservations in the counter file */
+/*---------------------------------------------------------------------------*/
+static const char *
+seg_name(uint8_t seg)
+{
+  static char name[] = "rlog0";
+
+  name[4] = '0' + seg;
+  return name;
+}
+/*---------------------------------------------------------------------------*/
+/* Records held by a segment */
+static uint16_t
+seg_records(uint8_t seg)
+{
+  return seg == write_seg ? write_rec : READING_LOG_SEG_RECORDS;
+}
+/*---------------------------------------------------------------------------*/
+static void
+drop_read_seg(void)
+{
+  cfs_remove(seg_name(read_seg));
+  used--;
+  read_seg = (read_seg + 1) % READING_LOG_SEGMENTS;
+  read_rec = 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+new_write_seg(void)
+{
+  uint8_t hdr[READING_LOG_HDR_LEN];
+  int fd;
+
+  if(used > 0) {
+    write_seg = (write_seg + 1) % READING_LOG_SEGMENTS;
+  }
+  if(used == READING_LOG_SEGMENTS) {
+    /* Full, the new segment takes the place of the oldest one */
+    count -= seg_records(read_seg) - read_rec;
+    dropped += seg_records(read_seg) - read_rec;
+    PRINTF("Log full, dropped %u readings\n", seg_records(read_seg) - read_rec);
+    drop_read_seg();
+  }
+
+  /* Reserve the whole segment up front so Coffee never relocates it */
+  cfs_coffee_reserve(seg_name(write_seg), SEG_SIZE);
+  fd = cfs_open(seg_name(write_seg), CFS_WRITE);
+  if(fd < 0) {
+    return -1;
+  }
+  generation++;
+  hdr[0] = generation & 0xff;
+  hdr[1] = generation >> 8;
+  hdr[2] = SEG_MARKER;
+  if(cfs_write(fd, hdr, sizeof(hdr)) != sizeof(hdr)) {
+    cfs_close(fd);
+    cfs_remove(seg_name(write_seg));
+    return -1;
+  }
+  cfs_close(fd);
+
+  if(used == 0) {
+    read_seg = write_seg;
+    read_rec = 0;
+  }
+  used++;
+  write_rec = 0;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Append a reservation of the counters below reserved, with the boot
+   number. A full file is started over */
+static void
+save_counter(void)
+{
+  uint8_t rec[READING_LOG_COUNTER_LEN];
+  int fd;
+
+  if(counter_recs == READING_LOG_COUNTER_RECORDS) {
+    cfs_remove(COUNTER_FILE);
+    counter_recs = 0;
+  }
+  if(counter_recs == 0) {
+    cfs_coffee_reserve(COUNTER_FILE, COUNTER_SIZE);
+  }
+  rec[0] = reserved & 0xff;
+  rec[1] = reserved >> 8;
+  rec[2] = boot & 0xff;
+  rec[3] = boot >> 8;
+  rec[4] = MARKER;
+  fd = cfs_open(COUNTER_FILE, CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    PRINTF("Log: counter not saved\n");
+    return;
+  }
+  if(cfs_write(fd, rec, sizeof(rec)) == sizeof(rec)) {
+    counter_recs++;
+  }
+  cfs_close(fd);
+}
+/*---------------------------------------------------------------------------*/
+/* Resume the counter and count the boot, from the last reservation */
+static void
+load_counter(void)
+{
+  uint8_t rec[READING_LOG_COUNTER_LEN];
+  cfs_offset_t size;
+  int fd;
+
+  reserved = 0;
+  boot = 0;
+  counter_recs = 0;
+  fd = cfs_open(COUNTER_FILE, CFS_READ);
+  if(fd >= 0) {
+    size = cfs_seek(fd, 0, CFS_SEEK_END);
+    counter_recs = size / READING_LOG_COUNTER_LEN;
+    if(counter_recs > 0 &&
+       cfs_seek(fd, (counter_recs - 1) * READING_LOG_COUNTER_LEN,
+                CFS_SEEK_SET) >= 0 &&
+       cfs_read(fd, rec, sizeof(rec)) == sizeof(rec) && rec[4] == MARKER) {
+      reserved = rec[0] | (rec[1] << 8);
+      boot = rec[2] | (rec[3] << 8);
+    }
+    cfs_close(fd);
+  }
+
+  counter_start = reserved;
+  boot++;
+  reserved = counter_start + READING_LOG_COUNTER_STEP;
+  save_counter();
+  PRINTF("Log: boot %u, counter from %u\n", boot, counter_start);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+reading_log_counter_start(void)
+{
+  return counter_start;
+}
+/*---------------------------------------------------------------------------*/
+void
+reading_log_counter(uint16_t counter)
+{
+  if((int16_t)(counter - reserved) >= 0) {
+    reserved = counter + READING_LOG_COUNTER_STEP;
+    save_counter();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+reading_log_init(void)
+{
+  uint8_t hdr[READING_LOG_HDR_LEN];
+  uint16_t gen[READING_LOG_SEGMENTS];
+  uint16_t recs[READING_LOG_SEGMENTS];
+  uint8_t oldest = 0;
+  uint8_t i;
+  cfs_offset_t size;
+  int fd;
+
+  used = 0;
+  count = 0;
+  dropped = 0;
+  generation = 0;
+  write_seg = 0;
+  write_rec = 0;
+  read_seg = 0;
+  read_rec = 0;
+  load_counter();
+
+  for(i = 0; i < READING_LOG_SEGMENTS; i++) {
+    fd = cfs_open(seg_name(i), CFS_READ);
+    if(fd < 0) {
+      continue;
+    }
+    size = cfs_seek(fd, 0, CFS_SEEK_END);
+    cfs_seek(fd, 0, CFS_SEEK_SET);
+    if(size < READING_LOG_HDR_LEN ||
+       cfs_read(fd, hdr, sizeof(hdr)) != sizeof(hdr) || hdr[2] != SEG_MARKER) {
+      cfs_close(fd);
+      cfs_remove(seg_name(i));
+      continue;
+    }
+    cfs_close(fd);
+    gen[i] = hdr[0] | (hdr[1] << 8);
+    recs[i] = (size - READING_LOG_HDR_LEN) / READING_LOG_RECORD_LEN;
+    if(used == 0 || gen[i] < gen[oldest]) {
+      oldest = i;
+    }
+    if(used == 0 || gen[i] > generation) {
+      generation = gen[i];
+      write_seg = i;
+    }
+    used++;
+    count += recs[i];
+  }
+
+  if(used > 0) {
+    read_seg = oldest;
+    write_rec = recs[write_seg];
+    PRINTF("Log: %u readings in %u segments\n", count, used);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+reading_log_append(const struct msg_reading *r, uint32_t now)
+{
+  uint8_t rec[READING_LOG_RECORD_LEN];
+  int fd;
+
+  if((used == 0 || write_rec == READING_LOG_SEG_RECORDS) &&
+     new_write_seg() < 0) {
+    return -1;
+  }
+
+  rec[0] = r->counter & 0xff;
+  rec[1] = r->counter >> 8;
+  rec[2] = r->battery & 0xff;
+  rec[3] = r->battery >> 8;
+  rec[4] = r->data_rate & 0xff;
+  rec[5] = (r->data_rate >> 8) & 0xff;
+  rec[6] = (r->data_rate >> 16) & 0xff;
+  rec[7] = r->data_rate >> 24;
+  rec[8] = ((r->fields & ~MSG_F_DELAYED) << 4) | (r->mode & 0x0f);
+  rec[9] = now & 0xff;
+  rec[10] = (now >> 8) & 0xff;
+  rec[11] = (now >> 16) & 0xff;
+  rec[12] = now >> 24;
+  rec[13] = boot & 0xff;
+  rec[14] = boot >> 8;
+  rec[15] = MARKER;
+
+  fd = cfs_open(seg_name(write_seg), CFS_WRITE | CFS_APPEND);
+  if(fd < 0) {
+    return -1;
+  }
+  if(cfs_write(fd, rec, sizeof(rec)) != sizeof(rec)) {
+    cfs_close(fd);
+    return -1;
+  }
+  cfs_close(fd);
+
+  write_rec++;
+  count++;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+reading_log_read(struct msg_reading *r, uint8_t max, uint32_t now)
+{
+  uint8_t rec[READING_LOG_RECORD_LEN];
+  uint8_t n = 0;
+  uint8_t progress;
+  uint32_t t;
+  int fd;
+
+  while(n < max && count > 0) {
+    if(read_rec == seg_records(read_seg)) {
+      /* Drained. Keep a partially written newest segment for appending */
+      if(read_seg == write_seg && write_rec < READING_LOG_SEG_RECORDS) {
+        break;
+      }
+      drop_read_seg();
+      continue;
+    }
+
+    fd = cfs_open(seg_name(read_seg), CFS_READ);
+    if(fd < 0) {
+      break;
+    }
+    cfs_seek(fd, READING_LOG_HDR_LEN + read_rec * READING_LOG_RECORD_LEN,
+             CFS_SEEK_SET);
+    progress = n;
+    while(n < max && read_rec < seg_records(read_seg) &&
+          cfs_read(fd, rec, sizeof(rec)) == sizeof(rec)) {
+      r[n].counter = rec[0] | (rec[1] << 8);
+      r[n].battery = rec[2] | (rec[3] << 8);
+      r[n].data_rate = rec[4] | ((uint32_t)rec[5] << 8) |
+        ((uint32_t)rec[6] << 16) | ((uint32_t)rec[7] << 24);
+      r[n].fields = rec[8] >> 4;
+      r[n].mode = rec[8] & 0x0f;
+      t = rec[9] | ((uint32_t)rec[10] << 8) |
+        ((uint32_t)rec[11] << 16) | ((uint32_t)rec[12] << 24);
+      /* The clock restarted with the boot, the age of a reading from an
+         earlier boot is unknown */
+      r[n].age = 0;
+      if((rec[13] | (rec[14] << 8)) == boot && now >= t) {
+        r[n].fields |= MSG_F_AGE;
+        r[n].age = now - t;
+      } else {
+        r[n].fields |= MSG_F_BACKLOG;
+      }
+      read_rec++;
+      count--;
+      n++;
+    }
+    cfs_close(fd);
+
+    if(n == progress) {
+      /* Segment shorter than expected, give up on the rest of it */
+      count -= seg_records(read_seg) - read_rec;
+      dropped += seg_records(read_seg) - read_rec;
+      read_rec = seg_records(read_seg);
+    }
+  }
+
+  if(count == 0 && used > 0 && read_rec == seg_records(read_seg)) {
+    /* Everything sent, start over with a fresh segment next time */
+    drop_read_seg();
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+reading_log_count(void)
+{
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+reading_log_dropped(void)
+{
+  return dropped;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,146 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Flash-backed store-and-forward log of readings.
+ *
+ *         Readings taken while the radio is off are appended to a log in
+ *         Coffee (CFS) and drained later. The log is split into
+ *         READING_LOG_SEGMENTS files that are used round robin. Each file
+ *         is reserved at its full size when it is created, so Coffee never
+ *         has to grow (copy) it. A fully drained file is removed instead of
+ *         rewritten. Records are only ever appended. Each segment starts
+ *         with a generation number so the order survives a reboot.
+ *
+ *         The read position is kept in RAM. After a reboot the oldest
+ *         segment is sent again from its start, and the sink drops the
+ *         duplicates by counter.
+ *
+ *         The log also keeps the reading counter and a boot number across
+ *         reboots, in a small append-only file of its own. The counter is
+ *         reserved READING_LOG_COUNTER_STEP readings ahead, and a reboot
+ *         resumes from the last reservation, so new readings never reuse
+ *         the counter of one still in the log or at the sink. Records
+ *         carry the boot they were taken in. The clock restarts with a
+ *         boot, so readings from an earlier boot are read back with
+ *         MSG_F_BACKLOG instead of an age: their age is unknown.
+ */
+
+#ifndef READING_LOG_H_
+#define READING_LOG_H_
+
+#include "contiki.h"
+#include "../msg-codec.h"
+
+/*---------------------------------------------------------------------------*/
+#ifdef READING_LOG_CONF_SEGMENTS
+#define READING_LOG_SEGMENTS      READING_LOG_CONF_SEGMENTS
+#else
+#define READING_LOG_SEGMENTS      4
+#endif
+
+/* Records per segment file */
+#ifdef READING_LOG_CONF_SEG_RECORDS
+#define READING_LOG_SEG_RECORDS   READING_LOG_CONF_SEG_RECORDS
+#else
+#define READING_LOG_SEG_RECORDS   100
+#endif
+
+/* counter, battery, data rate, fields/mode, time, boot, end marker. Coffee
+   finds the end of a file by its last non-zero byte, so every record and
+   the segment header end with a non-zero marker */
+#define READING_LOG_RECORD_LEN    (2 + 2 + 4 + 1 + 4 + 2 + 1)
+
+/* Segment header: generation number, end marker */
+#define READING_LOG_HDR_LEN       (2 + 1)
+
+/* Readings the counter is reserved ahead. A reboot skips at most this
+   many counters, which the sink counts as lost */
+#ifdef READING_LOG_CONF_COUNTER_STEP
+#define READING_LOG_COUNTER_STEP  READING_LOG_CONF_COUNTER_STEP
+#else
+#define READING_LOG_COUNTER_STEP  16
+#endif
+
+/* Counter reservations kept before the file is started over */
+#define READING_LOG_COUNTER_RECORDS 32
+
+/* Counter reservation: counter, boot number, end marker */
+#define READING_LOG_COUNTER_LEN   (2 + 2 + 1)
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Pick up the segments left by a previous run
+ */
+void reading_log_init(void);
+
+/**
+ * \brief      Counter of the first reading of this boot
+ *
+ *             Valid after reading_log_init(), see above.
+ */
+uint16_t reading_log_counter_start(void);
+
+/**
+ * \brief      A new reading counter was taken into use
+ *
+ *             Reserves the next READING_LOG_COUNTER_STEP counters in flash
+ *             when counter reaches the end of the current reservation.
+ */
+void reading_log_counter(uint16_t counter);
+
+/**
+ * \brief      Append a reading
+ * \param r    Reading to store
+ * \param now  Time of the reading in seconds
+ * \return     0 on success, -1 if the flash could not be written
+ *
+ *             When the log is full the oldest segment is dropped.
+ */
+int reading_log_append(const struct msg_reading *r, uint32_t now);
+
+/**
+ * \brief      Take the oldest readings out of the log
+ * \param r    Readings, with MSG_F_AGE set relative to now, or with
+ *             MSG_F_BACKLOG if the reading was taken before the last
+ *             reboot
+ * \param max  Room in r
+ * \param now  Current time in seconds
+ * \return     Number of readings read
+ */
+uint8_t reading_log_read(struct msg_reading *r, uint8_t max, uint32_t now);
+
+/**
+ * \brief      Number of readings waiting in the log
+ */
+uint16_t reading_log_count(void);
+
+/**
+ * \brief      Number of readings lost because the log was full
+ */
+uint16_t reading_log_dropped(void);
+/*---------------------------------------------------------------------------*/
+#endif /* READING_LOG_H_ */
@@ -0,0 +1,166 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "reading-retx.h"
+#include "reading-batch.h"
+
+#include <string.h>
+
+#define DEBUG DEBUG_PRINT
+#include "net/ip/uip-debug.h"
+
+struct entry {
+  struct msg_reading r;
+  unsigned long taken;       /* clock_seconds() when first sent */
+  clock_time_t sent;         /* clock_time() when last sent */
+  uint8_t tries;
+  uint8_t missing;           /* Reported missing since last sent */
+};
+
+/* Ring of readings in the order they were sent */
+static struct entry entries[READING_RETX_NUM];
+static uint8_t first;
+static uint8_t count;
+static struct reading_retx_stats stats;
+/*---------------------------------------------------------------------------*/
+static void
+remove_first(void)
+{
+  first = (first + 1) % READING_RETX_NUM;
+  count--;
+}
+/*---------------------------------------------------------------------------*/
+void
+reading_retx_init(void)
+{
+  first = 0;
+  count = 0;
+  memset(&stats, 0, sizeof(stats));
+}
+/*---------------------------------------------------------------------------*/
+void
+reading_retx_add(const struct msg_reading *r)
+{
+  struct entry *e;
+
+  if(count == READING_RETX_NUM) {
+    stats.given_up++;
+    remove_first();
+  }
+  e = &entries[(first + count) % READING_RETX_NUM];
+  e->r = *r;
+  e->taken = clock_seconds();
+  e->sent = clock_time();
+  e->tries = 0;
+  e->missing = 0;
+  count++;
+  stats.sent++;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+reading_retx_ack(uint16_t cumulative, uint32_t bitmap, uint8_t resend)
+{
+  struct entry *e;
+  struct msg_reading r;
+  uint8_t i, j;
+  uint8_t kept = 0;
+  uint8_t resent = 0;
+  int16_t ahead;
+  int16_t last;
+
+  /* Highest counter the sink has seen, readings before it that are not
+     acked were lost */
+  for(last = MSG_ACK_WINDOW; last > 0; last--) {
+    if(bitmap & (1UL << (last - 1))) {
+      break;
+    }
+  }
+
+  /* Compact the ring, keeping the readings that are not acked */
+  for(i = 0; i < count; i++) {
+    e = &entries[(first + i) % READING_RETX_NUM];
+    ahead = (int16_t)(e->r.counter - cumulative);
+    if(ahead <= 0 && e->missing) {
+      /* The sink moved its window past a reading it never got */
+      stats.lost++;
+      continue;
+    }
+    if(ahead <= 0 ||
+       (ahead <= MSG_ACK_WINDOW && (bitmap & (1UL << (ahead - 1))))) {
+      stats.acked++;
+      continue;
+    }
+    if(ahead < last) {
+      e->missing = 1;
+    }
+
+    if(resend && ahead < last &&
+       clock_time() - e->sent >= READING_RETX_TIMEOUT) {
+      if(e->tries == READING_RETX_TRIES) {
+        stats.given_up++;
+        continue;
+      }
+      r = e->r;
+      /* A backlog reading has no age to add to */
+      if(!(r.fields & MSG_F_BACKLOG)) {
+        r.fields |= MSG_F_AGE;
+        r.age += clock_seconds() - e->taken;
+      }
+      reading_batch_add(&r);
+      e->sent = clock_time();
+      e->tries++;
+      e->missing = 0;
+      stats.resent++;
+      resent++;
+    }
+
+    j = (first + kept) % READING_RETX_NUM;
+    if(&entries[j] != e) {
+      entries[j] = *e;
+    }
+    kept++;
+  }
+  count = kept;
+
+  if(resent > 0) {
+    PRINTF("Retx: resent %u, %u waiting for an ack\n", resent, count);
+  }
+  return resent;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+reading_retx_pending(void)
+{
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+const struct reading_retx_stats *
+reading_retx_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
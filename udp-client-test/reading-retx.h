@@ -0,0 +1,117 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Retransmit buffer for readings, driven by the sink's acks.
+ *
+ *         Every reading handed to the batch is also kept here until the
+ *         sink acks its counter (see MSG_TYPE_ACK in msg-codec.h). A
+ *         reading the sink reports missing, while it has seen later ones,
+ *         is resent once READING_RETX_TIMEOUT has passed since it was last
+ *         sent, at most READING_RETX_TRIES times. Resent readings carry
+ *         their age so the sink can place them in time, except backlog
+ *         readings (MSG_F_BACKLOG), whose age is unknown.
+ *
+ *         Resending costs airtime, so the application decides per ack
+ *         whether the energy mode allows it. Missing readings then wait for
+ *         a later ack. When the buffer is full the oldest reading is given
+ *         up on.
+ *
+ *         The sink moves its cumulative counter past readings that fall
+ *         out of its window unreceived. A reading it last reported missing
+ *         and that was not resent since is counted lost when that happens,
+ *         not acked.
+ */
+
+#ifndef READING_RETX_H_
+#define READING_RETX_H_
+
+#include "contiki.h"
+#include "../msg-codec.h"
+
+/*---------------------------------------------------------------------------*/
+/* Readings kept until acked */
+#ifdef READING_RETX_CONF_NUM
+#define READING_RETX_NUM          READING_RETX_CONF_NUM
+#else
+#define READING_RETX_NUM          16
+#endif
+
+/* Least time between two sends of a reading. A reading can wait up to
+   READING_BATCH_DEADLINE in the batch before it goes out */
+#ifdef READING_RETX_CONF_TIMEOUT
+#define READING_RETX_TIMEOUT      READING_RETX_CONF_TIMEOUT
+#else
+#define READING_RETX_TIMEOUT      (CLOCK_SECOND * 60)
+#endif
+
+/* Resends of one reading before giving up on it */
+#ifdef READING_RETX_CONF_TRIES
+#define READING_RETX_TRIES        READING_RETX_CONF_TRIES
+#else
+#define READING_RETX_TRIES        3
+#endif
+
+struct reading_retx_stats {
+  uint32_t sent;             /* Readings sent for the first time */
+  uint32_t acked;            /* Readings the sink acked */
+  uint32_t resent;           /* Resends */
+  uint32_t given_up;         /* Readings dropped unacked */
+  uint32_t lost;             /* Readings the sink gave up on */
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Start with an empty buffer
+ */
+void reading_retx_init(void);
+
+/**
+ * \brief      Keep a reading that was just handed to the batch
+ */
+void reading_retx_add(const struct msg_reading *r);
+
+/**
+ * \brief      Process an ack from the sink
+ * \param cumulative Every counter up to this one is done
+ * \param bitmap Bit i set if counter cumulative + 1 + i was received
+ * \param resend Non-zero if the energy mode allows resending now
+ * \return     Number of readings resent, through reading_batch_add()
+ */
+uint8_t reading_retx_ack(uint16_t cumulative, uint32_t bitmap,
+                         uint8_t resend);
+
+/**
+ * \brief      Readings waiting for an ack
+ */
+uint8_t reading_retx_pending(void);
+
+/**
+ * \brief      Counters since boot
+ */
+const struct reading_retx_stats *reading_retx_stats(void);
+/*---------------------------------------------------------------------------*/
+#endif /* READING_RETX_H_ */
@@ -0,0 +1,145 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "net/rpl/rpl.h"
+#include "net/rpl/rpl-private.h"
+#include "rpl-profile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Longest DIO interval, 2^24 ms. rpl-timers.c computes the interval in
+   ticks in 32 bits */
+#define INTERVAL_MAX              24
+
+static struct rpl_profile profiles[MSG_MODE_NUM] = {
+  /* MSG_MODE_NORMAL_OP */ { 0, 0, 0, 1 },
+  /* MSG_MODE_LO_BAT */    { 1, 1, 2, 3 },
+  /* MSG_MODE_HI_BAT */    { 0, 0, 0, 1 },
+  /* MSG_MODE_SLEEP */     { 2, 2, 1, 6 },
+};
+
+struct timing {
+  uint8_t intmin;
+  uint8_t intdoubl;
+  uint8_t redundancy;
+  uint8_t lifetime;
+};
+
+/* The root's values. The sink is built with the same project-conf.h and
+   sets up its instance from these. A DIO may carry a neighbor's profile
+   instead, so what the instance was joined with is not used */
+static const struct timing root = {
+  RPL_DIO_INTERVAL_MIN, RPL_DIO_INTERVAL_DOUBLINGS, RPL_DIO_REDUNDANCY,
+  RPL_DEFAULT_LIFETIME
+};
+
+static uint8_t cur_mode;
+/*---------------------------------------------------------------------------*/
+static void
+read_instance(rpl_instance_t *instance, struct timing *t)
+{
+  t->intmin = instance->dio_intmin;
+  t->intdoubl = instance->dio_intdoubl;
+  t->redundancy = instance->dio_redundancy;
+  t->lifetime = instance->default_lifetime;
+}
+/*---------------------------------------------------------------------------*/
+static void
+apply(void)
+{
+  rpl_instance_t *instance;
+  const struct rpl_profile *p = &profiles[cur_mode];
+  struct timing cur;
+  struct timing t;
+  uint16_t lifetime;
+
+  instance = rpl_get_default_instance();
+  if(instance == NULL || instance->current_dag == NULL) {
+    return;
+  }
+
+  t.intmin = root.intmin + p->intmin;
+  t.intdoubl = root.intdoubl + p->doublings;
+  if(t.intmin > INTERVAL_MAX) {
+    t.intmin = INTERVAL_MAX;
+  }
+  if(t.intmin + t.intdoubl > INTERVAL_MAX) {
+    t.intdoubl = INTERVAL_MAX - t.intmin;
+  }
+  t.redundancy = p->redundancy > 0 ? p->redundancy : root.redundancy;
+  t.lifetime = root.lifetime;
+  if(root.lifetime != RPL_INFINITE_LIFETIME && p->lifetime > 1) {
+    lifetime = (uint16_t)root.lifetime * p->lifetime;
+    t.lifetime = lifetime < RPL_INFINITE_LIFETIME ? lifetime :
+      RPL_INFINITE_LIFETIME - 1;
+  }
+
+  read_instance(instance, &cur);
+  if(memcmp(&t, &cur, sizeof(t)) != 0) {
+    instance->dio_intmin = t.intmin;
+    instance->dio_intdoubl = t.intdoubl;
+    instance->dio_redundancy = t.redundancy;
+    instance->default_lifetime = t.lifetime;
+
+    /* Let the running interval finish, the next one is in the new range */
+    if(instance->dio_intcurrent < t.intmin) {
+      instance->dio_intcurrent = t.intmin;
+    } else if(instance->dio_intcurrent > t.intmin + t.intdoubl) {
+      instance->dio_intcurrent = t.intmin + t.intdoubl;
+    }
+
+    printf("RPL %s: imin %u doublings %u k %u lifetime %u\n",
+           msg_mode_name(cur_mode), t.intmin, t.intdoubl, t.redundancy,
+           t.lifetime);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_profile_init(void)
+{
+  cur_mode = MSG_MODE_NORMAL_OP;
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_profile_set(uint8_t mode)
+{
+  if(mode >= MSG_MODE_NUM) {
+    return;
+  }
+  cur_mode = mode;
+  apply();
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_profile_configure(uint8_t mode, const struct rpl_profile *p)
+{
+  if(mode < MSG_MODE_NUM) {
+    profiles[mode] = *p;
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,98 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         RPL control timing per energy mode.
+ *
+ *         The DODAG root sets the Trickle parameters of the DIOs and the
+ *         lifetime of the routes a DAO installs, and every node copies
+ *         them into its instance on joining. The profiles set this node's
+ *         copy relative to the root's values, which are taken from the
+ *         build configuration the sink shares, not from the DIOs:
+ *
+ *           intmin      added to the DIO interval min, a slower first DIO
+ *                       after an inconsistency
+ *           doublings   added to the DIO interval doublings, a longer
+ *                       steady state interval
+ *           redundancy  DIO redundancy constant k, suppresses this node's
+ *                       DIO when k neighbors sent a consistent one, 0
+ *                       keeps the root's
+ *           lifetime    the root's route lifetime times this, DAOs are
+ *                       refreshed at half the lifetime
+ *
+ *         The routes stay up across a change. A DAO carries the lifetime
+ *         it was sent with, so the parent's route always outlives the next
+ *         refresh, and the lifetime unit, which the parent reads as its
+ *         own, is left alone. A change neither resets the Trickle timer
+ *         nor sends a DAO, the new values apply from the next interval and
+ *         the next refresh.
+ *
+ *         Contiki puts the instance's values into every DIO, so a node in
+ *         Lo_Bat or Sleep advertises its profile. A node that joins through
+ *         it copies them, and keeps them until its own next battery sample
+ *         sets its profile over the root's values again, Normal_op
+ *         included. A node built with WITH_RPL_PROFILE=0 keeps the copied
+ *         values until the next global repair, so do not mix the two
+ *         builds in one network. The root's values must match the sink's
+ *         build, which they do while both use ../project-conf.h.
+ */
+
+#ifndef RPL_PROFILE_H_
+#define RPL_PROFILE_H_
+
+#include "contiki.h"
+#include "../msg-codec.h"
+
+/*---------------------------------------------------------------------------*/
+struct rpl_profile {
+  uint8_t intmin;          /* Added to the DIO interval min */
+  uint8_t doublings;       /* Added to the DIO interval doublings */
+  uint8_t redundancy;      /* DIO redundancy constant, 0 = the root's */
+  uint8_t lifetime;        /* Times the root's route lifetime, at least 1 */
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Start with the Normal_op profile
+ */
+void rpl_profile_init(void);
+
+/**
+ * \brief      Apply the profile of an energy mode
+ * \param mode One of MSG_MODE_*
+ *
+ *             Call it with every battery sample, not only on a mode
+ *             change, so the profile also reaches an instance joined or
+ *             repaired since.
+ */
+void rpl_profile_set(uint8_t mode);
+
+/**
+ * \brief      Replace the profile of an energy mode
+ */
+void rpl_profile_configure(uint8_t mode, const struct rpl_profile *p);
+/*---------------------------------------------------------------------------*/
+#endif /* RPL_PROFILE_H_ */
@@ -50,9 +50,46 @@
 /* Example configuration file */
 #include "../example.h"
 
+/* Wire format of the readings */
+#include "../msg-codec.h"
+
+/* Batching of readings into single-frame datagrams */
+#include "reading-batch.h"
+
 /* LQ tracking estimate file */
 #include "lqt.h"
 
+/* Battery level and drain rate estimator */
+#include "battery-est.h"
+
+/* Diurnal harvest forecast */
+#include "harvest-forecast.h"
+
+/* Radio duty-cycle profiles per energy mode */
+#include "rdc-profile.h"
+
+/* RPL control timing per energy mode */
+#include "rpl-profile.h"
+
+/* Energy mode state machine */
+#include "power-state.h"
+
+/* Store-and-forward log for readings taken with the radio off */
+#include "reading-log.h"
+
+/* Resend buffer for readings the sink did not ack */
+#include "reading-retx.h"
+
+#if WITH_ENERGY_OF
+/* Residual energy advertised to RPL children */
+#include "../rpl-energy-of.h"
+#endif
+
+#if WITH_RPL_BENCH
+/* Counters for the storing against non-storing benchmark */
+#include "../rpl-bench.h"
+#endif
+
 #include <stdio.h>
 #include <string.h>
 
@@ -82,7 +119,14 @@
 #define LOW_BAT 2900
 #define HIGH_BAT 3400 
 #define CRIT_BAT 2700
-//#define GOAL_BAT 3200
+#define GOAL_BAT 3200
+#define FF_RATE 200               /* LQ feed-forward until the forecast is ready, mHz */
+#define HYST_BAT 50               /* Margin to climb to a higher mode */
+#define MIN_DWELL (CLOCK_SECOND*60) /* Least time in a mode before climbing */
+
+/* Pause between bursts when draining the flash log */
+#define DRAIN_INTERV_HI (CLOCK_SECOND*2)
+#define DRAIN_INTERV (CLOCK_SECOND*10)
 
 static clock_time_t calc_interv = CLOCK_SECOND*4;
 
@@ -90,38 +134,59 @@ static clock_time_t calc_interv = CLOCK_SECOND*4;
 static struct uip_udp_conn *client_conn;
 static uip_ipaddr_t server_ipaddr;
 
-/* Create a structure and pointer to store the data to be sent as payload.
- * The data includes send rate, current battery level, sender ID and send mode. 
+/* Create a structure to store the data to be sent as payload. The data
+ * includes send rate, current battery level, counter and send mode. 
  */
 
-static struct my_meddelande_t meddelande; 
-static struct my_meddelande_t *meddelandePtr = &meddelande; 
+static struct msg_reading meddelande = { .fields = MSG_F_BATTERY | MSG_F_DATA_RATE };
 
 //TIMERS 
 static struct ctimer periodic; 
 static struct etimer shutdown_time; 
 static struct ctimer pid_timer; 
+static struct ctimer drain_timer; 
 
-/* Toggle shutdown mode */
+/* Set while the radio is shut down in Sleep mode */
 static uint8_t toggleShutdown = 0;
 
+static const struct power_state_conf power_conf = {
+  CRIT_BAT, LOW_BAT, HIGH_BAT, HYST_BAT, MIN_DWELL
+};
+
 
-/* Vars for calculating the battery level */
-int16_t bat_loop[10];
+/* Filtered battery level, see battery-est.h */
 int16_t bat_median;
 
+/* Seconds to add to clock_seconds() to get the time of day, set by the 
+   sink's control messages. Until then the forecast slots are relative to 
+   boot, which still gives a consistent daily profile */
+static uint32_t tod_offset = 0;
 
-/* LQ Parameters */
-static int16_t param_vector[3] = {2000,-1000,1000}; 
-static int16_t feature_vector[3] = {700, 200, -650}; //Init bat, init dc, bat target
-static int16_t init_vector[3] = {2000, -1000, 1000}; 
-static int16_t test[3] = {5,6,7}; //array used for testing 
+/* LQ feed-forward rate pinned by the sink, 0: the harvest forecast sets it.
+   calc_interv_time() is the only writer of init_vector[LQT_F_RATE] */
+static int16_t ff_rate = 0;
+
+
+/* LQ Parameters, see lqt.h for units */
+static int16_t param_vector[LQT_PARAM_LEN] = {920, 1024, 13}; //Error, slope, integral gains
+static int16_t feature_vector[LQT_FEATURE_LEN]; //Controller state, set on first call
+static int16_t init_vector[LQT_FEATURE_LEN] = {0, FF_RATE, GOAL_BAT, 0}; //Init bat, init rate, bat target, integral
+
+/* Settings pushed by the sink, see node-control.h on the server */
+static clock_time_t fixed_interv = 0; //0: the LQ controller sets the rate
+static uint8_t ctrl_epoch; //Sink boot of the last control message applied
+static uint8_t ctrl_seq; //Last control message applied, restarts with ctrl_epoch
+static uint8_t ctrl_valid = 0;
+
+/* Slot frame set by the sink, 0 until the first slot message. Intervals 
+   of a frame or longer are rounded to whole frames to stay in the slot */
+static clock_time_t slot_frame = 0;
 
 /*---------------------------------------------------------------------------*/
 PROCESS(udp_client_process, "UDP client process");
 AUTOSTART_PROCESSES(&udp_client_process);
 /*---------------------------------------------------------------------------*/
-static int seq_id;
+static uint16_t seq_id;
 static int reply;
 static int counter;
 
@@ -131,87 +196,321 @@ static int counter;
 
 /*---------------------------------------------------------------------------*/
 
-/* Set new send rate. If the current battery level is above or below certain
-   thresholds, set some pre-defined send-rates */
+static void drain_log(void *ptr);
+
+/*---------------------------------------------------------------------------*/
+/* Delivery counters, to set against the energy use per mode */
+static void
+print_retx_stats(void)
+{
+#if WITH_RETX
+  const struct reading_retx_stats *st = reading_retx_stats();
+
+  printf("Retx: sent %lu, acked %lu, resent %lu, given up %lu, lost %lu\n",
+         st->sent, st->acked, st->resent, st->given_up, st->lost);
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+/* Hand a reading to the batch, and keep it until the sink acks it */
+static void
+queue_reading(const struct msg_reading *r)
+{
+  reading_batch_add(r);
+#if WITH_RETX
+  reading_retx_add(r);
+#endif
+}
+
+#if WITH_ENERGY_OF
+/* Level advertised to RPL children: the battery between the critical and
+   the high threshold as 0 to 255. Lo_Bat keeps it under the energy OF's
+   penalty threshold and Sleep, where the radio goes off, advertises 0 */
+static uint8_t
+energy_level(void)
+{
+  const struct power_state_conf *c = power_state_conf();
+  int32_t level;
+
+  if (meddelande.mode == MSG_MODE_SLEEP || c->high <= c->crit) return 0;
+  level = 255L * (bat_median - c->crit) / (c->high - c->crit);
+  if (level < 0) level = 0;
+  if (level > 255) level = 255;
+  if (meddelande.mode == MSG_MODE_LO_BAT && level >= RPL_ENERGY_OF_LOW)
+    level = RPL_ENERGY_OF_LOW - 1;
+  return level;
+}
+#endif
+
+/* Set new send rate. Below the critical battery level the node sleeps,
+   otherwise the LQ tracking controller sets the rate */
 
 static void calc_interv_time (void)
 {
   ctimer_reset(&pid_timer);  
-  uint8_t i; 
+  uint8_t prev_mode = meddelande.mode;
+  uint32_t now;
 
-  /* Read battery sensor 11 times and take median 
-     in order to remove the odd incorrect value */ 
-  for (i=0; i<11; i++)
+  /* The battery is sampled in the background, the estimator already
+     removes the odd incorrect value with a running median */ 
+  bat_median = battery_est_level();
+  
+//  printf("Battery median: %d, drain: %d mV/h \n", bat_median, battery_est_drain());
+
+  /* Learn the harvest: battery trend plus what we spent at the current rate.
+     Once a full day is known, use the energy neutral rate as the LQ 
+     feed-forward so the controller only corrects around it, unless the 
+     sink pinned the feed-forward */
+  now = clock_seconds() + tod_offset;
+  harvest_forecast_update(now, battery_est_drain() + 
+                          harvest_forecast_consumption(1000UL*CLOCK_SECOND/calc_interv));
+  if (ff_rate > 0) init_vector[LQT_F_RATE] = ff_rate;
+  else if (harvest_forecast_ready())
   {
-    bat_loop[i] = battery_sensor.value(0);  
-    bat_loop[i] *= 5000;
-    bat_loop[i] /= 4096;
+    init_vector[LQT_F_RATE] = harvest_forecast_rate(now, bat_median, 
+                                                    init_vector[LQT_F_TARGET]);
   }
+  else init_vector[LQT_F_RATE] = FF_RATE;
 
-  sortArray(bat_loop, 11); //Sort array elements 
-  bat_median = bat_loop[5]; //Read the median value 
-  
-//  printf("Battery median: %d \n", bat_median);
   meddelande.battery = bat_median; //Update the battery level for packet  
-  toggleShutdown = 0; //unless critical battery level, keep radio on
-  
 
-  if (bat_median<CRIT_BAT) //Critical level --> need to save power
+  /* Mode changes go through the state machine, which applies hysteresis
+     and minimum dwell times */
+  meddelande.mode = power_state_update(bat_median);
+#if WITH_ENERGY_OF
+  rpl_energy_of_set(energy_level());
+#endif
+#if WITH_RPL_PROFILE
+  rpl_profile_set(meddelande.mode);
+#endif
+
+  if (meddelande.mode == MSG_MODE_SLEEP) //Critical level --> need to save power
   {
-    toggleShutdown = 1; //force radio off next loop 
-    process_post(&udp_client_process,PROCESS_EVENT_CONTINUE,NULL);
-    strcpy(meddelande.mode, "Sleep");
+    //ask the process to turn the radio off, unless it already is
+    if (!toggleShutdown) process_post(&udp_client_process,PROCESS_EVENT_CONTINUE,NULL);
     calc_interv = CLOCK_SECOND*100;
   }
-  else if (bat_median<LOW_BAT)
+  else if (fixed_interv > 0) calc_interv = fixed_interv; //set by the sink
+  else 
   {
-    strcpy(meddelande.mode, "Lo_Bat");
-    calc_interv = CLOCK_SECOND*50;
+    //Calculate send frequency using LQ tracking towards the battery target
+    calc_interv = get_send_rate(bat_median, param_vector, feature_vector, init_vector);
   }
-  else if (bat_median>HIGH_BAT)
+
+  /* Energy state changed, do not hold readings taken in the old state and
+     sample the battery less often the less energy we have */
+  if (meddelande.mode != prev_mode) 
   {
-    strcpy(meddelande.mode, "Hi_bat");
-    calc_interv = CLOCK_SECOND/2;
+    reading_batch_flush();
+    rdc_profile_set(meddelande.mode);
+    rdc_profile_print_stats();
+    print_retx_stats();
+    if (meddelande.mode == MSG_MODE_SLEEP) battery_est_set_interval(BATTERY_EST_INTERVAL*15);
+    else if (meddelande.mode == MSG_MODE_LO_BAT) battery_est_set_interval(BATTERY_EST_INTERVAL*5);
+    else battery_est_set_interval(BATTERY_EST_INTERVAL);
   }
-  else {
-  strcpy(meddelande.mode, "Normal_op"); //
-  calc_interv = CLOCK_SECOND*5;
-  //calc_interv = get_send_rate(bat_median, param_vector, feature_vector, init_vector); //Calculate send frequency using LQ tracking
+
+  /* Energy recovered, start sending the backlog */
+  if ((meddelande.mode == MSG_MODE_NORMAL_OP || meddelande.mode == MSG_MODE_HI_BAT) &&
+      reading_log_count() > 0 && ctimer_expired(&drain_timer)) 
+  {
+    ctimer_set(&drain_timer, DRAIN_INTERV, drain_log, NULL);
   }
 }
 
+/*---------------------------------------------------------------------------*/
+static void
+send_batch(const uint8_t *buf, uint8_t len)
+{
+  PRINTF("Sent %u bytes to %u \n", len,
+                server_ipaddr.u8[sizeof(server_ipaddr.u8) - 1]);
+
+  rdc_profile_hold(RDC_PROFILE_HOLD); //radio on, and listen for a reply
+  uip_udp_packet_sendto(client_conn, buf, len,
+                         &server_ipaddr, UIP_HTONS(UDP_SERVER_PORT));
+}
+
 /*---------------------------------------------------------------------------*/
 static void
 send_packet(void *ptr)
 {
+  clock_time_t interv;
+
   counter++;
   seq_id++;
   meddelande.counter = seq_id; 
+  reading_log_counter(meddelande.counter); //survives a reboot, see reading-log.h
+
+  /* Reschedule with the interval from the latest calc_interv_time() */ 
+  interv = calc_interv;
+  if (slot_frame > 0 && interv >= slot_frame) 
+  {
+    interv = (interv + slot_frame/2) / slot_frame * slot_frame;
+  }
+  ctimer_reset(&periodic);  
+  ctimer_set(&periodic, interv, send_packet, NULL);
+  PRINTF("Send interval changed to: %u ticks\n", interv);
 
-  /*After sending packets change sending interval */ 
-  calc_interv = CLOCK_SECOND*8;
+  meddelande.data_rate = interv; //data rate in ticks
 
 
-  ctimer_reset(&periodic);  
-  ctimer_set(&periodic, calc_interv, send_packet, NULL);
-  PRINTF("Send interval changed to: %u ticks\n", calc_interv);
+  PRINTF("Message-> Battery: %u mV, Counter: %u \n", meddelande.battery, 
+                                                     meddelande.counter);
 
-  meddelande.data_rate = calc_interv; //data rate in ticks
+  /* Radio is off, keep the reading in flash until energy recovers */
+  if (toggleShutdown) 
+  {
+    if (reading_log_append(&meddelande, clock_seconds()) < 0) PRINTF("Log write failed\n");
+  }
+  else queue_reading(&meddelande);
 
+}
 
-  PRINTF("Sent packet to %u \n", 
-                server_ipaddr.u8[sizeof(server_ipaddr.u8) - 1]);
-  PRINTF("Message-> Battery: %u mV, Counter: %u \n", meddelandePtr->battery, 
-                                                     meddelandePtr->counter);
+/*---------------------------------------------------------------------------*/
+/* Send the readings logged while the radio was off, one batch per burst */
+static void
+drain_log(void *ptr)
+{
+  static struct msg_reading backlog[READING_BATCH_NUM];
+  uint8_t i, n;
 
-  uip_udp_packet_sendto(client_conn, meddelandePtr, sizeof(meddelande),
-                         &server_ipaddr, UIP_HTONS(UDP_SERVER_PORT));
+  if (toggleShutdown || (power_state_mode() != MSG_MODE_NORMAL_OP && 
+                         power_state_mode() != MSG_MODE_HI_BAT)) return;
+
+  n = reading_log_read(backlog, READING_BATCH_NUM, clock_seconds());
+  for (i=0; i<n; i++) queue_reading(&backlog[i]);
+  reading_batch_flush();
+  PRINTF("Drained %u readings from the log, %u left \n", n, reading_log_count());
 
+  if (reading_log_count() > 0) 
+  {
+    ctimer_set(&drain_timer, power_state_mode() == MSG_MODE_HI_BAT ? 
+               DRAIN_INTERV_HI : DRAIN_INTERV, drain_log, NULL);
+  }
 }
 
 /*---------------------------------------------------------------------------*/
+/* Apply the settings pushed by the sink. Values that make no sense are 
+   ignored, a bad command must not take a deployed node down */
+static void
+apply_control(const struct msg_control *ctrl)
+{
+  struct power_state_conf conf;
+  uint32_t offset;
+
+  if (ctrl->cmds & MSG_C_INTERVAL)
+  {
+    if (ctrl->interval == 0) fixed_interv = 0;
+    else if (ctrl->interval < lqt_rate_to_interval(LQT_RATE_MAX)) 
+      fixed_interv = lqt_rate_to_interval(LQT_RATE_MAX);
+    else if (ctrl->interval > lqt_rate_to_interval(LQT_RATE_MIN)) 
+      fixed_interv = lqt_rate_to_interval(LQT_RATE_MIN);
+    else fixed_interv = ctrl->interval;
+    PRINTF("Control: send interval %lu ticks \n", (unsigned long)fixed_interv);
+  }
+
+  if (ctrl->cmds & MSG_C_THRESHOLDS)
+  {
+    conf = *power_state_conf();
+    conf.crit = ctrl->thresholds[0];
+    conf.low = ctrl->thresholds[1];
+    conf.high = ctrl->thresholds[2];
+    conf.hyst = ctrl->thresholds[3];
+    if (conf.crit < conf.low && conf.low < conf.high && conf.hyst >= 0) 
+    {
+      power_state_configure(&conf);
+      PRINTF("Control: thresholds %d/%d/%d mV, hyst %d mV \n", 
+             conf.crit, conf.low, conf.high, conf.hyst);
+    }
+  }
 
+  if (ctrl->cmds & MSG_C_PARAM)
+  {
+    memcpy(param_vector, ctrl->param, sizeof(param_vector));
+    PRINTF("Control: LQ gains %d %d %d \n", 
+           param_vector[0], param_vector[1], param_vector[2]);
+  }
 
+  /* New initial state, restart the controller from it on the next tick. 
+     The rate pins the feed-forward, 0 hands it back to the forecast */
+  if (ctrl->cmds & MSG_C_FEATURE)
+  {
+    init_vector[LQT_F_BAT] = ctrl->feature[LQT_F_BAT];
+    init_vector[LQT_F_TARGET] = ctrl->feature[LQT_F_TARGET];
+    init_vector[LQT_F_INTEG] = ctrl->feature[LQT_F_INTEG];
+    if (ctrl->feature[LQT_F_RATE] > LQT_RATE_MAX) ff_rate = LQT_RATE_MAX;
+    else if (ctrl->feature[LQT_F_RATE] > 0) ff_rate = ctrl->feature[LQT_F_RATE];
+    else ff_rate = 0;
+    feature_vector[LQT_F_BAT] = 0;
+    PRINTF("Control: LQ state %d %d %d %d \n", ctrl->feature[0], 
+           ctrl->feature[1], ctrl->feature[2], ctrl->feature[3]);
+  }
+
+  /* Time of day for the forecast slots, keep what was learned so far */
+  if ((ctrl->cmds & MSG_C_TIME) && ctrl->time < 86400UL)
+  {
+    offset = (ctrl->time + 86400UL - clock_seconds() % 86400UL) % 86400UL;
+    harvest_forecast_shift((offset + 86400UL - tod_offset) % 86400UL);
+    tod_offset = offset;
+    PRINTF("Control: time of day %lu s \n", (unsigned long)ctrl->time);
+  }
+}
+
+/*---------------------------------------------------------------------------*/
+/* Downlink from the sink, received while the radio is held on after an 
+   uplink. Slot messages align the send timer, reading acks drive the 
+   resends as far as the energy mode allows. Every control message is acked, a repeated one is not applied
+   twice */
+static void
+tcpip_handler(void)
+{
+  static struct msg_control ctrl;
+  uint8_t ack[MSG_CONTROL_ACK_LEN];
+  uint16_t cumulative;
+  uint32_t bitmap;
+  uint32_t frame;
+  uint32_t delay;
+
+  if (!uip_newdata()) return;
+
+  /* Move the periodic timer to the start of our slot */
+  if (msg_decode_slot(uip_appdata, uip_datalen(), &frame, &delay))
+  {
+    slot_frame = frame;
+    ctimer_set(&periodic, delay, send_packet, NULL);
+    PRINTF("Slot: next send in %lu ticks, frame %lu ticks \n", 
+           (unsigned long)delay, (unsigned long)frame);
+    return;
+  }
+
+  if (msg_decode_ack(uip_appdata, uip_datalen(), &cumulative, &bitmap))
+  {
+#if WITH_RETX
+    reading_retx_ack(cumulative, bitmap, !toggleShutdown && 
+                     (power_state_mode() == MSG_MODE_NORMAL_OP || 
+                      power_state_mode() == MSG_MODE_HI_BAT));
+#endif
+    return;
+  }
+
+  if (!msg_decode_control(uip_appdata, uip_datalen(), &ctrl))
+  {
+    PRINTF("Unknown downlink, %u bytes \n", uip_datalen());
+    return;
+  }
+
+  if (!ctrl_valid || ctrl.epoch != ctrl_epoch || ctrl.seq != ctrl_seq) 
+  {
+    apply_control(&ctrl);
+    ctrl_epoch = ctrl.epoch;
+    ctrl_seq = ctrl.seq;
+    ctrl_valid = 1;
+  }
+
+  msg_encode_control_ack(ack, sizeof(ack), ctrl.epoch, ctrl.seq);
+  uip_udp_packet_sendto(client_conn, ack, sizeof(ack),
+                        &server_ipaddr, UIP_HTONS(UDP_SERVER_PORT));
+}
 
 /*_---------------------------------------------------------------------------------*/
 
@@ -245,10 +544,17 @@ set_global_address(void)
   uip_ds6_set_addr_iid(&ipaddr, &uip_lladdr);
   uip_ds6_addr_add(&ipaddr, 0, ADDR_AUTOCONF);
 
+  /* The sink's address for SERVER_ADDR_MODE, see project-conf.h */
+#if SERVER_ADDR_MODE == SERVER_ADDR_64
+  uip_ip6addr(&server_ipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, 0, 1);
+#elif SERVER_ADDR_MODE == SERVER_ADDR_16
+  uip_ip6addr(&server_ipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0x00ff, 0xfe00, 1);
+#else
   //hardcoded server address to a specific z1 mote (ID: 151 --> 0x0097 in hex)
-  // If simulating in Cooja, set last digit in address function to 1
-  if (COOJA_SIM) uip_ip6addr(&server_ipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0x00ff, 0xfe00, 1); 
+  // If simulating in Cooja, mote 1
+  if (COOJA_SIM) uip_ip6addr(&server_ipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0xc30c, 0, 0, 1); 
   else uip_ip6addr(&server_ipaddr, 0xfe80, 0, 0, 0, 0xc30c, 0, 0, 0x0097);
+#endif
 
 }
 
@@ -293,7 +599,21 @@ PROCESS_THREAD(udp_client_process, ev, data)
   powertrace_sniff(POWERTRACE_ON);
 #endif
 
+  reading_batch_init(send_batch);
+  rdc_profile_init();
+  rpl_profile_init();
+#if WITH_RPL_BENCH
+  rpl_bench_init();
+#endif
+  power_state_init(&power_conf);
+  reading_log_init();
+  seq_id = reading_log_counter_start() - 1; //the first send adds one
+  reading_retx_init();
+
   SENSORS_ACTIVATE(battery_sensor);
+  battery_est_init();
+  harvest_forecast_init();
+  battery_est_start(BATTERY_EST_INTERVAL);
   calc_interv_time(); 
   ctimer_set(&periodic, CLOCK_SECOND*2, send_packet, NULL);
   ctimer_set(&pid_timer, CLOCK_SECOND*5, calc_interv_time, NULL);
@@ -301,20 +621,26 @@ PROCESS_THREAD(udp_client_process, ev, data)
   while(1) {
     PROCESS_YIELD();
 
-    if (toggleShutdown==1) 
+    /* Sleep mode: turn the radio off for a time that grows with the battery
+       deficit. The process keeps handling events meanwhile */
+    if (ev == PROCESS_EVENT_CONTINUE && !toggleShutdown && 
+        power_state_mode() == MSG_MODE_SLEEP) 
+    {
+      reading_batch_flush(); //send what we have while the radio is still on
+      toggleShutdown = 1; //readings go to the flash log from now on
+      rdc_profile_shutdown(1); //radio off until shutdown_time fires
+      etimer_set(&shutdown_time, power_state_shutdown_time(bat_median));
+      printf("Shutdown for %lu s \n", 
+             (unsigned long)(power_state_shutdown_time(bat_median)/CLOCK_SECOND));
+    }
+    else if (ev == PROCESS_EVENT_TIMER && data == &shutdown_time) 
     {
-      printf("Shutdown time toggled. \n");
-
-      ctimer_stop(&periodic);
-      NETSTACK_MAC.off(0);
-      etimer_set(&shutdown_time, CLOCK_SECOND*15); //Should disable the radio for the etimer value set
-      PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&shutdown_time));
-      NETSTACK_MAC.on(); 
-      ctimer_reset(&periodic);
+      rdc_profile_shutdown(0); 
+      toggleShutdown = 0; //calc_interv_time() shuts down again if still in Sleep
     }
 
     if(ev == tcpip_event) {
-     // tcpip_handler();
+      tcpip_handler();
     }
 
 
@@ -329,6 +655,7 @@ PROCESS_THREAD(udp_client_process, ev, data)
 
     }
   
+  battery_est_stop();
   SENSORS_DEACTIVATE(battery_sensor);
 
   PROCESS_END();
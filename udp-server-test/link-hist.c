@@ -0,0 +1,216 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "sys/ctimer.h"
+#include "net/packetbuf.h"
+#include "net/linkaddr.h"
+#include "net/mac/csma.h"
+#include "link-hist.h"
+#if WITH_RPL_BENCH
+#include "rpl-bench.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+struct link_entry {
+  uint8_t id[2];             /* Last bytes of the link-layer address */
+  uint16_t frames;           /* Saturates */
+  uint16_t rssi[LINK_HIST_BUCKETS];
+  uint16_t lqi[LINK_HIST_BUCKETS];
+  int8_t rssi_min;
+  int8_t rssi_max;
+};
+
+static struct link_entry links[LINK_HIST_NUM];
+static uint16_t dropped;
+static struct ctimer export_timer;
+/*---------------------------------------------------------------------------*/
+static uint8_t
+bucket(int16_t value, int16_t min, int16_t step)
+{
+  if(value < min) {
+    return 0;
+  }
+  value = (value - min) / step + 1;
+  return value < LINK_HIST_BUCKETS ? value : LINK_HIST_BUCKETS - 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+count(uint16_t *c)
+{
+  if(*c < 0xffff) {
+    (*c)++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Entry of a neighbor, taking the least active one when the table is full */
+static struct link_entry *
+lookup(const linkaddr_t *addr)
+{
+  const uint8_t *id = &addr->u8[LINKADDR_SIZE - 2];
+  struct link_entry *least = &links[0];
+  uint8_t i;
+
+  for(i = 0; i < LINK_HIST_NUM; i++) {
+    if(links[i].frames > 0 && memcmp(links[i].id, id, 2) == 0) {
+      return &links[i];
+    }
+    if(links[i].frames < least->frames) {
+      least = &links[i];
+    }
+  }
+  if(least->frames > 0) {
+    dropped += least->frames;
+  }
+  memset(least, 0, sizeof(*least));
+  memcpy(least->id, id, 2);
+  least->rssi_min = INT8_MAX;
+  least->rssi_max = INT8_MIN;
+  return least;
+}
+/*---------------------------------------------------------------------------*/
+static void
+count_frame(void)
+{
+  struct link_entry *l;
+  int8_t rssi;
+  uint8_t lqi;
+
+  l = lookup(packetbuf_addr(PACKETBUF_ADDR_SENDER));
+  rssi = (int8_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+  lqi = (uint8_t)packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY);
+
+  count(&l->frames);
+  count(&l->rssi[bucket(rssi, LINK_HIST_RSSI_MIN, LINK_HIST_RSSI_STEP)]);
+  count(&l->lqi[bucket(lqi, LINK_HIST_LQI_MIN, LINK_HIST_LQI_STEP)]);
+  if(rssi < l->rssi_min) {
+    l->rssi_min = rssi;
+  }
+  if(rssi > l->rssi_max) {
+    l->rssi_max = rssi;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  LINK_HIST_MAC.init();
+}
+/*---------------------------------------------------------------------------*/
+static void
+send(mac_callback_t sent, void *ptr)
+{
+  LINK_HIST_MAC.send(sent, ptr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+input(void)
+{
+  count_frame();
+  LINK_HIST_MAC.input();
+}
+/*---------------------------------------------------------------------------*/
+static int
+on(void)
+{
+  return LINK_HIST_MAC.on();
+}
+/*---------------------------------------------------------------------------*/
+static int
+off(int keep_radio_on)
+{
+  return LINK_HIST_MAC.off(keep_radio_on);
+}
+/*---------------------------------------------------------------------------*/
+static unsigned short
+channel_check_interval(void)
+{
+  return LINK_HIST_MAC.channel_check_interval();
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_buckets(const uint16_t *b)
+{
+  uint8_t i;
+
+  for(i = 0; i < LINK_HIST_BUCKETS; i++) {
+    printf(i == 0 ? ":%u" : ",%u", b[i]);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+link_hist_dump(void)
+{
+  struct link_entry *l;
+  uint8_t num = 0;
+  uint8_t i;
+
+  for(i = 0; i < LINK_HIST_NUM; i++) {
+    num += links[i].frames > 0;
+  }
+  printf("LQ %lu %u %u", clock_seconds(), num, dropped);
+  for(i = 0; i < LINK_HIST_NUM; i++) {
+    l = &links[i];
+    if(l->frames == 0) {
+      continue;
+    }
+    printf(" %02x%02x:%u:%d:%d", l->id[0], l->id[1], l->frames,
+           l->rssi_min, l->rssi_max);
+    print_buckets(l->rssi);
+    print_buckets(l->lqi);
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+static void
+export(void *ptr)
+{
+  link_hist_dump();
+  memset(links, 0, sizeof(links));
+  dropped = 0;
+  ctimer_reset(&export_timer);
+}
+/*---------------------------------------------------------------------------*/
+void
+link_hist_init(void)
+{
+  memset(links, 0, sizeof(links));
+  dropped = 0;
+  ctimer_set(&export_timer, LINK_HIST_PERIOD, export, NULL);
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_driver link_hist_mac_driver = {
+  "link-hist",
+  init,
+  send,
+  input,
+  on,
+  off,
+  channel_check_interval,
+};
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,101 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Link quality histograms of the sink's neighbors.
+ *
+ *         Every frame the sink's MAC takes in, data fragments and RPL
+ *         control alike, is counted against the neighbor that sent it,
+ *         with its RSSI and LQI put in LINK_HIST_BUCKETS fixed-width
+ *         buckets. link_hist_mac_driver does the counting and passes the
+ *         frame on to LINK_HIST_MAC, so a datagram sent in fragments counts
+ *         once per fragment. Nothing is printed per frame. Every LINK_HIST_PERIOD
+ *         the histograms go out as one line and start over:
+ *
+ *           LQ <seconds> <neighbors> <dropped>[ <id>:<frames>:<rssi min>:
+ *              <rssi max>:<rssi buckets, comma separated>:<lqi buckets>]...
+ *
+ *         id is the last two bytes of the link-layer address in hex.
+ *         RSSI bucket i counts LINK_HIST_RSSI_MIN + i * LINK_HIST_RSSI_STEP
+ *         dBm up to the next, the first and last bucket are open ended.
+ *         LQI buckets likewise. When the table is full a new neighbor
+ *         takes the entry of the least active one, whose frames so far
+ *         are only counted in dropped.
+ *
+ *         With the defaults a neighbor takes 38 bytes, about 300 bytes in
+ *         all.
+ */
+
+#ifndef LINK_HIST_H_
+#define LINK_HIST_H_
+
+#include "contiki.h"
+#include "net/mac/mac.h"
+
+/*---------------------------------------------------------------------------*/
+/* Neighbors tracked, the sink hears at most NBR_TABLE_CONF_MAX_NEIGHBORS */
+#ifdef LINK_HIST_CONF_NUM
+#define LINK_HIST_NUM             LINK_HIST_CONF_NUM
+#else
+#define LINK_HIST_NUM             8
+#endif
+
+/* Export period */
+#ifdef LINK_HIST_CONF_PERIOD
+#define LINK_HIST_PERIOD          LINK_HIST_CONF_PERIOD
+#else
+#define LINK_HIST_PERIOD          (300 * CLOCK_SECOND)
+#endif
+
+#define LINK_HIST_BUCKETS         8
+
+/* CC2420: RSSI from about -100 dBm, LQI from about 50 to 110 */
+#define LINK_HIST_RSSI_MIN        -92
+#define LINK_HIST_RSSI_STEP       8
+#define LINK_HIST_LQI_MIN         58
+#define LINK_HIST_LQI_STEP        7
+
+/* MAC driver below the counting one, project-conf.h sets rpl-bench's */
+#ifdef LINK_HIST_CONF_MAC
+#define LINK_HIST_MAC             LINK_HIST_CONF_MAC
+#else
+#define LINK_HIST_MAC             csma_driver
+#endif
+/*---------------------------------------------------------------------------*/
+extern const struct mac_driver link_hist_mac_driver;
+
+/**
+ * \brief      Start counting frames and exporting the histograms
+ */
+void link_hist_init(void);
+
+/**
+ * \brief      Print the histograms now, without starting over
+ */
+void link_hist_dump(void);
+/*---------------------------------------------------------------------------*/
+#endif /* LINK_HIST_H_ */
@@ -0,0 +1,226 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "cfs/cfs.h"
+#include "node-control.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define DEBUG DEBUG_PRINT
+#include "net/ip/uip-debug.h"
+
+/* Boot number of the sink, kept across reboots */
+#define EPOCH_FILE "ctrl-epoch"
+
+static struct msg_control pending;
+
+/* Seconds to add to clock_seconds() to get the time of day, set by the
+   "time" command */
+static uint32_t tod_offset;
+/*---------------------------------------------------------------------------*/
+/* Count the boot in the epoch file. Without a file system every boot gets
+   epoch 1 and a node may keep settings from before a reboot */
+static void
+load_epoch(void)
+{
+  uint8_t epoch = 0;
+  int fd;
+
+  fd = cfs_open(EPOCH_FILE, CFS_READ);
+  if(fd >= 0) {
+    if(cfs_read(fd, &epoch, 1) != 1) {
+      epoch = 0;
+    }
+    cfs_close(fd);
+  }
+  pending.epoch = epoch + 1;
+
+  fd = cfs_open(EPOCH_FILE, CFS_WRITE);
+  if(fd < 0 || cfs_write(fd, &pending.epoch, 1) != 1) {
+    PRINTF("Control: epoch not saved\n");
+  }
+  if(fd >= 0) {
+    cfs_close(fd);
+  }
+  PRINTF("Control: epoch %u\n", pending.epoch);
+}
+/*---------------------------------------------------------------------------*/
+void
+node_control_init(void)
+{
+  memset(&pending, 0, sizeof(pending));
+  load_epoch();
+}
+/*---------------------------------------------------------------------------*/
+void
+node_control_set(const struct msg_control *c)
+{
+  if(c->cmds & MSG_C_INTERVAL) {
+    pending.interval = c->interval;
+  }
+  if(c->cmds & MSG_C_THRESHOLDS) {
+    memcpy(pending.thresholds, c->thresholds, sizeof(pending.thresholds));
+  }
+  if(c->cmds & MSG_C_PARAM) {
+    memcpy(pending.param, c->param, sizeof(pending.param));
+  }
+  if(c->cmds & MSG_C_FEATURE) {
+    memcpy(pending.feature, c->feature, sizeof(pending.feature));
+  }
+  if(c->cmds & MSG_C_TIME) {
+    tod_offset = (c->time + 86400UL - clock_seconds() % 86400UL) % 86400UL;
+  }
+  pending.cmds |= c->cmds;
+  /* 0 is what a new node table entry has acked */
+  pending.seq++;
+  if(pending.seq == 0) {
+    pending.seq = 1;
+  }
+  PRINTF("Control: seq %u, commands 0x%02x pending\n", pending.seq,
+         pending.cmds);
+}
+/*---------------------------------------------------------------------------*/
+void
+node_control_clear(void)
+{
+  pending.cmds = 0;
+  PRINTF("Control: cleared\n");
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+node_control_reply(const struct node_entry *n, uint8_t *buf, uint8_t len)
+{
+  if(pending.cmds == 0 || n->ctrl_acked == pending.seq) {
+    return 0;
+  }
+  /* The time as it is now, not when the command was typed */
+  pending.time = (clock_seconds() + tod_offset) % 86400UL;
+  return msg_encode_control(buf, len, &pending);
+}
+/*---------------------------------------------------------------------------*/
+void
+node_control_ack(struct node_entry *n, uint8_t epoch, uint8_t seq)
+{
+  /* A late ack from before a reboot may carry the current seq */
+  if(epoch != pending.epoch) {
+    return;
+  }
+  n->ctrl_acked = seq;
+  PRINTF("Control: seq %u acked by node %u\n", seq, node_table_index(n));
+}
+/*---------------------------------------------------------------------------*/
+/* Parse up to num integers after the command word */
+static uint8_t
+parse_args(const char *p, int16_t *v, uint8_t num)
+{
+  uint8_t i;
+  char *end;
+
+  for(i = 0; i < num; i++) {
+    v[i] = (int16_t)strtol(p, &end, 10);
+    if(end == p) {
+      break;
+    }
+    p = end;
+  }
+  return i;
+}
+/*---------------------------------------------------------------------------*/
+/* Parse a time of day, hh:mm or hh:mm:ss, into seconds */
+static int
+parse_time(const char *p, uint32_t *t)
+{
+  long v[3] = { 0, 0, 0 };
+  uint8_t i;
+  char *end;
+
+  for(i = 0; i < 3; i++) {
+    v[i] = strtol(p, &end, 10);
+    if(end == p) {
+      return -1;
+    }
+    p = end;
+    if(*p != ':') {
+      break;
+    }
+    p++;
+  }
+  if(i == 0 || v[0] < 0 || v[0] > 23 || v[1] < 0 || v[1] > 59 ||
+     v[2] < 0 || v[2] > 59) {
+    return -1;
+  }
+  *t = v[0] * 3600UL + v[1] * 60 + v[2];
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+node_control_command(const char *line)
+{
+  struct msg_control c;
+  int16_t interval;
+
+  memset(&c, 0, sizeof(c));
+  if(strncmp(line, "interval ", 9) == 0) {
+    if(parse_args(&line[9], &interval, 1) != 1 || interval < 0) {
+      return -1;
+    }
+    c.cmds = MSG_C_INTERVAL;
+    c.interval = (uint32_t)interval * CLOCK_SECOND;
+  } else if(strncmp(line, "thresh ", 7) == 0) {
+    if(parse_args(&line[7], c.thresholds, MSG_C_THRESH_LEN) !=
+       MSG_C_THRESH_LEN) {
+      return -1;
+    }
+    c.cmds = MSG_C_THRESHOLDS;
+  } else if(strncmp(line, "param ", 6) == 0) {
+    if(parse_args(&line[6], c.param, MSG_C_PARAM_LEN) != MSG_C_PARAM_LEN) {
+      return -1;
+    }
+    c.cmds = MSG_C_PARAM;
+  } else if(strncmp(line, "feature ", 8) == 0) {
+    if(parse_args(&line[8], c.feature, MSG_C_FEATURE_LEN) !=
+       MSG_C_FEATURE_LEN) {
+      return -1;
+    }
+    c.cmds = MSG_C_FEATURE;
+  } else if(strncmp(line, "time ", 5) == 0) {
+    if(parse_time(&line[5], &c.time) < 0) {
+      return -1;
+    }
+    c.cmds = MSG_C_TIME;
+  } else if(strcmp(line, "clear") == 0) {
+    node_control_clear();
+    return 0;
+  } else {
+    return -1;
+  }
+
+  node_control_set(&c);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
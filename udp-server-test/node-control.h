@@ -0,0 +1,110 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Downlink control channel from the sink to the clients.
+ *
+ *         Settings typed on the sink's serial line (send interval, battery
+ *         thresholds, LQ gains and state, time of day) are merged into one pending
+ *         control message with a new sequence number. It is sent to a node
+ *         right after each of its uplinks, while the node still listens,
+ *         until the node acks that sequence number. Sleeping nodes pick the
+ *         settings up with their next uplink, they are never woken for it.
+ *
+ *         The sequence number lives in RAM and starts over at 1 when the
+ *         sink reboots. Each message also carries an epoch, the sink's boot
+ *         number counted in a small file, and nodes apply a message unless
+ *         they already have the same epoch and sequence number.
+ *
+ *         Serial commands, one per line:
+ *
+ *           interval <s>                  fixed send interval, 0 for LQ
+ *           thresh <crit> <low> <high> <hyst>   battery thresholds in mV
+ *           param <k_err> <k_slope> <k_integ>   LQ gains, Q8
+ *           feature <bat> <rate> <target> <integ> LQ initial state, rate
+ *                                         0 leaves the feed-forward to the
+ *                                         node's harvest forecast
+ *           time <hh:mm[:ss]>             time of day, the sink keeps it
+ *                                         running and sends it as it is
+ *                                         when the node hears it
+ *           clear                         drop the pending settings
+ *
+ *         The sink also takes "nodes", which dumps the node table,
+ *         "links", which prints the link quality histograms, "log" for
+ *         the sink log statistics and "rxq" for the receive queue
+ *         counters.
+ */
+
+#ifndef NODE_CONTROL_H_
+#define NODE_CONTROL_H_
+
+#include "contiki.h"
+#include "node-table.h"
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Start with no pending settings and count the boot in the
+ *             epoch
+ */
+void node_control_init(void);
+
+/**
+ * \brief      Merge settings into the pending control message
+ * \param c    Settings, only the commands set in c->cmds are taken
+ *
+ *             Starts a new sequence number, so every node gets the
+ *             settings again.
+ */
+void node_control_set(const struct msg_control *c);
+
+/**
+ * \brief      Drop the pending settings
+ */
+void node_control_clear(void);
+
+/**
+ * \brief      Control message to send to a node after its uplink
+ * \param n    The node
+ * \param buf  Output buffer, MSG_CONTROL_MAX_LEN is enough
+ * \param len  Size of the output buffer
+ * \return     Number of bytes to send, 0 if the node is up to date
+ */
+uint8_t node_control_reply(const struct node_entry *n, uint8_t *buf,
+                           uint8_t len);
+
+/**
+ * \brief      A node applied the control message with epoch and sequence
+ *             number seq, acks from another epoch are ignored
+ */
+void node_control_ack(struct node_entry *n, uint8_t epoch, uint8_t seq);
+
+/**
+ * \brief      Parse a serial command, see above
+ * \return     0 if the line was a command, -1 otherwise
+ */
+int node_control_command(const char *line);
+/*---------------------------------------------------------------------------*/
+#endif /* NODE_CONTROL_H_ */
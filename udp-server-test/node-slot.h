@@ -0,0 +1,80 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Transmission slots handed out by the sink.
+ *
+ *         The sink splits a frame of NODE_SLOT_FRAME ticks into
+ *         NODE_SLOT_NUM slots. A node sends in the slot of its node table
+ *         position modulo NODE_SLOT_NUM, so with more nodes than slots
+ *         they share slots evenly and no node ever loses its slot to
+ *         another. The clients send on multiples of the frame, so nodes on
+ *         the same interval no longer drift into each other and into CSMA
+ *         backoffs.
+ *
+ *         Nodes have no common clock. Instead the sink checks when an
+ *         uplink arrives. If it is outside the first half of the node's
+ *         slot, the sink replies with the time from now to the start of
+ *         the slot (MSG_TYPE_SLOT) and the node moves its periodic timer
+ *         there. Clock drift is corrected the same way.
+ */
+
+#ifndef NODE_SLOT_H_
+#define NODE_SLOT_H_
+
+#include "contiki.h"
+#include "node-table.h"
+
+/*---------------------------------------------------------------------------*/
+/* Slot frame. The batch deadline of the clients should be a multiple */
+#ifdef NODE_SLOT_CONF_FRAME
+#define NODE_SLOT_FRAME           NODE_SLOT_CONF_FRAME
+#else
+#define NODE_SLOT_FRAME           (CLOCK_SECOND * 10)
+#endif
+
+/* Slots in a frame, i.e. nodes that get a slot of their own */
+#ifdef NODE_SLOT_CONF_NUM
+#define NODE_SLOT_NUM             NODE_SLOT_CONF_NUM
+#else
+#define NODE_SLOT_NUM             16
+#endif
+
+#define NODE_SLOT_LEN             (NODE_SLOT_FRAME / NODE_SLOT_NUM)
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Slot message to send to a node after its uplink
+ * \param n    The node
+ * \param buf  Output buffer, MSG_SLOT_MAX_LEN is enough
+ * \param len  Size of the output buffer
+ * \return     Number of bytes to send, 0 if the node is in its slot
+ *
+ *             Call when the uplink arrives.
+ */
+uint8_t node_slot_reply(struct node_entry *n, uint8_t *buf, uint8_t len);
+/*---------------------------------------------------------------------------*/
+#endif /* NODE_SLOT_H_ */
@@ -0,0 +1,315 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "node-table.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define DEBUG DEBUG_PRINT
+#include "net/ip/uip-debug.h"
+
+#define EMPTY                     0xff
+
+static struct node_entry entries[NODE_TABLE_SIZE];
+static uint8_t buckets[NODE_TABLE_BUCKETS];
+static uint8_t count;
+/*---------------------------------------------------------------------------*/
+/* Minutes since boot, 16 bits wrap after 45 days */
+static uint16_t
+minutes(void)
+{
+  return (uint16_t)(clock_seconds() / 60);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+bucket(const uint8_t *iid)
+{
+  uint16_t h = 0;
+  uint8_t i;
+
+  for(i = 0; i < 8; i++) {
+    h = h * 31 + iid[i];
+  }
+  return h % NODE_TABLE_BUCKETS;
+}
+/*---------------------------------------------------------------------------*/
+/* Take entry i out of the hash index, moving back what probed past it */
+static void
+unhash(uint8_t i)
+{
+  uint16_t b, j, k;
+
+  b = bucket(entries[i].iid);
+  while(buckets[b] != i) {
+    b = (b + 1) % NODE_TABLE_BUCKETS;
+  }
+  buckets[b] = EMPTY;
+
+  for(j = (b + 1) % NODE_TABLE_BUCKETS; buckets[j] != EMPTY;
+      j = (j + 1) % NODE_TABLE_BUCKETS) {
+    k = bucket(entries[buckets[j]].iid);
+    /* Leave it if its home bucket lies cyclically in (b, j] */
+    if(b <= j ? (b < k && k <= j) : (b < k || k <= j)) {
+      continue;
+    }
+    buckets[b] = buckets[j];
+    buckets[j] = EMPTY;
+    b = j;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* A free entry, evicting the least recently heard node if there is none */
+static uint8_t
+free_entry(void)
+{
+  uint16_t now = minutes();
+  uint8_t oldest = 0;
+  uint8_t i;
+
+  for(i = 0; i < NODE_TABLE_SIZE; i++) {
+    if(!entries[i].used) {
+      return i;
+    }
+    if((uint16_t)(now - entries[i].last_heard) >
+       (uint16_t)(now - entries[oldest].last_heard)) {
+      oldest = i;
+    }
+  }
+  PRINTF("Node table full, evicting entry %u\n", oldest);
+  unhash(oldest);
+  count--;
+  return oldest;
+}
+/*---------------------------------------------------------------------------*/
+void
+node_table_init(void)
+{
+  memset(entries, 0, sizeof(entries));
+  memset(buckets, EMPTY, sizeof(buckets));
+  count = 0;
+}
+/*---------------------------------------------------------------------------*/
+struct node_entry *
+node_table_find(const uip_ipaddr_t *addr)
+{
+  const uint8_t *iid = &addr->u8[8];
+  uint16_t b;
+
+  for(b = bucket(iid); buckets[b] != EMPTY; b = (b + 1) % NODE_TABLE_BUCKETS) {
+    if(memcmp(entries[buckets[b]].iid, iid, 8) == 0) {
+      return &entries[buckets[b]];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+struct node_entry *
+node_table_insert(const uip_ipaddr_t *addr)
+{
+  const uint8_t *iid = &addr->u8[8];
+  struct node_entry *n;
+  uint16_t b;
+  uint8_t i;
+
+  n = node_table_find(addr);
+  if(n != NULL) {
+    return n;
+  }
+
+  /* New node. Evicting may move entries around, so probe after it */
+  i = free_entry();
+  for(b = bucket(iid); buckets[b] != EMPTY; b = (b + 1) % NODE_TABLE_BUCKETS);
+  buckets[b] = i;
+  count++;
+
+  n = &entries[i];
+  memset(n, 0, sizeof(*n));
+  memcpy(n->iid, iid, 8);
+  n->mode = MSG_MODE_NUM;
+  n->last_heard = minutes();
+  n->used = 1;
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+struct node_entry *
+node_table_get(uint8_t i)
+{
+  if(i >= NODE_TABLE_SIZE || !entries[i].used) {
+    return NULL;
+  }
+  return &entries[i];
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+node_table_index(const struct node_entry *n)
+{
+  return n - entries;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+zero_bits(uint16_t bits, uint8_t num)
+{
+  uint8_t zeros = 0;
+
+  while(num-- > 0) {
+    if((bits & 1) == 0) {
+      zeros++;
+    }
+    bits >>= 1;
+  }
+  return zeros;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_counter(struct node_entry *n, const struct msg_reading *r)
+{
+  int16_t ahead;
+  uint16_t shift;
+
+  if(n->received == 0 && n->missed == 0) {
+    n->cumulative = r->counter;
+    n->received = 1;
+    return;
+  }
+
+  ahead = (int16_t)(r->counter - n->cumulative);
+  if(ahead < -NODE_TABLE_WINDOW && !(r->fields & MSG_F_DELAYED)) {
+    /* Lost its counter, keep the totals but start the window over, and
+       send the control settings again */
+    n->cumulative = r->counter;
+    n->bitmap = 0;
+    n->received++;
+    n->ctrl_acked = 0;
+    return;
+  }
+  if(ahead <= 0) {
+    /* Given up on or already acked, a duplicate cannot be told apart */
+    if(n->late < 0xff) {
+      n->late++;
+    }
+    return;
+  }
+
+  /* Slide the window so that the counter fits, giving up on the gaps */
+  if(ahead > NODE_TABLE_WINDOW) {
+    shift = ahead - NODE_TABLE_WINDOW;
+    if(shift >= NODE_TABLE_WINDOW) {
+      n->missed += zero_bits(n->bitmap, NODE_TABLE_WINDOW) +
+        (shift - NODE_TABLE_WINDOW);
+      n->bitmap = 0;
+    } else {
+      n->missed += zero_bits(n->bitmap, shift);
+      n->bitmap >>= shift;
+    }
+    n->cumulative += shift;
+    ahead = NODE_TABLE_WINDOW;
+  }
+
+  if(n->bitmap & (1U << (ahead - 1))) {
+    if(n->dups < 0xff) {
+      n->dups++;
+    }
+    return;
+  }
+  n->bitmap |= 1U << (ahead - 1);
+  n->received++;
+
+  while(n->bitmap & 1) {
+    n->bitmap >>= 1;
+    n->cumulative++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+node_table_add(struct node_entry *n, const struct msg_reading *r)
+{
+  n->last_heard = minutes();
+  add_counter(n, r);
+
+  /* Resent and backlog readings are old news for the current state */
+  if(r->fields & MSG_F_DELAYED) {
+    return;
+  }
+  if(r->mode != n->mode) {
+    if(n->mode != MSG_MODE_NUM && n->mode_changes < 0xff) {
+      n->mode_changes++;
+    }
+    n->mode = r->mode;
+  }
+  if(r->fields & MSG_F_BATTERY) {
+    n->battery = r->battery;
+  }
+  if(r->fields & MSG_F_DATA_RATE) {
+    n->data_rate = r->data_rate > 0xffff ? 0xffff : r->data_rate;
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+node_table_ack(const struct node_entry *n, uint8_t *buf, uint8_t len)
+{
+  return msg_encode_ack(buf, len, n->cumulative, n->bitmap);
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+node_table_count(void)
+{
+  return count;
+}
+/*---------------------------------------------------------------------------*/
+void
+node_table_dump(void)
+{
+  uint16_t now = minutes();
+  struct node_entry *n;
+  uint16_t last;
+  uint8_t i;
+
+  printf("Nodes: %u of %u\n", count, NODE_TABLE_SIZE);
+  for(i = 0; i < NODE_TABLE_SIZE; i++) {
+    n = &entries[i];
+    if(!n->used) {
+      continue;
+    }
+    /* Highest counter heard, the top bit set in the window */
+    for(last = NODE_TABLE_WINDOW; last > 0; last--) {
+      if(n->bitmap & (1U << (last - 1))) {
+        break;
+      }
+    }
+    last += n->cumulative;
+    printf("Node %02x%02x:%02x%02x:%02x%02x:%02x%02x counter %u rx %u "
+           "missed %u dups %u late %u mode %s changes %u bat %u rate %u "
+           "heard %u min ago\n",
+           n->iid[0], n->iid[1], n->iid[2], n->iid[3],
+           n->iid[4], n->iid[5], n->iid[6], n->iid[7],
+           last, n->received, n->missed, n->dups, n->late,
+           msg_mode_name(n->mode), n->mode_changes, n->battery,
+           n->data_rate, (uint16_t)(now - n->last_heard));
+  }
+}
+/*---------------------------------------------------------------------------*/
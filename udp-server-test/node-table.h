@@ -0,0 +1,158 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Per-node state on the sink.
+ *
+ *         One fixed-size table holds every node the sink hears. It is keyed
+ *         by the full interface identifier (the last 8 bytes of the source
+ *         address), so nodes that share a last address byte stay apart.
+ *         Lookups go through an open-addressing hash index with linear
+ *         probing, kept at most half full, so they are O(1) on average.
+ *         When the table is full the least recently heard node is evicted.
+ *
+ *         Each entry tracks the node's reading counters, its last battery
+ *         level, data rate and energy mode, and the state of the control
+ *         module. An entry takes 28 bytes plus 2 bytes of index, so the
+ *         default of 32 nodes is 960 bytes of RAM. The position of an
+ *         entry also picks the node's slot (node-slot.h).
+ *
+ *         Counters: the sink keeps a cumulative counter (every reading up
+ *         to it is done) and a bitmap of the NODE_TABLE_WINDOW counters
+ *         after it. Both go back to the node as a MSG_TYPE_ACK. A reading
+ *         more than NODE_TABLE_WINDOW ahead slides the window, and the
+ *         missing counters that slide out count as missed. A reading behind
+ *         the window can no longer be told from a duplicate, so it only
+ *         counts as late. A fresh reading, one with neither MSG_F_AGE nor
+ *         MSG_F_BACKLOG, more than NODE_TABLE_WINDOW behind means the node
+ *         lost its counter, and the window starts over. Only fresh
+ *         readings update the node's mode, battery and data rate.
+ *
+ *         node_table_dump() prints the whole table, one line per node, for
+ *         fleet health checks from the serial line.
+ */
+
+#ifndef NODE_TABLE_H_
+#define NODE_TABLE_H_
+
+#include "contiki.h"
+#include "net/ip/uip.h"
+#include "../msg-codec.h"
+
+/*---------------------------------------------------------------------------*/
+/* Nodes in the table, 30 bytes of RAM each. See RAM_PROFILE in
+   project-conf.h for what the sink can spare */
+#ifdef NODE_TABLE_CONF_SIZE
+#define NODE_TABLE_SIZE           NODE_TABLE_CONF_SIZE
+#else
+#define NODE_TABLE_SIZE           32
+#endif
+
+/* Counters tracked after the cumulative one. The clients keep 16
+   readings for resending, so a wider window would not get more back */
+#define NODE_TABLE_WINDOW         16
+#if NODE_TABLE_WINDOW > MSG_ACK_WINDOW
+#error "NODE_TABLE_WINDOW must fit the ack bitmap"
+#endif
+
+/* Hash buckets, twice the nodes to keep the probes short */
+#define NODE_TABLE_BUCKETS        (2 * NODE_TABLE_SIZE)
+
+struct node_entry {
+  uint8_t iid[8];            /* Interface identifier, the key */
+  uint16_t bitmap;           /* Counters received after cumulative */
+  uint16_t cumulative;       /* Every reading up to it is done */
+  uint16_t received;         /* Distinct readings */
+  uint16_t missed;           /* Counters given up on */
+  uint16_t battery;          /* Last battery level, mV */
+  uint16_t data_rate;        /* Last send interval, clock ticks */
+  uint16_t last_heard;       /* Minute of the last uplink, see minutes() */
+  uint8_t dups;              /* Readings received twice, saturates */
+  uint8_t late;              /* Readings behind the window, saturates */
+  uint8_t mode;              /* Last energy mode, MSG_MODE_* */
+  uint8_t mode_changes;      /* Saturates */
+  uint8_t ctrl_acked;        /* See node-control.h */
+  uint8_t used;
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Empty the table
+ */
+void node_table_init(void);
+
+/**
+ * \brief      Entry of a node
+ * \param addr Source address of the node
+ * \return     The entry, NULL if the node is not in the table
+ */
+struct node_entry *node_table_find(const uip_ipaddr_t *addr);
+
+/**
+ * \brief      Entry of a node, added if it is not in the table yet
+ * \param addr Source address of the node
+ * \return     The entry, never NULL
+ *
+ *             Adding to a full table evicts the node heard least recently,
+ *             so only call it for a datagram that decoded.
+ */
+struct node_entry *node_table_insert(const uip_ipaddr_t *addr);
+
+/**
+ * \brief      Entry at position i, NULL if it is not in use
+ */
+struct node_entry *node_table_get(uint8_t i);
+
+/**
+ * \brief      Position of an entry, for modules that refer to nodes
+ */
+uint8_t node_table_index(const struct node_entry *n);
+
+/**
+ * \brief      Account for a reading received from a node
+ */
+void node_table_add(struct node_entry *n, const struct msg_reading *r);
+
+/**
+ * \brief      Ack to send to a node after its uplink
+ * \param buf  Output buffer, MSG_ACK_MAX_LEN is enough
+ * \param len  Size of the output buffer
+ * \return     Number of bytes to send
+ */
+uint8_t node_table_ack(const struct node_entry *n, uint8_t *buf,
+                       uint8_t len);
+
+/**
+ * \brief      Number of nodes in the table
+ */
+uint8_t node_table_count(void);
+
+/**
+ * \brief      Print every node, one line each
+ */
+void node_table_dump(void);
+/*---------------------------------------------------------------------------*/
+#endif /* NODE_TABLE_H_ */
@@ -0,0 +1,134 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/ipv6/sicslowpan.h"
+#include "rx-queue.h"
+
+#include <stdio.h>
+#include <string.h>
+
+struct rx_frame {
+  uint8_t len;
+  uint8_t data[PACKETBUF_SIZE];
+  struct packetbuf_attr attrs[PACKETBUF_NUM_ATTRS];
+  struct packetbuf_addr addrs[PACKETBUF_NUM_ADDRS];
+};
+
+static struct rx_frame ring[RX_QUEUE_NUM];
+static uint8_t head;
+static uint8_t used;
+static uint8_t peak;
+static uint32_t queued;
+static uint16_t dropped;
+static uint16_t overflows;
+
+PROCESS(rx_queue_process, "Receive queue");
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  head = 0;
+  used = 0;
+  peak = 0;
+  queued = 0;
+  dropped = 0;
+  overflows = 0;
+  process_start(&rx_queue_process, NULL);
+  sicslowpan_driver.init();
+}
+/*---------------------------------------------------------------------------*/
+static void
+input(void)
+{
+  struct rx_frame *f;
+
+  if(used == RX_QUEUE_NUM) {
+    dropped++;
+    return;
+  }
+
+  f = &ring[(head + used) % RX_QUEUE_NUM];
+  f->len = packetbuf_datalen();
+  memcpy(f->data, packetbuf_dataptr(), f->len);
+  packetbuf_attr_copyto(f->attrs, f->addrs);
+
+  used++;
+  queued++;
+  if(used > peak) {
+    peak = used;
+  }
+  if(used == RX_QUEUE_NUM) {
+    overflows++;
+  }
+  process_poll(&rx_queue_process);
+}
+/*---------------------------------------------------------------------------*/
+void
+rx_queue_dump(void)
+{
+  printf("RXQ %lu %lu %u %u %u/%u\n", clock_seconds(),
+         (unsigned long)queued, dropped, overflows, peak, RX_QUEUE_NUM);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(rx_queue_process, ev, data)
+{
+  struct rx_frame *f;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+    if(used == 0) {
+      continue;
+    }
+
+    f = &ring[head];
+    packetbuf_clear();
+    packetbuf_copyfrom(f->data, f->len);
+    packetbuf_attr_copyfrom(f->attrs, f->addrs);
+    head = (head + 1) % RX_QUEUE_NUM;
+    used--;
+
+    sicslowpan_driver.input();
+
+    /* One frame per turn, so the radio driver can empty its FIFO */
+    if(used > 0) {
+      process_poll(&rx_queue_process);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+const struct network_driver rx_queue_driver = {
+  "rx-queue",
+  init,
+  input
+};
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,73 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Receive queue between the radio and 6LoWPAN on the sink.
+ *
+ *         Without it a frame goes from the radio driver's process through
+ *         6LoWPAN, uIP and the UDP handler before the driver reads the
+ *         next one out of the radio, so a burst from many clients at once
+ *         overflows the radio's FIFO and is lost below the application.
+ *         rx_queue_driver takes the place of sicslowpan_driver as the
+ *         network layer: it copies the frame, its attributes and
+ *         addresses into a ring of RX_QUEUE_NUM slots and returns, and a
+ *         process feeds the frames to sicslowpan_driver one per turn.
+ *
+ *         A frame that finds the ring full is dropped and counted. The
+ *         "rxq" command prints the counters as one line:
+ *
+ *           RXQ <seconds> <queued> <dropped> <overflows> <peak>/<slots>
+ *
+ *         overflows counts the times the ring ran full, peak is the most
+ *         frames it has held. A slot takes PACKETBUF_SIZE plus the
+ *         packetbuf attributes, about 210 bytes on the Z1, so the default
+ *         of 4 takes about 840 bytes of RAM. Build with WITH_RX_QUEUE=0 to
+ *         leave it out.
+ */
+
+#ifndef RX_QUEUE_H_
+#define RX_QUEUE_H_
+
+#include "contiki.h"
+#include "net/netstack.h"
+
+/*---------------------------------------------------------------------------*/
+/* Frames the ring holds */
+#ifdef RX_QUEUE_CONF_NUM
+#define RX_QUEUE_NUM              RX_QUEUE_CONF_NUM
+#else
+#define RX_QUEUE_NUM              4
+#endif
+/*---------------------------------------------------------------------------*/
+extern const struct network_driver rx_queue_driver;
+
+/**
+ * \brief      Print the queue counters
+ */
+void rx_queue_dump(void);
+/*---------------------------------------------------------------------------*/
+#endif /* RX_QUEUE_H_ */
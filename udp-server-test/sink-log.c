@@ -0,0 +1,230 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "contiki.h"
+#include "sink-log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* SLIP special bytes */
+#define SLIP_END                  0300
+#define SLIP_ESC                  0333
+#define SLIP_ESC_END              0334
+#define SLIP_ESC_ESC              0335
+
+static uint8_t ring[SINK_LOG_NUM][SINK_LOG_REC_LEN];
+static uint8_t head;
+static uint8_t used;
+static uint8_t high_water;
+static uint16_t dropped;
+static uint16_t reported;
+static uint16_t max_ticks;
+static uint32_t packets;
+static clock_time_t last_write;
+
+PROCESS(sink_log_process, "Sink log drain");
+/*---------------------------------------------------------------------------*/
+static void
+put16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xff;
+  p[1] = v >> 8;
+}
+/*---------------------------------------------------------------------------*/
+static void
+put32(uint8_t *p, uint32_t v)
+{
+  put16(p, v & 0xffff);
+  put16(p + 2, v >> 16);
+}
+/*---------------------------------------------------------------------------*/
+/* Next free record with its header filled in, NULL if the ring is full */
+static uint8_t *
+record(uint8_t type)
+{
+  uint8_t *rec;
+
+  if(used == SINK_LOG_NUM) {
+    if(dropped < 0xffff) {
+      dropped++;
+    }
+    return NULL;
+  }
+  rec = ring[(head + used) % SINK_LOG_NUM];
+  if(++used > high_water) {
+    high_water = used;
+  }
+  memset(rec, 0, SINK_LOG_REC_LEN);
+  rec[0] = type;
+  put16(&rec[1], (uint16_t)clock_seconds());
+  last_write = clock_time();
+  if(used == 1) {
+    process_poll(&sink_log_process);
+  }
+  return rec;
+}
+/*---------------------------------------------------------------------------*/
+void
+sink_log_reading(uint16_t node, const struct msg_reading *r)
+{
+  uint8_t *rec = record(SINK_LOG_READING);
+
+  if(rec == NULL) {
+    return;
+  }
+  put16(&rec[3], node);
+  put16(&rec[5], r->counter);
+  put16(&rec[7], r->battery);
+  put32(&rec[9], r->data_rate);
+  put16(&rec[13], r->age > 0xffff ? 0xffff : r->age);
+  rec[15] = (r->fields << 4) | (r->mode & 0x0f);
+}
+/*---------------------------------------------------------------------------*/
+void
+sink_log_packet(uint16_t node, uint8_t claimed, uint8_t decoded, uint8_t len,
+                uint16_t received, uint16_t missed, uint8_t late,
+                uint8_t dups, uint16_t ticks)
+{
+  uint8_t *rec;
+
+  packets++;
+  if(ticks > max_ticks) {
+    max_ticks = ticks;
+  }
+  rec = record(SINK_LOG_PACKET);
+  if(rec == NULL) {
+    return;
+  }
+  put16(&rec[3], node);
+  rec[5] = claimed;
+  rec[6] = decoded;
+  rec[7] = len;
+  put16(&rec[8], received);
+  put16(&rec[10], missed);
+  rec[12] = late;
+  rec[13] = dups;
+  put16(&rec[14], ticks);
+}
+/*---------------------------------------------------------------------------*/
+void
+sink_log_reply(uint16_t node, uint8_t type, uint8_t len)
+{
+  uint8_t *rec = record(SINK_LOG_REPLY);
+
+  if(rec == NULL) {
+    return;
+  }
+  put16(&rec[3], node);
+  rec[5] = type;
+  rec[6] = len;
+}
+/*---------------------------------------------------------------------------*/
+void
+sink_log_stats(void)
+{
+  uint8_t *rec = record(SINK_LOG_STATS);
+
+  if(rec == NULL) {
+    return;
+  }
+  put16(&rec[3], dropped);
+  put16(&rec[5], max_ticks);
+  put32(&rec[7], packets);
+  rec[11] = high_water;
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_frame(const uint8_t *rec)
+{
+  uint8_t i;
+
+  putchar(SLIP_END);
+  for(i = 0; i < SINK_LOG_REC_LEN; i++) {
+    if(rec[i] == SLIP_END) {
+      putchar(SLIP_ESC);
+      putchar(SLIP_ESC_END);
+    } else if(rec[i] == SLIP_ESC) {
+      putchar(SLIP_ESC);
+      putchar(SLIP_ESC_ESC);
+    } else {
+      putchar(rec[i]);
+    }
+  }
+  putchar(SLIP_END);
+}
+/*---------------------------------------------------------------------------*/
+void
+sink_log_init(void)
+{
+  head = 0;
+  used = 0;
+  high_water = 0;
+  dropped = 0;
+  reported = 0;
+  max_ticks = 0;
+  packets = 0;
+  process_start(&sink_log_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(sink_log_process, ev, data)
+{
+  static struct etimer et;
+  static uint8_t n;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL ||
+                             (ev == PROCESS_EVENT_TIMER && data == &et));
+    while(used > 0) {
+      /* Hold off while packets keep coming, unless the ring fills up */
+      if(clock_time() - last_write < SINK_LOG_QUIET &&
+         used < SINK_LOG_NUM * 3 / 4) {
+        etimer_set(&et, SINK_LOG_QUIET);
+        break;
+      }
+      for(n = 0; n < SINK_LOG_DRAIN && used > 0; n++) {
+        write_frame(ring[head]);
+        head = (head + 1) % SINK_LOG_NUM;
+        used--;
+      }
+      /* Let the receive path run between turns */
+      if(used > 0) {
+        process_poll(&sink_log_process);
+        break;
+      }
+      /* Records were lost since the last stats, say so */
+      if(dropped != reported) {
+        reported = dropped;
+        sink_log_stats();
+      }
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,125 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Institute nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE INSTITUTE AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE INSTITUTE OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file
+ *         Deferred binary log of the sink.
+ *
+ *         The receive path writes fixed-size records into a RAM ring
+ *         instead of formatting text for the UART. A low-priority process
+ *         drains the ring over the serial line when no packet has come in
+ *         for SINK_LOG_QUIET, SINK_LOG_DRAIN records at a time, or sooner
+ *         once the ring is three quarters full. When the ring is full new
+ *         records are dropped and counted.
+ *
+ *         Each record goes out as one SLIP frame (RFC 1055): END, the
+ *         record with END and ESC escaped, END. Text from printf stays
+ *         readable between the frames, and tools/log-decode turns the
+ *         frames back into text or CSV.
+ *
+ *         Records are SINK_LOG_REC_LEN bytes, little endian. Every record
+ *         starts with its type and the low 16 bits of clock_seconds().
+ *         node is the last two bytes of the node's address.
+ *
+ *           READING  3 node  5 counter  7 battery  9 data_rate (32 bits)
+ *                    13 age, saturated  15 fields << 4 | mode
+ *           PACKET   3 node  5 readings claimed  6 readings decoded
+ *                    7 length  8 received  10 missed  12 late  13 dups
+ *                    14 rtimer ticks spent in tcpip_handler
+ *           REPLY    3 node  5 message type  6 length
+ *           STATS    3 records dropped  5 most rtimer ticks of one packet
+ *                    7 packets (32 bits)  11 highest ring use
+ *
+ *         With the defaults the ring takes 512 bytes of RAM.
+ */
+
+#ifndef SINK_LOG_H_
+#define SINK_LOG_H_
+
+#include "contiki.h"
+#include "../msg-codec.h"
+
+/*---------------------------------------------------------------------------*/
+/* Records the ring holds */
+#ifdef SINK_LOG_CONF_NUM
+#define SINK_LOG_NUM              SINK_LOG_CONF_NUM
+#else
+#define SINK_LOG_NUM              32
+#endif
+
+/* Records written per turn of the drain process, about 2 ms each at
+   115200 baud */
+#ifdef SINK_LOG_CONF_DRAIN
+#define SINK_LOG_DRAIN            SINK_LOG_CONF_DRAIN
+#else
+#define SINK_LOG_DRAIN            2
+#endif
+
+/* Time without packets before the ring is drained */
+#ifdef SINK_LOG_CONF_QUIET
+#define SINK_LOG_QUIET            SINK_LOG_CONF_QUIET
+#else
+#define SINK_LOG_QUIET            (CLOCK_SECOND / 16)
+#endif
+
+#define SINK_LOG_REC_LEN          16
+
+enum {
+  SINK_LOG_READING = 1,
+  SINK_LOG_PACKET,
+  SINK_LOG_REPLY,
+  SINK_LOG_STATS
+};
+/*---------------------------------------------------------------------------*/
+/**
+ * \brief      Empty the ring and start the drain process
+ */
+void sink_log_init(void);
+
+/**
+ * \brief      Log a decoded reading
+ */
+void sink_log_reading(uint16_t node, const struct msg_reading *r);
+
+/**
+ * \brief      Log a received packet and the node's counters after it
+ * \param ticks rtimer ticks the receive path took for it
+ */
+void sink_log_packet(uint16_t node, uint8_t claimed, uint8_t decoded,
+                     uint8_t len, uint16_t received, uint16_t missed,
+                     uint8_t late, uint8_t dups, uint16_t ticks);
+
+/**
+ * \brief      Log a reply sent to a node
+ */
+void sink_log_reply(uint16_t node, uint8_t type, uint8_t len);
+
+/**
+ * \brief      Log the drop and timing statistics
+ */
+void sink_log_stats(void);
+/*---------------------------------------------------------------------------*/
+#endif /* SINK_LOG_H_ */
@@ -40,6 +40,36 @@
 /* Example file with meddelande struct and other settings */
 #include "../example.h"
 
+/* Wire format of the readings */
+#include "../msg-codec.h"
+
+/* Per-node state, reading counters and acks */
+#include "node-table.h"
+
+/* Downlink control channel */
+#include "node-control.h"
+
+#if WITH_SLOT
+/* Transmission slots */
+#include "node-slot.h"
+#endif
+
+/* RSSI/LQI histograms per neighbor */
+#include "link-hist.h"
+
+/* Deferred binary log of the receive path */
+#include "sink-log.h"
+
+#if WITH_RX_QUEUE
+/* Receive queue ahead of 6LoWPAN */
+#include "rx-queue.h"
+#endif
+
+#if WITH_RPL_BENCH
+/* Counters for the storing against non-storing benchmark */
+#include "../rpl-bench.h"
+#endif
+
 /* Powertrace for energy consumption estimation */
 #include "powertrace.h"
 
@@ -48,6 +78,7 @@
 
 /* Sensors */
 #include "dev/button-sensor.h"
+#include "dev/serial-line.h"
 
 /* C libraries */
 #include <stdio.h>
@@ -71,30 +102,107 @@ PROCESS(udp_server_process, "UDP server process");
 AUTOSTART_PROCESSES(&udp_server_process);
 /*---------------------------------------------------------------------------*/
 static void
+send_reply(const uip_ipaddr_t *dest, const uint8_t *buf, uint8_t len)
+{
+  if(len == 0) {
+    return;
+  }
+  sink_log_reply((dest->u8[14] << 8) | dest->u8[15], msg_type(buf, len), len);
+  uip_ipaddr_copy(&server_conn->ripaddr, dest);
+  uip_udp_packet_send(server_conn, buf, len);
+  uip_create_unspecified(&server_conn->ripaddr);
+}
+/*---------------------------------------------------------------------------*/
+static void
 tcpip_handler(void)
 {
 
-  struct my_meddelande_t *medPtr;
+  static uint8_t reply[MSG_CONTROL_MAX_LEN];
+  struct msg_cursor cursor;
+  struct msg_reading med;
+  struct node_entry *node;
+  uip_ipaddr_t src;
+  rtimer_clock_t start;
+  uint16_t id;
+#if WITH_SLOT
+  uint8_t fresh;
+#endif
+  uint8_t epoch;
+  uint8_t seq;
 
   if(uip_newdata()) {
-    
-    struct my_meddelande_t *medPtr = (struct my_meddelande_t *) uip_appdata;
 
-    PRINTF("Packet recvieved from node w/ ID: %d \n", 
-           UIP_IP_BUF->srcipaddr.u8[sizeof(UIP_IP_BUF->srcipaddr.u8) - 1]);
-    PRINTF("DATA: Battery: %u mV, Counter: %u, Mode: %s, \n", medPtr->battery, 
-                     medPtr->counter, medPtr->mode);
-    PRINTF("Send interval: every %ld seconds (every %d software clock ticks) \n", medPtr->data_rate/128, medPtr->data_rate); 
-    PRINTF("\n");
+    /* Nothing is printed here, the records go out when the sink is idle */
+    start = RTIMER_NOW();
+
+    /* Sending a reply overwrites uip_buf */
+    uip_ipaddr_copy(&src, &UIP_IP_BUF->srcipaddr);
+    id = (src.u8[14] << 8) | src.u8[15];
+    /* Only a decoded reading adds a node, junk from an unknown source
+       must not evict one that is still sending */
+    node = node_table_find(&src);
+
+    if(msg_type(uip_appdata, uip_datalen()) == MSG_TYPE_CONTROL_ACK) {
+      /* An ack from a node the table lost is dropped, the node gets the
+         settings again once its next reading adds it back */
+      if(node != NULL &&
+         msg_decode_control_ack(uip_appdata, uip_datalen(), &epoch, &seq)) {
+        node_control_ack(node, epoch, seq);
+      }
+      return;
+    }
+
+    /* Readings are decoded straight from uip_appdata, one at a time */
+    if(msg_cursor_init(&cursor, uip_appdata, uip_datalen()) == 0 ||
+       !msg_cursor_next(&cursor, &med)) {
+      if(node == NULL) {
+        sink_log_packet(id, cursor.num, 0, uip_datalen(), 0, 0, 0, 0,
+                        RTIMER_NOW() - start);
+      } else {
+        sink_log_packet(id, cursor.num, 0, uip_datalen(), node->received,
+                        node->missed, node->late, node->dups,
+                        RTIMER_NOW() - start);
+      }
+      return;
+    }
+
+    if(node == NULL) {
+      node = node_table_insert(&src);
+    }
+
+    do {
+      sink_log_reading(id, &med);
+      node_table_add(node, &med);
+#if WITH_SLOT
+      fresh = (med.fields & MSG_F_DELAYED) == 0;
+#endif
+    } while(msg_cursor_next(&cursor, &med));
+
+    /* Keep what was decoded before a malformed reading, the rest is lost
+       like a dropped frame and comes back through the acks. The packet
+       record shows it as fewer readings decoded than claimed */
 
+    /* Per packet this costs too much UART time, link-hist keeps the same
+       figures per neighbor */
     //received_packet_attributes();
 
-#if SERVER_REPLY
-    PRINTF("DATA sending reply\n");
-    uip_ipaddr_copy(&server_conn->ripaddr, &UIP_IP_BUF->srcipaddr);
-    uip_udp_packet_send(server_conn, "Reply", sizeof("Reply"));
-    uip_create_unspecified(&server_conn->ripaddr);
+    /* The node listens for a moment after its uplink. Ack its readings,
+       correct its slot and piggyback any pending settings on that */
+#if WITH_RETX
+    send_reply(&src, reply, node_table_ack(node, reply, sizeof(reply)));
+#endif
+#if WITH_SLOT
+    /* Only a fresh reading tells when the node's periodic timer fires, 
+       resent and backfilled ones go out at other times */
+    if(fresh) {
+      send_reply(&src, reply, node_slot_reply(node, reply, sizeof(reply)));
+    }
 #endif
+    send_reply(&src, reply, node_control_reply(node, reply, sizeof(reply)));
+
+    sink_log_packet(id, cursor.num, cursor.next, cursor.len, node->received,
+                    node->missed, node->late, node->dups,
+                    RTIMER_NOW() - start);
  }
 }
 /*---------------------------------------------------------------------------*/
@@ -154,13 +262,20 @@ PROCESS_THREAD(udp_server_process, ev, data)
   PROCESS_PAUSE();
 
   SENSORS_ACTIVATE(button_sensor);
+  node_table_init();
+  node_control_init();
+  link_hist_init();
+  sink_log_init();
+#if WITH_RPL_BENCH
+  rpl_bench_init();
+#endif
 
   PRINTF("UDP server started. nbr:%d routes:%d\n",
          NBR_TABLE_CONF_MAX_NEIGHBORS, UIP_CONF_MAX_ROUTES);
 
 #if UIP_CONF_ROUTER
 /* The choice of server address determines its 6LoWPAN header compression.
- * Obviously the choice made here must also be selected in udp-client.c.
+ * SERVER_ADDR_MODE in project-conf.h selects it here and in udp-client.c.
  *
  * For correct Wireshark decoding using a sniffer, add the /64 prefix to the
  * 6LowPAN protocol preferences,
@@ -172,10 +287,10 @@ PROCESS_THREAD(udp_server_process, ev, data)
  * uncompressed addresses.
  */
  
-#if 0
+#if SERVER_ADDR_MODE == SERVER_ADDR_64
 /* Mode 1 - 64 bits inline */
    uip_ip6addr(&ipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0, 0, 1);
-#elif 1
+#elif SERVER_ADDR_MODE == SERVER_ADDR_16
 /* Mode 2 - 16 bits inline */
   uip_ip6addr(&ipaddr, UIP_DS6_DEFAULT_PREFIX, 0, 0, 0, 0, 0x00ff, 0xfe00, 1);
 #else
@@ -237,6 +352,20 @@ PROCESS_THREAD(udp_server_process, ev, data)
     } else if (ev == sensors_event && data == &button_sensor) {
       PRINTF("Initiaing global repair\n");
       rpl_repair_root(RPL_DEFAULT_INSTANCE);
+    } else if (ev == serial_line_event_message && data != NULL) {
+      if(strcmp((const char *)data, "nodes") == 0) {
+        node_table_dump();
+      } else if(strcmp((const char *)data, "links") == 0) {
+        link_hist_dump();
+      } else if(strcmp((const char *)data, "log") == 0) {
+        sink_log_stats();
+#if WITH_RX_QUEUE
+      } else if(strcmp((const char *)data, "rxq") == 0) {
+        rx_queue_dump();
+#endif
+      } else if(node_control_command((const char *)data) < 0) {
+        PRINTF("Unknown command: %s\n", (const char *)data);
+      }
     }
   }
 